@@ -1,7 +1,9 @@
 #version 330 core
 
-#define POINT_LIGHTS_COUNT 4
-#define NEARLY_ZERO 0.00001
+// Keep in sync with MAX_LIGHTS_PER_OBJECT in c17-1.c
+#define MAX_LIGHTS 4
+// vec4s of a light packed by glrPackLight
+#define LIGHT_VEC4S 6
 
 in vec3 FragPos;
 in vec3 Normal;
@@ -20,75 +22,39 @@ struct DirLight {
   vec3 diffuse;
   vec3 specular;
 };
-struct PointLight {
-  vec3 position;
-  vec3 ambient;
-  vec3 diffuse;
-  vec3 specular;
-  float constant;
-  float linear;
-  float quadratic;
-};
-struct SpotLight {
-  vec3 position;
-  vec3 direction;
-  vec3 ambient;
-  vec3 diffuse;
-  vec3 specular;
-  float constant;
-  float linear;
-  float quadratic;
-  float cutOff;
-  float outerCutOff;
-};
 
 uniform Material material;
 uniform DirLight dirLight;
-uniform PointLight pointLights[POINT_LIGHTS_COUNT];
-uniform SpotLight spotLight;
 uniform vec3 viewPos;
+// The lights reaching this object, picked on the CPU
+uniform int lightsLen;
+uniform vec4 lights[MAX_LIGHTS * LIGHT_VEC4S];
 
-vec3 calcDirLight(DirLight light, vec3 norm, vec3 materialDiffuse, vec3 materialSpecular) {
-  // ambient
-  vec3 ambient = light.ambient * materialDiffuse;
-
-  // diffuse
-  vec3 lightDir = normalize(-light.direction);
-  vec3 diffuse = max(dot(norm, lightDir), 0.0) * light.diffuse * materialDiffuse;
-
-  // specular
+vec3 shade(vec3 lightDir, vec3 ambient, vec3 diffuse, vec3 specular, vec3 norm, vec3 materialDiffuse, vec3 materialSpecular) {
   vec3 viewDir = normalize(viewPos - FragPos);
   vec3 reflectDir = reflect(-lightDir, norm);
-  vec3 specular = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess) * light.specular * materialSpecular;
-
-  return ambient + diffuse + specular;
-}
-
-vec3 calcPointLight(PointLight light, vec3 norm, vec3 materialDiffuse, vec3 materialSpecular) {
-  float distance = length(light.position - FragPos);
-  float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
-
-  if(attenuation > NEARLY_ZERO) {
-    return calcDirLight(DirLight(FragPos - light.position, light.ambient, light.diffuse, light.specular), norm, materialDiffuse, materialSpecular) * attenuation;
-  }
-
-  return vec3(0.0);
+  return ambient * materialDiffuse +
+    max(dot(norm, lightDir), 0.0) * diffuse * materialDiffuse +
+    pow(max(dot(viewDir, reflectDir), 0.0), material.shininess) * specular * materialSpecular;
 }
 
-vec3 calcSpotLight(SpotLight light, vec3 norm, vec3 materialDiffuse, vec3 materialSpecular) {
-  vec3 lightDir = normalize(light.position - FragPos);
-  float theta = dot(lightDir, normalize(-light.direction));
-  float intensity = 0.0;
-  if(theta > light.outerCutOff) {
-    float epsilon = light.cutOff - light.outerCutOff;
-    intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+vec3 calcLight(int i, vec3 norm, vec3 materialDiffuse, vec3 materialSpecular) {
+  vec4 positionRadius = lights[i * LIGHT_VEC4S];
+  vec4 ambientConstant = lights[i * LIGHT_VEC4S + 1];
+  vec4 diffuseLinear = lights[i * LIGHT_VEC4S + 2];
+  vec4 specularQuadratic = lights[i * LIGHT_VEC4S + 3];
+  vec4 directionCutOff = lights[i * LIGHT_VEC4S + 4];
+  float outerCutOff = lights[i * LIGHT_VEC4S + 5].x;
+
+  vec3 lightDir = normalize(positionRadius.xyz - FragPos);
+  float distance = length(positionRadius.xyz - FragPos);
+  float attenuation = 1.0 / (ambientConstant.w + diffuseLinear.w * distance + specularQuadratic.w * (distance * distance));
+  // A spot light has a direction, a point light has none.
+  if(dot(directionCutOff.xyz, directionCutOff.xyz) > 0.0) {
+    float theta = dot(lightDir, normalize(-directionCutOff.xyz));
+    attenuation *= clamp((theta - outerCutOff) / (directionCutOff.w - outerCutOff), 0.0, 1.0);
   }
-
-  if(intensity > NEARLY_ZERO) {
-    return intensity * calcPointLight(PointLight(light.position, light.ambient, light.diffuse, light.specular, light.constant, light.linear, light.quadratic), norm, materialDiffuse, materialSpecular);
-  }
-
-  return vec3(0.0);
+  return shade(lightDir, ambientConstant.rgb, diffuseLinear.rgb, specularQuadratic.rgb, norm, materialDiffuse, materialSpecular) * attenuation;
 }
 
 void main() {
@@ -96,12 +62,10 @@ void main() {
   vec3 materialDiffuse = vec3(texture(material.diffuse, TexCoords));
   vec3 materialSpecular = vec3(texture(material.specular, TexCoords));
 
-  vec3 res = vec3(0.0);
-  res += calcDirLight(dirLight, norm, materialDiffuse, materialSpecular);
-  for(int i = 0; i < POINT_LIGHTS_COUNT; i++) {
-    res += calcPointLight(pointLights[i], norm, materialDiffuse, materialSpecular);
+  vec3 res = shade(normalize(-dirLight.direction), dirLight.ambient, dirLight.diffuse, dirLight.specular, norm, materialDiffuse, materialSpecular);
+  for(int i = 0; i < lightsLen; i++) {
+    res += calcLight(i, norm, materialDiffuse, materialSpecular);
   }
-  res += calcSpotLight(spotLight, norm, materialDiffuse, materialSpecular);
 
   FragColor = vec4(res, 1.0);
 }
@@ -1,6 +1,10 @@
 #version 330 core
 
 #define NEARLY_ZERO 0.00001
+// GLR_CLUSTERS_X, GLR_CLUSTERS_Y and GLR_CLUSTERS_Z
+#define CLUSTERS_X 16
+#define CLUSTERS_Y 9
+#define CLUSTERS_Z 24
 
 in vec3 FragPos;
 in vec3 Normal;
@@ -46,6 +50,13 @@ uniform DirLight dirLight;
 uniform SpotLight spotLight;
 uniform vec3 viewPos;
 
+// Point lights assigned to clusters of the view frustum, see GlrLightClusters
+uniform samplerBuffer clusterLights;
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterIndices;
+// near, far, width, height
+uniform vec4 clusterParams;
+
 vec3 calcDirLight(DirLight light, vec3 norm, vec3 materialDiffuse, vec3 materialSpecular) {
   // ambient
   vec3 ambient = light.ambient * materialDiffuse;
@@ -89,6 +100,24 @@ vec3 calcSpotLight(SpotLight light, vec3 norm, vec3 materialDiffuse, vec3 materi
   return vec3(0.0);
 }
 
+PointLight fetchPointLight(int index) {
+  vec4 positionRadius = texelFetch(clusterLights, index * 6);
+  vec4 ambientConstant = texelFetch(clusterLights, index * 6 + 1);
+  vec4 diffuseLinear = texelFetch(clusterLights, index * 6 + 2);
+  vec4 specularQuadratic = texelFetch(clusterLights, index * 6 + 3);
+  return PointLight(positionRadius.xyz, ambientConstant.rgb, diffuseLinear.rgb, specularQuadratic.rgb, ambientConstant.a, diffuseLinear.a, specularQuadratic.a);
+}
+
+// The offset and count of the light indices of the fragment's cluster
+uvec2 fetchCluster() {
+  float near = clusterParams.x;
+  float far = clusterParams.y;
+  float depth = 2.0 * near * far / (far + near - (gl_FragCoord.z * 2.0 - 1.0) * (far - near));
+  int slice = clamp(int(log(depth / near) / log(far / near) * CLUSTERS_Z), 0, CLUSTERS_Z - 1);
+  ivec2 tile = clamp(ivec2(gl_FragCoord.xy / clusterParams.zw * vec2(CLUSTERS_X, CLUSTERS_Y)), ivec2(0), ivec2(CLUSTERS_X - 1, CLUSTERS_Y - 1));
+  return texelFetch(clusterGrid, (slice * CLUSTERS_Y + tile.y) * CLUSTERS_X + tile.x).xy;
+}
+
 void main() {
   vec3 norm = normalize(Normal);
   vec3 materialDiffuse = vec3(texture(material.diffuse, TexCoords));
@@ -97,6 +126,11 @@ void main() {
   vec3 res = vec3(0.0);
   res += calcDirLight(dirLight, norm, materialDiffuse, materialSpecular);
   res += calcSpotLight(spotLight, norm, materialDiffuse, materialSpecular);
+  uvec2 cluster = fetchCluster();
+  for(uint i = 0u; i < cluster.y; i++) {
+    int light = int(texelFetch(clusterIndices, int(cluster.x + i)).r);
+    res += calcPointLight(fetchPointLight(light), norm, materialDiffuse, materialSpecular);
+  }
 
   FragColor = vec4(res, 1.0);
 }
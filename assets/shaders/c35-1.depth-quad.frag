@@ -1,12 +1,13 @@
 #version 330 core
 
 in vec2 TexCoords;
+flat in int Layer;
 
 out vec4 FragColor;
 
-uniform sampler2D depthMap;
+uniform sampler2DArray depthMap;
 
 void main() {
-  float depthValue = texture(depthMap, TexCoords).r;
+  float depthValue = texture(depthMap, vec3(TexCoords, float(Layer))).r;
   FragColor = vec4(vec3(depthValue), 1.0);
 }
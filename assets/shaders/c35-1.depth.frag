@@ -1,5 +1,7 @@
 #version 330 core
 
+out vec4 FragColor;
+
 void main() {
-  gl_FragColor = vec4(1.0, 0.5, 1.0, 1.0);
+  FragColor = vec4(1.0, 0.5, 1.0, 1.0);
 }
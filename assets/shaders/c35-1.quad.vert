@@ -4,8 +4,12 @@ layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec2 aTexCoords;
 
 out vec2 TexCoords;
+flat out int Layer;
 
 void main() {
-  gl_Position = vec4(aPos, 1.0);
+  // Each instance shows one cascade in a quarter of the screen, left to right and top to bottom.
+  vec2 offset = vec2(float(gl_InstanceID % 2) - 0.5, 0.5 - float(gl_InstanceID / 2));
+  gl_Position = vec4(aPos.xy * 0.5 + offset, aPos.z, 1.0);
   TexCoords = aTexCoords;
+  Layer = gl_InstanceID;
 }
@@ -0,0 +1,21 @@
+#version 330 core
+
+in vec2 TexCoords;
+
+out vec4 FragColor;
+
+uniform sampler2D source;
+// (1, 0) for the horizontal pass, (0, 1) for the vertical one
+uniform vec2 direction;
+
+const float weights[5] = float[](0.227027, 0.1945946, 0.1216216, 0.054054, 0.016216);
+
+void main() {
+  vec2 step = direction / vec2(textureSize(source, 0));
+  vec3 color = texture(source, TexCoords).rgb * weights[0];
+  for(int i = 1; i < 5; i++) {
+    color += texture(source, TexCoords + step * i).rgb * weights[i];
+    color += texture(source, TexCoords - step * i).rgb * weights[i];
+  }
+  FragColor = vec4(color, 1.0);
+}
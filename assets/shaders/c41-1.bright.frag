@@ -0,0 +1,14 @@
+#version 330 core
+
+in vec2 TexCoords;
+
+out vec4 FragColor;
+
+// The HDR light buffer, sampled bilinearly at half resolution
+uniform sampler2D source;
+
+void main() {
+  vec3 color = texture(source, TexCoords).rgb;
+  float brightness = max(color.r, max(color.g, color.b));
+  FragColor = vec4(color * max(brightness - 1.0, 0.0) / max(brightness, 0.0001), 1.0);
+}
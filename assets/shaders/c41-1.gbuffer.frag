@@ -0,0 +1,23 @@
+#version 330 core
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+layout(location = 0) out vec4 gAlbedo;
+layout(location = 1) out vec4 gSpecular;
+layout(location = 2) out vec4 gNormal;
+
+struct Material {
+  sampler2D diffuse;
+  sampler2D specular;
+  float shininess;
+};
+
+uniform Material material;
+
+void main() {
+  gAlbedo = vec4(texture(material.diffuse, TexCoords).rgb, 1.0);
+  gSpecular = vec4(texture(material.specular, TexCoords).rgb, material.shininess / 256.0);
+  gNormal = vec4(normalize(Normal), 0.0);
+}
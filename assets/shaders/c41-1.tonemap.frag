@@ -0,0 +1,14 @@
+#version 330 core
+
+in vec2 TexCoords;
+
+out vec4 FragColor;
+
+uniform sampler2D source;
+uniform sampler2D bloom;
+uniform float exposure;
+
+void main() {
+  vec3 color = texture(source, TexCoords).rgb + texture(bloom, TexCoords).rgb;
+  FragColor = vec4(vec3(1.0) - exp(-color * exposure), 1.0);
+}
@@ -0,0 +1,186 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "glr.h"
+
+// Each size is assigned repeatedly for at least this long
+#define MIN_SECONDS 0.25
+#define MAX_LIGHTS_PER_CLUSTER 128
+
+static double now()
+{
+  struct timespec time;
+  timespec_get(&time, TIME_UTC);
+  return time.tv_sec + time.tv_nsec / 1.0e9;
+}
+
+static float randomRange(float min, float max)
+{
+  return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+// Column-major perspective projection looking down -z from the origin
+static void perspective(float fovy, float aspect, float near, float far, float m[16])
+{
+  float f = 1.0f / tanf(fovy * 0.5f);
+  for (int i = 0; i < 16; ++i)
+  {
+    m[i] = 0.0f;
+  }
+  m[0] = f / aspect;
+  m[5] = f;
+  m[10] = (far + near) / (near - far);
+  m[11] = -1.0f;
+  m[14] = 2.0f * far * near / (near - far);
+}
+
+// Column-major view turned by angle around y, then moved back by distance
+static void lookAround(float angle, float distance, float m[16])
+{
+  for (int i = 0; i < 16; ++i)
+  {
+    m[i] = 0.0f;
+  }
+  m[0] = cosf(angle);
+  m[2] = -sinf(angle);
+  m[5] = 1.0f;
+  m[8] = sinf(angle);
+  m[10] = cosf(angle);
+  m[14] = -distance;
+  m[15] = 1.0f;
+}
+
+// The sphere and box test of glrAssignLightClusters one light and one cluster at a time
+static int isTouching(const GlrLightClusters *clusters, const float view[16], const GlrLight *light, int i, int j,
+                      int k)
+{
+  float near = clusters->near * powf(clusters->far / clusters->near, (float)k / GLR_CLUSTERS_Z);
+  float far = clusters->near * powf(clusters->far / clusters->near, (float)(k + 1) / GLR_CLUSTERS_Z);
+  float ndcX[2] = {-1.0f + 2.0f * i / GLR_CLUSTERS_X, -1.0f + 2.0f * (i + 1) / GLR_CLUSTERS_X};
+  float ndcY[2] = {-1.0f + 2.0f * j / GLR_CLUSTERS_Y, -1.0f + 2.0f * (j + 1) / GLR_CLUSTERS_Y};
+  float min[3] = {INFINITY, INFINITY, near}, max[3] = {-INFINITY, -INFINITY, far};
+  for (int corner = 0; corner < 4; ++corner)
+  {
+    float d = corner & 1 ? far : near;
+    float cx = ndcX[corner >> 1] * d * clusters->unprojectX;
+    float cy = ndcY[corner >> 1] * d * clusters->unprojectY;
+    min[0] = fminf(min[0], cx);
+    max[0] = fmaxf(max[0], cx);
+    min[1] = fminf(min[1], cy);
+    max[1] = fmaxf(max[1], cy);
+  }
+
+  const float *p = light->position;
+  float center[3];
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    center[axis] = view[axis] * p[0] + view[4 + axis] * p[1] + view[8 + axis] * p[2] + view[12 + axis];
+  }
+  center[2] = -center[2];
+  float radius = glrLightRadius(light);
+
+  float distance = 0.0f;
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    float d = fmaxf(0.0f, fmaxf(min[axis] - center[axis], center[axis] - max[axis]));
+    distance += d * d;
+  }
+  return distance <= radius * radius;
+}
+
+// Return the number of clusters whose light list differs from the scalar test.
+static GLuint check(const GlrLightClusters *clusters, const float view[16], const GlrLight *lights, GLuint lightsLen)
+{
+  GLuint mismatches = 0;
+  for (int k = 0; k < GLR_CLUSTERS_Z; ++k)
+  {
+    for (int j = 0; j < GLR_CLUSTERS_Y; ++j)
+    {
+      for (int i = 0; i < GLR_CLUSTERS_X; ++i)
+      {
+        GLuint cluster = (k * GLR_CLUSTERS_Y + j) * GLR_CLUSTERS_X + i;
+        const GLuint *list = clusters->indices + clusters->grid[cluster * 2];
+        GLuint count = clusters->grid[cluster * 2 + 1];
+        // The first lights touching the cluster in index order, up to the maximum
+        GLuint next = 0;
+        int isDifferent = 0;
+        for (GLuint l = 0; l < lightsLen && next < clusters->maxLightsPerCluster; ++l)
+        {
+          if (isTouching(clusters, view, &lights[l], i, j, k))
+          {
+            isDifferent |= next >= count || list[next] != l;
+            ++next;
+          }
+        }
+        mismatches += isDifferent || next != count;
+      }
+    }
+  }
+  return mismatches;
+}
+
+static int bench(GlrLightClusters *clusters, const float view[16], const float projection[16], const GlrLight *lights,
+                 GLuint lightsLen)
+{
+  int runs = 0;
+  double start = now();
+  double elapsed = 0.0;
+  do
+  {
+    glrAssignLightClusters(clusters, view, projection, lights, lightsLen);
+    ++runs;
+    elapsed = now() - start;
+  } while (elapsed < MIN_SECONDS);
+
+  printf("%8u lights %8u indices %10.3f ms\n", lightsLen, clusters->indicesLen, elapsed / runs * 1.0e3);
+
+  GLuint mismatches = check(clusters, view, lights, lightsLen);
+  if (mismatches > 0)
+  {
+    fprintf(stderr, "%u lights: %u clusters differ from the scalar test\n", lightsLen, mismatches);
+  }
+  return mismatches == 0;
+}
+
+int main()
+{
+  static const GLuint SIZES[] = {64, 1024, 16384};
+  GLuint maxLen = SIZES[sizeof(SIZES) / sizeof(SIZES[0]) - 1];
+
+  // Lights of every reach scattered around and behind the camera, some without attenuation
+  GlrLight *lights = (GlrLight *)calloc(maxLen, sizeof(GlrLight));
+  srand(1);
+  for (GLuint l = 0; l < maxLen; ++l)
+  {
+    GlrLight *light = &lights[l];
+    light->position[0] = randomRange(-40.0f, 40.0f);
+    light->position[1] = randomRange(-20.0f, 20.0f);
+    light->position[2] = randomRange(-40.0f, 40.0f);
+    for (int i = 0; i < 3; ++i)
+    {
+      light->diffuse[i] = randomRange(0.0f, 1.0f);
+    }
+    light->constant = 1.0f;
+    light->linear = l % 997 == 0 ? 0.0f : randomRange(0.05f, 1.0f);
+    light->quadratic = l % 997 == 0 ? 0.0f : randomRange(0.01f, 2.0f);
+  }
+
+  float view[16], projection[16];
+  lookAround(0.5f, 30.0f, view);
+  perspective(1.0f, 16.0f / 9.0f, 0.1f, 100.0f, projection);
+  GlrLightClusters *clusters = glrCreateLightClusters(1280, 720, MAX_LIGHTS_PER_CLUSTER);
+
+  printf("%d threads\n", glrThreadCount());
+  int isPassed = 1;
+  for (size_t i = 0; i < sizeof(SIZES) / sizeof(SIZES[0]); ++i)
+  {
+    isPassed &= bench(clusters, view, projection, lights, SIZES[i]);
+  }
+
+  glrFreeLightClusters(clusters);
+  glrThreadsShutdown();
+  free(lights);
+  return isPassed ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "glr.h"
+
+// Each size is culled repeatedly for at least this long
+#define MIN_SECONDS 0.25
+
+static double now()
+{
+  struct timespec time;
+  timespec_get(&time, TIME_UTC);
+  return time.tv_sec + time.tv_nsec / 1.0e9;
+}
+
+static float randomRange(float min, float max)
+{
+  return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+// Column-major perspective projection looking down -z from the origin, it sees about a quarter of the scene.
+static void perspective(float fovy, float aspect, float near, float far, float m[16])
+{
+  float f = 1.0f / tanf(fovy * 0.5f);
+  for (int i = 0; i < 16; ++i)
+  {
+    m[i] = 0.0f;
+  }
+  m[0] = f / aspect;
+  m[5] = f;
+  m[10] = (far + near) / (near - far);
+  m[11] = -1.0f;
+  m[14] = 2.0f * far * near / (near - far);
+}
+
+// The plane test of glrCullFrustum one object at a time
+static int isVisible(const float planes[6][4], const GlrBounds *bounds, GLuint i)
+{
+  for (int p = 0; p < 6; ++p)
+  {
+    const float *plane = planes[p];
+    float distance = plane[0] * bounds->x[i] + plane[1] * bounds->y[i] + plane[2] * bounds->z[i] + plane[3];
+    float radius = bounds->radius != NULL
+                       ? bounds->radius[i]
+                       : fabsf(plane[0]) * bounds->extentX[i] + fabsf(plane[1]) * bounds->extentY[i] +
+                             fabsf(plane[2]) * bounds->extentZ[i];
+    if (distance + radius <= 0.0f)
+    {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// Return the number of objects whose visibility differs from the scalar test.
+static GLuint check(const float planes[6][4], const GlrBounds *bounds, const GLuint *visible, GLuint visibleLen)
+{
+  GLuint mismatches = 0;
+  GLuint next = 0;
+  for (GLuint i = 0; i < bounds->len; ++i)
+  {
+    int isCulledVisible = next < visibleLen && visible[next] == i;
+    next += isCulledVisible;
+    mismatches += isCulledVisible != isVisible(planes, bounds, i);
+  }
+  // Anything left was out of order or out of range
+  return mismatches + (visibleLen - next);
+}
+
+static int bench(const char *name, const float planes[6][4], const GlrBounds *bounds, GLuint *visible)
+{
+  GLuint visibleLen = 0;
+  int runs = 0;
+  double start = now();
+  double elapsed = 0.0;
+  do
+  {
+    visibleLen = glrCullFrustum(planes, bounds, visible);
+    ++runs;
+    elapsed = now() - start;
+  } while (elapsed < MIN_SECONDS);
+
+  double objectsPerSecond = (double)bounds->len * runs / elapsed;
+  printf("%-8s %8u objects %8u visible %10.3f ms %8.1f M objects/s\n",
+         name, bounds->len, visibleLen, elapsed / runs * 1.0e3, objectsPerSecond / 1.0e6);
+
+  GLuint mismatches = check(planes, bounds, visible, visibleLen);
+  if (mismatches > 0)
+  {
+    fprintf(stderr, "%s: %u objects differ from the scalar test\n", name, mismatches);
+  }
+  return mismatches == 0;
+}
+
+int main()
+{
+  static const GLuint SIZES[] = {10000, 100000, 1000000};
+  GLuint maxLen = SIZES[sizeof(SIZES) / sizeof(SIZES[0]) - 1];
+
+  float *center[3], *extent[3];
+  for (int i = 0; i < 3; ++i)
+  {
+    center[i] = (float *)malloc(sizeof(float) * maxLen);
+    extent[i] = (float *)malloc(sizeof(float) * maxLen);
+  }
+  float *radius = (float *)malloc(sizeof(float) * maxLen);
+  GLuint *visible = (GLuint *)malloc(sizeof(GLuint) * maxLen);
+
+  srand(1);
+  for (GLuint i = 0; i < maxLen; ++i)
+  {
+    for (int j = 0; j < 3; ++j)
+    {
+      center[j][i] = randomRange(-100.0f, 100.0f);
+      extent[j][i] = randomRange(0.25f, 1.0f);
+    }
+    radius[i] = sqrtf(extent[0][i] * extent[0][i] + extent[1][i] * extent[1][i] + extent[2][i] * extent[2][i]);
+  }
+
+  float viewProjection[16];
+  float planes[6][4];
+  perspective(1.0f, 16.0f / 9.0f, 0.1f, 100.0f, viewProjection);
+  glrFrustumPlanes(viewProjection, planes);
+
+  printf("%d threads\n", glrThreadCount());
+  int isPassed = 1;
+  for (size_t i = 0; i < sizeof(SIZES) / sizeof(SIZES[0]); ++i)
+  {
+    GlrBounds bounds = {.x = center[0], .y = center[1], .z = center[2], .radius = radius, .len = SIZES[i]};
+    isPassed &= bench("spheres", planes, &bounds, visible);
+    bounds.radius = NULL;
+    bounds.extentX = extent[0];
+    bounds.extentY = extent[1];
+    bounds.extentZ = extent[2];
+    isPassed &= bench("boxes", planes, &bounds, visible);
+  }
+
+  glrThreadsShutdown();
+  for (int i = 0; i < 3; ++i)
+  {
+    free(center[i]);
+    free(extent[i]);
+  }
+  free(radius);
+  free(visible);
+  return isPassed ? 0 : 1;
+}
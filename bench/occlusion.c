@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "glr.h"
+
+// Each measurement repeats for at least this long
+#define MIN_SECONDS 0.25
+#define BUFFER_WIDTH 256
+#define BUFFER_HEIGHT 144
+// Walls of a grid of rooms, like a dense interior
+#define ROOMS 8
+#define ROOM_SIZE 25.0f
+
+static double now()
+{
+  struct timespec time;
+  timespec_get(&time, TIME_UTC);
+  return time.tv_sec + time.tv_nsec / 1.0e9;
+}
+
+static float randomRange(float min, float max)
+{
+  return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+// Column-major perspective projection looking down -z from the origin
+static void perspective(float fovy, float aspect, float near, float far, float m[16])
+{
+  float f = 1.0f / tanf(fovy * 0.5f);
+  for (int i = 0; i < 16; ++i)
+  {
+    m[i] = 0.0f;
+  }
+  m[0] = f / aspect;
+  m[5] = f;
+  m[10] = (far + near) / (near - far);
+  m[11] = -1.0f;
+  m[14] = 2.0f * far * near / (near - far);
+}
+
+// Thin walls with doorways between the rooms in front of the camera
+static void addWalls(GlrOcclusionBuffer *buffer)
+{
+  float half = ROOMS * ROOM_SIZE * 0.5f;
+  for (int i = 1; i < ROOMS; ++i)
+  {
+    float z = -i * ROOM_SIZE;
+    // Walls across the view with a doorway in the middle
+    glrAddOccluderBox(buffer, (float[]){-half, -5.0f, z - 0.2f}, (float[]){-2.0f, 5.0f, z + 0.2f}, NULL);
+    glrAddOccluderBox(buffer, (float[]){2.0f, -5.0f, z - 0.2f}, (float[]){half, 5.0f, z + 0.2f}, NULL);
+    glrAddOccluderBox(buffer, (float[]){-2.0f, 3.0f, z - 0.2f}, (float[]){2.0f, 5.0f, z + 0.2f}, NULL);
+    // Walls along the view
+    float x = -half + i * ROOM_SIZE;
+    glrAddOccluderBox(buffer, (float[]){x - 0.2f, -5.0f, -ROOMS * ROOM_SIZE}, (float[]){x + 0.2f, 5.0f, 0.0f}, NULL);
+  }
+}
+
+// Whether the occlusion result keeps its objects in the order of the frustum culled list and adds none
+static int isSubsequence(const GLuint *visible, GLuint visibleLen, const GLuint *inFrustum, GLuint inFrustumLen)
+{
+  GLuint next = 0;
+  for (GLuint i = 0; i < visibleLen; ++i)
+  {
+    while (next < inFrustumLen && inFrustum[next] != visible[i])
+    {
+      ++next;
+    }
+    if (next == inFrustumLen)
+    {
+      return 0;
+    }
+    ++next;
+  }
+  return 1;
+}
+
+// Objects whose visibility is known from the walls: behind the first wall, in front of it, and across the near plane
+static int checkKnownObjects(const GlrOcclusionBuffer *buffer, const float planes[6][4])
+{
+  static const char *NAMES[] = {"behind a wall", "in front of the walls", "across the near plane"};
+  float x[] = {-20.0f, 3.0f, 0.5f}, y[] = {0.0f, 0.0f, 0.0f}, z[] = {-40.0f, -10.0f, -0.1f};
+  float radius[] = {0.5f, 0.5f, 0.5f};
+  int isExpected[] = {0, 1, 1};
+  GlrBounds bounds = {.x = x, .y = y, .z = z, .radius = radius, .len = 3};
+  GLuint visible[3];
+  GLuint visibleLen = glrCullFrustum(planes, &bounds, visible);
+  // All of them are in the frustum, so only the walls can remove one.
+  int isPassed = visibleLen == bounds.len;
+  visibleLen = glrCullOcclusion(buffer, &bounds, visible, visibleLen);
+
+  for (GLuint i = 0; i < bounds.len; ++i)
+  {
+    int isVisible = 0;
+    for (GLuint j = 0; j < visibleLen; ++j)
+    {
+      isVisible |= visible[j] == i;
+    }
+    if (isVisible != isExpected[i])
+    {
+      fprintf(stderr, "object %s is %s\n", NAMES[i], isVisible ? "kept" : "removed");
+      isPassed = 0;
+    }
+  }
+  return isPassed;
+}
+
+int main()
+{
+  static const GLuint SIZES[] = {10000, 100000, 1000000};
+  GLuint maxLen = SIZES[sizeof(SIZES) / sizeof(SIZES[0]) - 1];
+
+  float *center[3];
+  for (int i = 0; i < 3; ++i)
+  {
+    center[i] = (float *)malloc(sizeof(float) * maxLen);
+  }
+  float *radius = (float *)malloc(sizeof(float) * maxLen);
+  GLuint *visible = (GLuint *)malloc(sizeof(GLuint) * maxLen);
+  GLuint *inFrustum = (GLuint *)malloc(sizeof(GLuint) * maxLen);
+
+  srand(1);
+  for (GLuint i = 0; i < maxLen; ++i)
+  {
+    center[0][i] = randomRange(-ROOMS * ROOM_SIZE * 0.5f, ROOMS * ROOM_SIZE * 0.5f);
+    center[1][i] = randomRange(-4.0f, 4.0f);
+    center[2][i] = randomRange(-ROOMS * ROOM_SIZE, -1.0f);
+    radius[i] = randomRange(0.25f, 1.0f);
+  }
+
+  float viewProjection[16];
+  float planes[6][4];
+  perspective(1.0f, 16.0f / 9.0f, 0.1f, ROOMS * ROOM_SIZE, viewProjection);
+  glrFrustumPlanes(viewProjection, planes);
+
+  GlrOcclusionBuffer *buffer = glrCreateOcclusionBuffer(BUFFER_WIDTH, BUFFER_HEIGHT);
+  int runs = 0;
+  double start = now();
+  double elapsed = 0.0;
+  do
+  {
+    glrClearOcclusionBuffer(buffer, viewProjection);
+    addWalls(buffer);
+    glrRasterizeOccluders(buffer);
+    ++runs;
+    elapsed = now() - start;
+  } while (elapsed < MIN_SECONDS);
+  printf("%d threads\n", glrThreadCount());
+  printf("rasterize %u triangles into %dx%d: %.3f ms\n",
+         buffer->trianglesLen, buffer->width, buffer->height, elapsed / runs * 1.0e3);
+
+  int isPassed = checkKnownObjects(buffer, planes);
+  for (size_t i = 0; i < sizeof(SIZES) / sizeof(SIZES[0]); ++i)
+  {
+    GlrBounds bounds = {.x = center[0], .y = center[1], .z = center[2], .radius = radius, .len = SIZES[i]};
+    GLuint inFrustumLen = glrCullFrustum(planes, &bounds, inFrustum);
+    GLuint visibleLen = 0;
+
+    runs = 0;
+    start = now();
+    do
+    {
+      // The occlusion test compacts the list, so it starts from the frustum culled list every run.
+      glrCullFrustum(planes, &bounds, visible);
+      visibleLen = glrCullOcclusion(buffer, &bounds, visible, inFrustumLen);
+      ++runs;
+      elapsed = now() - start;
+    } while (elapsed < MIN_SECONDS);
+
+    printf("%8u objects %8u in frustum %8u visible %10.3f ms %8.1f M objects/s\n",
+           bounds.len, inFrustumLen, visibleLen, elapsed / runs * 1.0e3, (double)bounds.len * runs / elapsed / 1.0e6);
+
+    if (!isSubsequence(visible, visibleLen, inFrustum, inFrustumLen))
+    {
+      fprintf(stderr, "%u objects: the visible list is not an ordered part of the frustum culled list\n", bounds.len);
+      isPassed = 0;
+    }
+    // The walls hide most of the rooms behind the first one.
+    if (visibleLen == 0 || visibleLen >= inFrustumLen)
+    {
+      fprintf(stderr, "%u objects: %u of %u in frustum are visible\n", bounds.len, visibleLen, inFrustumLen);
+      isPassed = 0;
+    }
+  }
+
+  glrFreeOcclusionBuffer(buffer);
+  glrThreadsShutdown();
+  for (int i = 0; i < 3; ++i)
+  {
+    free(center[i]);
+  }
+  free(radius);
+  free(visible);
+  free(inFrustum);
+  return isPassed ? 0 : 1;
+}
@@ -5,11 +5,32 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+typedef enum GlrSwapMode
+{
+  // Wait for the vertical blank
+  GLR_SWAP_VSYNC = 0,
+  // Wait for the vertical blank but swap late frames immediately. Falls back to vsync without the
+  // `EXT_swap_control_tear` extension.
+  GLR_SWAP_ADAPTIVE = 1,
+  // Swap immediately
+  GLR_SWAP_OFF = 2,
+} GlrSwapMode;
+
 typedef struct GlrSetupArgs
 {
   int windowWidth;
   int windowHeight;
   const char *windowTitle;
+  // Create an offscreen context via EGL surfaceless or OSMesa and render into a framebuffer instead of a window.
+  //
+  // It is also enabled by the environment variable `GLR_HEADLESS=1`.
+  int headless;
+  // It is also set by the environment variable `GLR_SWAP=vsync|adaptive|off`.
+  GlrSwapMode swapMode;
+  // Limit the frame rate to this many frames per second, or 0 for no limit.
+  //
+  // It is also set by the environment variable `GLR_FPS=<rate>`.
+  double targetFps;
 } GlrSetupArgs;
 
 typedef struct GlrModelVertex
@@ -70,6 +91,10 @@ typedef struct GlrModel
   // Number of indices
   GLuint indicesLen;
 
+  // Axis-aligned bounding box of the vertices in model space
+  float boundsMin[3];
+  float boundsMax[3];
+
   GLuint vbo;
   GLuint ebo;
   GLuint vao;
@@ -82,6 +107,15 @@ typedef struct GlrModel
  */
 GLFWwindow *glrSetup(GlrSetupArgs *args);
 
+/**
+ * @brief Get the framebuffer that replaces the default framebuffer in headless mode.
+ *
+ * Binding framebuffer 0 binds it instead, so chapters work unchanged.
+ *
+ * @return The framebuffer or 0 when not headless.
+ */
+GLuint glrHeadlessFramebuffer();
+
 /**
  * @brief Get the error message from the last setup error.
  */
@@ -106,6 +140,69 @@ void glrTeardown(GLFWwindow *window);
  */
 char *glrReadFile(const char *filename, const char *mode, GLsizei *outLen);
 
+typedef struct GlrArenaBlock GlrArenaBlock;
+
+/**
+ * @brief A linear allocator for temporaries that all die at the same time
+ *
+ * Allocations bump a pointer in the newest block, and a reset frees all of them in one go.
+ */
+typedef struct GlrArena
+{
+  // Newest first, each block is twice the size of the previous one
+  GlrArenaBlock *blocks;
+  // Size of the first block
+  size_t blockSize;
+  // Bytes allocated since the last reset
+  size_t used;
+  // Most bytes allocated between two resets
+  size_t peak;
+  // The last allocation, the only one that can grow or be freed in place
+  void *last;
+} GlrArena;
+
+/**
+ * @brief Create an arena whose first block has `blockSize` bytes. No memory is allocated until the first allocation.
+ */
+GlrArena *glrCreateArena(size_t blockSize);
+
+/**
+ * @brief Allocate `size` bytes aligned to 16 bytes. Return NULL when out of memory.
+ */
+void *glrArenaAlloc(GlrArena *arena, size_t size);
+
+/**
+ * @brief Allocate `count` zeroed elements of `size` bytes.
+ */
+void *glrArenaCalloc(GlrArena *arena, size_t count, size_t size);
+
+/**
+ * @brief Resize an allocation of `oldSize` bytes.
+ *
+ * The last allocation is resized in place while its block has room, any other one is copied.
+ */
+void *glrArenaRealloc(GlrArena *arena, void *data, size_t oldSize, size_t newSize);
+
+/**
+ * @brief Give back the last allocation. Any other allocation is only freed by `glrResetArena`.
+ */
+void glrArenaFree(GlrArena *arena, void *data);
+
+/**
+ * @brief Read the file into a buffer allocated in the arena, like `glrReadFile`.
+ */
+char *glrArenaReadFile(GlrArena *arena, const char *filename, const char *mode, GLsizei *outLen);
+
+/**
+ * @brief Free every allocation. The largest block is kept, so the next round of the same size allocates nothing.
+ */
+void glrResetArena(GlrArena *arena);
+
+/**
+ * @brief Free the arena and all of its blocks.
+ */
+void glrFreeArena(GlrArena *arena);
+
 /**
  * @brief Load a shader by compiling the source code.
  *
@@ -136,6 +233,22 @@ const GLchar *glrShaderBinary(GLuint shader, GLenum binaryFormat, const void *bi
  */
 const GLchar *glrShaderBinaryFromFile(GLuint shader, GLenum binaryFormat, const char *filename, const GLchar *entryPoint);
 
+/**
+ * @brief Whether SPIR-V shader binaries can be loaded, either via OpenGL 4.6 or `GL_ARB_gl_spirv`.
+ */
+GLboolean glrSpirvSupported();
+
+/**
+ * @brief Load a shader from the file, preferring the SPIR-V binary `<filename>.spv` compiled by the build.
+ *
+ * Falls back to compiling the GLSL source when SPIR-V is unsupported or the binary does not exist. All shaders in a
+ * program must come from the same kind, and most drivers drop uniform names in SPIR-V, so programs loaded this way
+ * should not rely on `glGetUniformLocation`.
+ *
+ * @return The error message or NULL if no error. The caller is responsible for freeing the memory.
+ */
+const GLchar *glrShaderFromFile(GLuint shader, const char *filename);
+
 /**
  * @brief Link the program.
  *
@@ -143,26 +256,1633 @@ const GLchar *glrShaderBinaryFromFile(GLuint shader, GLenum binaryFormat, const
  */
 const GLchar *glrLinkProgram(GLuint program);
 
-typedef void (*GlrLoadTextureCallback)(GLuint texture, const char *filename);
+/**
+ * @brief Hint the driver how many threads to use for background compiling.
+ *
+ * No-op unless `GL_KHR_parallel_shader_compile` is available.
+ */
+void glrMaxShaderCompilerThreads(GLuint count);
 
 /**
- * @brief Load the model from the file.
+ * @brief Submit the shader source for compiling without waiting for the result.
+ *
+ * Use `glrShaderIsCompleted` to poll and `glrShaderResult` to get the error.
  */
-GlrModel *glrLoadModel(char *filename, GlrLoadTextureCallback loadTexture);
+void glrShaderSourceAsync(GLuint shader, const GLchar *string, GLsizei length);
 
 /**
- * @brief Bind buffers for the model.
+ * @brief Submit the shader source from the file for compiling without waiting for the result.
+ * @return The error message if the file cannot be read or NULL. The caller is responsible for freeing the memory.
  */
-void glrBindModel(GlrModel *model);
+const GLchar *glrShaderSourceFromFileAsync(GLuint shader, const char *filename);
 
 /**
- * @brief Draw the model.
+ * @brief Submit the program for linking without waiting for the result.
  */
-void glrDrawModel(GlrModel *model, GlrModelMaterialUniforms *uniforms);
+void glrLinkProgramAsync(GLuint program);
 
 /**
- * @brief Free the resources allocated for the model
+ * @brief Poll whether the background compiling has finished.
+ *
+ * Always returns `GL_TRUE` when `GL_KHR_parallel_shader_compile` is unavailable, the driver then blocks in
+ * `glrShaderResult` instead.
  */
-void glrFreeModel(GlrModel *model);
+GLboolean glrShaderIsCompleted(GLuint shader);
+
+/**
+ * @brief Poll whether the background linking has finished.
+ *
+ * See `glrShaderIsCompleted`.
+ */
+GLboolean glrProgramIsCompleted(GLuint program);
+
+/**
+ * @brief Count the programs that are still being linked in the background.
+ */
+GLsizei glrProgramsPending(const GLuint *programs, GLsizei len);
+
+/**
+ * @brief Get the result of `glrShaderSourceAsync`.
+ *
+ * Blocks if the compiling has not finished yet. The shader is deleted on failure like `glrShaderSource`.
+ *
+ * @return The error message or NULL if no error. The caller is responsible for freeing the memory.
+ */
+const GLchar *glrShaderResult(GLuint shader);
+
+/**
+ * @brief Get the result of `glrLinkProgramAsync`.
+ *
+ * Blocks if the linking has not finished yet. The program is deleted on failure like `glrLinkProgram`.
+ *
+ * @return The error message or NULL if no error. The caller is responsible for freeing the memory.
+ */
+const GLchar *glrProgramResult(GLuint program);
+
+/**
+ * @brief Start recording or replaying input. It is called by `glrSetup`.
+ *
+ * Set the environment variable `GLR_INPUT_RECORD=<file>` to record timestamped keys, cursor positions, scroll offsets
+ * and frame times into a binary log, or `GLR_INPUT_REPLAY=<file>` to replay a log. Events are stamped with the time
+ * `glrPollEvents` dispatches them, GLFW does not expose earlier timestamps.
+ *
+ * A replay runs with a fixed timestep of 1/60 s, or the one set by `GLR_INPUT_STEP=<seconds>`: each `glrPollEvents`
+ * advances `glrGetTime` by the step and dispatches every event up to that time through the registered callbacks, so
+ * the session plays the same on any machine. `GLR_INPUT_STEP=0` replays the recorded frames instead, one per
+ * `glrPollEvents` with their recorded times, which reproduces the exact frames of a reported slow frame. The window
+ * is marked to close at the end of the log and live input is ignored while replaying.
+ */
+void glrInputInit(GLFWwindow *window);
+
+/**
+ * @brief Whether the input is replayed from a log.
+ */
+int glrInputReplaying();
+
+/**
+ * @brief Get the time of the current frame when recording or replaying.
+ * @return 1 if the time is set or 0 in live mode.
+ */
+int glrInputFrameTime(double *time);
+
+/**
+ * @brief Replacement of `glfwGetKey` that returns the replayed key state.
+ */
+int glrGetKey(GLFWwindow *window, int key);
+
+/**
+ * @brief Replacement of `glfwSetCursorPosCallback` that records or replays cursor positions.
+ */
+void glrSetCursorPosCallback(GLFWwindow *window, GLFWcursorposfun callback);
+
+/**
+ * @brief Replacement of `glfwSetScrollCallback` that records or replays scroll offsets.
+ */
+void glrSetScrollCallback(GLFWwindow *window, GLFWscrollfun callback);
+
+/**
+ * @brief Replacement of `glfwPollEvents` that records or replays the events of a frame.
+ */
+void glrPollEvents(GLFWwindow *window);
+
+/**
+ * @brief Close the input log. It is called by `glrTeardown`.
+ */
+void glrInputShutdown();
+
+/**
+ * @brief Whether the benchmark mode is enabled via the environment variable `GLR_BENCHMARK=<frames>`.
+ *
+ * In benchmark mode, the time advances in fixed steps per frame, the camera follows a scripted path and every frame
+ * ends with `glFinish`. After the warmup, `<frames>` frames are recorded and the CPU and GPU frame time statistics
+ * are written as JSON to the file `GLR_BENCHMARK_OUTPUT` or stdout. Then the window is marked to close.
+ */
+int glrBenchmarkActive();
+
+/**
+ * @brief Replacement of `glfwGetTime` that returns the deterministic frame time in benchmark mode.
+ */
+double glrGetTime();
+
+/**
+ * @brief Override the camera with the scripted path in benchmark mode.
+ *
+ * The path starts from the camera passed in the first call.
+ *
+ * @return 1 if the camera is overridden or 0 if not in benchmark mode.
+ */
+int glrBenchmarkCamera(float position[3], float front[3]);
+
+/**
+ * @brief Finish the frame in benchmark mode. It is called by `glrSwapBuffers` before the swap.
+ */
+void glrBenchmarkEndFrame(GLFWwindow *window);
+
+/**
+ * @brief Start the frame in benchmark mode. It is called by `glrSwapBuffers` after the swap.
+ */
+void glrBenchmarkBeginFrame();
+
+/**
+ * @brief Frame pacing statistics in seconds.
+ */
+typedef struct GlrFrameTiming
+{
+  // Time between the last two swaps
+  double frameTime;
+  // Time from the glrPollEvents that sampled the input of a frame to the GPU executing its swap. Results are read
+  // back a few frames later, so they lag behind.
+  double latency;
+  double latencyMean;
+  double latencyMax;
+  GLuint64 frames;
+} GlrFrameTiming;
+
+/**
+ * @brief Apply the swap mode and frame limit of the setup args. It is called by `glrSetup`.
+ *
+ * Both are disabled in benchmark mode.
+ */
+void glrFrameInit(GlrSetupArgs *args);
+
+/**
+ * @brief Set the swap interval of the current context.
+ */
+void glrSetSwapMode(GlrSwapMode swapMode);
+
+/**
+ * @brief Get the swap mode in effect, adaptive sync may have fallen back to vsync.
+ */
+GlrSwapMode glrGetSwapMode();
+
+/**
+ * @brief Limit the frame rate, or pass 0 for no limit.
+ *
+ * `glrSwapBuffers` sleeps until shortly before the deadline of the frame and spins for the rest, so it does not
+ * burn a core while waiting and still swaps on time.
+ */
+void glrSetFrameLimit(double targetFps);
+
+/**
+ * @brief Get the frame pacing statistics.
+ */
+const GlrFrameTiming *glrFrameTiming();
+
+/**
+ * @brief Mark the time the input of the next frame is sampled. It is called by `glrPollEvents`.
+ */
+void glrFrameInputSampled();
+
+/**
+ * @brief Mark the time the input of the next presented frame was sampled, for input sampled on another thread.
+ *
+ * After the first call, `glrPollEvents` no longer marks the time. 0 marks no input.
+ */
+void glrFrameInputSampledAt(double time);
+
+/**
+ * @brief Replacement of `glfwSwapBuffers` that finishes the frame for the profiler, the statistics and the benchmark,
+ * applies the frame limit and measures the frame timing.
+ */
+void glrSwapBuffers(GLFWwindow *window);
+
+/**
+ * @brief Release the frame pacing queries. It is called by `glrTeardown`.
+ */
+void glrFrameShutdown();
+
+/**
+ * @brief An application whose simulation and rendering run on separate threads.
+ */
+typedef struct GlrApp
+{
+  // State owned by the main thread. It is copied into a snapshot for the render thread after every simulation step,
+  // so it must not contain pointers to data the simulation changes.
+  void *state;
+  size_t stateSize;
+  // Called on the main thread after the input is polled. It must not call GL.
+  void (*simulate)(GLFWwindow *window, void *state, float deltaTime);
+
+  // Context of the render function, e.g. the GL objects created before `glrRunApp`
+  void *renderContext;
+  // Called on the render thread with the latest snapshot, which is valid until it returns. The render thread calls
+  // `glrSwapBuffers` afterwards. Profiler scopes can only be used here.
+  void (*render)(GLFWwindow *window, const void *snapshot, void *renderContext);
+} GlrApp;
+
+/**
+ * @brief Run the application until the window should close.
+ *
+ * The main thread polls the input and simulates into a triple-buffered snapshot, while a render thread that owns the
+ * context renders the latest snapshot. The simulation of a frame overlaps the rendering of the previous one and never
+ * runs more than one frame ahead. In benchmark mode, both alternate to keep the fixed timestep deterministic.
+ *
+ * The context is current on the render thread while it runs, and current on the calling thread again when it
+ * returns.
+ *
+ * @return The error message or NULL if no error. The caller is responsible for freeing the memory.
+ */
+const GLchar *glrRunApp(GLFWwindow *window, GlrApp *app);
+
+/**
+ * @brief Whether the profiler is enabled via the environment variable `GLR_PROFILE=<trace.json>`.
+ *
+ * The recorded scopes are written to the file as Chrome trace JSON in `glrTeardown`. It can be opened in
+ * chrome://tracing or Perfetto.
+ */
+int glrProfilerActive();
+
+/**
+ * @brief Begin a CPU scope. Scopes can be nested.
+ *
+ * @param name The scope name. Only the pointer is stored, so it should be a string literal.
+ */
+void glrProfileBegin(const char *name);
+
+/**
+ * @brief End the innermost CPU scope.
+ */
+void glrProfileEnd();
+
+/**
+ * @brief Begin a GPU scope. Scopes can be nested.
+ *
+ * It is measured with timestamp queries which are read back a few frames later, so it never stalls the pipeline.
+ *
+ * @param name The scope name. Only the pointer is stored, so it should be a string literal.
+ */
+void glrProfileGpuBegin(const char *name);
+
+/**
+ * @brief End the innermost GPU scope.
+ */
+void glrProfileGpuEnd();
+
+/**
+ * @brief Mark the frame boundary and collect finished GPU scopes. It is called by `glrSwapBuffers`.
+ */
+void glrProfileFrame();
+
+/**
+ * @brief Write the recorded scopes as Chrome trace JSON.
+ * @return 0 on success or -1 on failure.
+ */
+int glrProfileWriteTrace(const char *filename);
+
+/**
+ * @brief Write the trace if enabled and release the profiler. It is called by `glrTeardown`.
+ */
+void glrProfilerShutdown();
+
+/**
+ * @brief Render statistics counters.
+ *
+ * glr functions always count their own GL work. GL calls in chapters are counted when they are compiled with
+ * `GLR_STATS_WRAP`, which redirects the counted entry points to the `glrStats*` wrappers below.
+ */
+typedef struct GlrStats
+{
+  GLuint64 drawCalls;
+  GLuint64 triangles;
+  // Number of glUseProgram calls that change the program
+  GLuint64 programSwitches;
+  GLuint64 vaoBinds;
+  GLuint64 textureBinds;
+  // Number of glBindFramebuffer calls for drawing
+  GLuint64 framebufferBinds;
+  GLuint64 uniformCalls;
+  GLuint64 uniformBytes;
+  // Bytes uploaded into buffers and textures
+  GLuint64 uploadBytes;
+} GlrStats;
+
+/**
+ * @brief Get the counters of the current frame for updating.
+ */
+GlrStats *glrStats();
+
+/**
+ * @brief Get the counters of the last finished frame.
+ */
+const GlrStats *glrStatsLastFrame();
+
+/**
+ * @brief Get the counters summed over all finished frames.
+ */
+const GlrStats *glrStatsTotal();
+
+/**
+ * @brief Get the number of finished frames.
+ */
+GLuint64 glrStatsFrames();
+
+/**
+ * @brief Count a draw call of `count` vertices.
+ */
+void glrStatsCountDraw(GLenum mode, GLsizei count);
+
+/**
+ * @brief Finish the counters of the current frame. It is called by `glrSwapBuffers`.
+ */
+void glrStatsEndFrame();
+
+/**
+ * @brief Print the counters to stderr when the environment variable `GLR_STATS=1` is set. It is called by
+ * `glrTeardown`.
+ */
+void glrStatsDump();
+
+void GLAPIENTRY glrStatsDrawArrays(GLenum mode, GLint first, GLsizei count);
+void GLAPIENTRY glrStatsDrawElements(GLenum mode, GLsizei count, GLenum type, const void *indices);
+void GLAPIENTRY glrStatsUseProgram(GLuint program);
+void GLAPIENTRY glrStatsBindVertexArray(GLuint array);
+void GLAPIENTRY glrStatsBindTexture(GLenum target, GLuint texture);
+void GLAPIENTRY glrStatsBindFramebuffer(GLenum target, GLuint framebuffer);
+void GLAPIENTRY glrStatsUniform1i(GLint location, GLint v0);
+void GLAPIENTRY glrStatsUniform1f(GLint location, GLfloat v0);
+void GLAPIENTRY glrStatsUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2);
+void GLAPIENTRY glrStatsUniform3fv(GLint location, GLsizei count, const GLfloat *value);
+void GLAPIENTRY glrStatsUniform4fv(GLint location, GLsizei count, const GLfloat *value);
+void GLAPIENTRY glrStatsUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value);
+void GLAPIENTRY glrStatsUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value);
+void GLAPIENTRY glrStatsBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage);
+void GLAPIENTRY glrStatsBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data);
+void GLAPIENTRY glrStatsTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels);
+
+typedef enum GlrMemoryCategory
+{
+  // Vertex and index buffers
+  GLR_MEMORY_GEOMETRY,
+  // Buffers rewritten every frame
+  GLR_MEMORY_STREAMING,
+  // Material textures
+  GLR_MEMORY_TEXTURES,
+  // Textures drawn into, such as G-buffers, shadow maps and post-processing targets
+  GLR_MEMORY_RENDER_TARGETS,
+  GLR_MEMORY_CATEGORIES
+} GlrMemoryCategory;
+
+typedef struct GlrMemoryAllocation
+{
+  GLuint name;
+  int isTexture;
+  GlrMemoryCategory category;
+  // What created the object
+  const char *owner;
+  // Internal format of a texture, GL_NONE for a buffer
+  GLenum format;
+  // Texture size, or the buffer size in bytes by 1 by 1
+  int width;
+  int height;
+  int layers;
+  GLuint64 bytes;
+} GlrMemoryAllocation;
+
+/**
+ * @brief GPU memory of the tracked buffers and textures, in bytes
+ */
+typedef struct GlrMemoryStats
+{
+  GLuint64 bytes;
+  GLuint64 peakBytes;
+  GLuint64 categoryBytes[GLR_MEMORY_CATEGORIES];
+  GLuint64 categoryPeakBytes[GLR_MEMORY_CATEGORIES];
+  GLuint allocations;
+} GlrMemoryStats;
+
+/**
+ * @brief Record the storage of a buffer. Tracking a buffer again replaces its size.
+ *
+ * glr tracks every buffer and texture it creates, applications can track theirs too.
+ */
+void glrTrackBuffer(GLuint buffer, GLsizeiptr size, GlrMemoryCategory category, const char *owner);
+
+/**
+ * @brief Record the storage of a texture after its images are specified, queried from the GL level by level.
+ *
+ * The texture bound to target before the call is bound again afterwards.
+ */
+void glrTrackTexture(GLenum target, GLuint texture, GlrMemoryCategory category, const char *owner);
+
+void glrUntrackBuffer(GLuint buffer);
+void glrUntrackTexture(GLuint texture);
+
+const GlrMemoryStats *glrMemoryStats();
+
+/**
+ * @brief Get the tracked allocations.
+ *
+ * @return The number of allocations
+ */
+GLuint glrMemoryAllocations(const GlrMemoryAllocation **allocations);
+
+/**
+ * @brief Warn on stderr whenever the tracked memory grows over bytes. The environment variable
+ * `GLR_MEMORY_BUDGET=<MiB>` sets it too.
+ */
+void glrSetMemoryBudget(GLuint64 bytes);
+
+/**
+ * @brief Print the current and peak memory per category and the allocations never freed to stderr when the
+ * environment variable `GLR_MEMORY=1` is set. It is called by `glrTeardown`.
+ */
+void glrMemoryDump();
+
+/**
+ * @brief Forget the tracked allocations and free their list. It is called by `glrTeardown` after `glrMemoryDump`.
+ */
+void glrMemoryShutdown();
+
+typedef struct GlrShaderFile
+{
+  // Shader type passed to glCreateShader
+  GLenum type;
+  const char *filename;
+} GlrShaderFile;
+
+/**
+ * @brief Called after a watched program has been reloaded.
+ *
+ * Uniform locations may change after relinking, query them again in the callback.
+ *
+ * @param error The error message or NULL on success. The memory is owned by glr. The old program is kept on error.
+ */
+typedef void (*GlrProgramReloadCallback)(GLuint program, const GLchar *error, void *ctx);
+
+/**
+ * @brief Watch the shader files of the program and reload it when any of them changes.
+ *
+ * The program is recompiled and relinked in place by `glrPollShaderChanges`, so its name stays valid. It is only
+ * supported on Linux via inotify.
+ *
+ * @param files Shader files linked into the program. They are copied.
+ * @param onReload Optional callback. Errors are printed to stderr when it is NULL.
+ * @return 0 on success or -1 on failure.
+ */
+int glrWatchProgram(GLuint program, const GlrShaderFile *files, GLsizei len, GlrProgramReloadCallback onReload, void *ctx);
+
+/**
+ * @brief Reload watched programs whose shader files have changed. Call it once per frame.
+ *
+ * It never blocks when there are no changes.
+ *
+ * @return The number of programs reloaded successfully.
+ */
+GLsizei glrPollShaderChanges();
+
+/**
+ * @brief Stop watching all programs. It is called by `glrTeardown`.
+ */
+void glrUnwatchAll();
+
+typedef void (*GlrLoadTextureCallback)(GLuint texture, const char *filename);
+
+/**
+ * @brief Load the model from the file.
+ *
+ * Not thread-safe or reentrant: the temporaries of every load share one arena, which is reset when a load ends, and
+ * the load uploads to the current context and records profiler scopes. Call it from the thread owning the context,
+ * and not from loadTexture.
+ */
+GlrModel *glrLoadModel(char *filename, GlrLoadTextureCallback loadTexture);
+
+/**
+ * @brief Bind buffers for the model.
+ */
+void glrBindModel(GlrModel *model);
+
+/**
+ * @brief Draw the model.
+ */
+void glrDrawModel(GlrModel *model, GlrModelMaterialUniforms *uniforms);
+
+/**
+ * @brief Get the world space axis-aligned box enclosing the model's bounding box transformed by a column-major mat4.
+ */
+void glrModelBounds(const GlrModel *model, const float transform[16], float center[3], float extent[3]);
+
+/**
+ * @brief Free the resources allocated for the model
+ */
+void glrFreeModel(GlrModel *model);
+
+/**
+ * @brief Free the arena `glrLoadModel` reuses for its temporaries. It is called by `glrTeardown`.
+ */
+void glrModelShutdown();
+
+/**
+ * @brief A draw submitted to a render queue
+ */
+typedef struct GlrDrawItem
+{
+  GLuint program;
+  GLuint vao;
+  // Element buffer bound for indexed draws, or 0
+  GLuint ebo;
+  // Material bound to texture units 0 and 1, or NULL
+  const GlrModelMaterial *material;
+  // Uniforms the material is set to, or NULL if they are already set
+  const GlrModelMaterialUniforms *materialUniforms;
+
+  GLenum mode;
+  // Number of vertices, or indices for indexed draws
+  GLsizei count;
+  // First vertex of non-indexed draws
+  GLint first;
+  // Type of the indices like GL_UNSIGNED_INT, or 0 for non-indexed draws
+  GLenum indexType;
+  // Bytes-offset of the first index in the element buffer
+  void *indicesOffset;
+
+  // Column-major model matrix
+  float transform[16];
+  // Location of the model matrix, or -1
+  GLint modelLocation;
+  // Location of the mat3 inverse transpose of the model matrix, or -1
+  GLint normalMatrixLocation;
+  // Precomputed column-major mat3 for normalMatrixLocation, e.g. from `glrTransformNormal`, or NULL to compute it from
+  // the transform
+  const float *normalMatrix;
+
+  // Distance from the camera
+  float depth;
+  // Transparent items are drawn after opaque ones, back to front, with blending on and depth writes off. The blend
+  // function is left to the caller.
+  int isTransparent;
+
+  // Called after the state is bound and before the draw, to set per-item uniforms. It may be NULL.
+  void (*setUniforms)(const struct GlrDrawItem *item);
+  void *userData;
+} GlrDrawItem;
+
+/**
+ * @brief Draw items sorted by 64-bit keys to minimize state changes
+ *
+ * Opaque items are ordered by program, material and VAO, then front to back. Transparent items follow back to front.
+ */
+typedef struct GlrRenderQueue
+{
+  GlrDrawItem *items;
+  GLuint itemsLen;
+  GLuint itemsCap;
+
+  // Sort keys and item indices, each with a second half for the radix sort
+  GLuint64 *keys;
+  GLuint *order;
+  // Item indices in draw order, or NULL if not sorted
+  GLuint *sorted;
+} GlrRenderQueue;
+
+GlrRenderQueue *glrCreateRenderQueue();
+
+/**
+ * @brief Copy a draw item into the queue.
+ */
+void glrPushDrawItem(GlrRenderQueue *queue, const GlrDrawItem *item);
+
+/**
+ * @brief Push a draw item per batch of a bound model.
+ *
+ * The VAO, element buffer, material and draw range of `item` are replaced by those of each batch.
+ */
+void glrPushModel(GlrRenderQueue *queue, GlrModel *model, const GlrDrawItem *item);
+
+/**
+ * @brief Sort the items by their keys with a radix sort.
+ */
+void glrSortRenderQueue(GlrRenderQueue *queue);
+
+/**
+ * @brief Draw the items in sorted order, or in submission order if not sorted, skipping redundant state changes.
+ */
+void glrDrawRenderQueue(GlrRenderQueue *queue);
+
+/**
+ * @brief Remove all items, keeping the memory for the next frame.
+ */
+void glrClearRenderQueue(GlrRenderQueue *queue);
+
+void glrFreeRenderQueue(GlrRenderQueue *queue);
+
+/**
+ * @brief Transforms of many objects in structure-of-arrays layout
+ *
+ * Objects are set by position, rotation and scale. `glrUpdateTransforms` computes the world and normal matrices of
+ * the objects changed since the last update in SIMD batches, so static objects cost nothing per frame.
+ */
+typedef struct GlrTransforms
+{
+  GLuint len;
+  // Capacity of every array, a multiple of the SIMD batch size
+  GLuint cap;
+
+  // x, y and z components
+  float *position[3];
+  // Unit quaternion x, y, z and w components, in the layout of cglm's versor
+  float *rotation[4];
+  // x, y and z components
+  float *scale[3];
+  unsigned char *isDirty;
+
+  // Column-major mat4 world matrices, 16 floats per object
+  float *world;
+  // Column-major mat3 normal matrices, 9 floats per object
+  float *normal;
+} GlrTransforms;
+
+GlrTransforms *glrCreateTransforms();
+
+/**
+ * @brief Add an object, NULL components are the identity.
+ * @return The index of the object
+ */
+GLuint glrAddTransform(GlrTransforms *transforms, const float position[3], const float rotation[4], const float scale[3]);
+
+/**
+ * @brief Change an object and mark it dirty, NULL components are unchanged.
+ */
+void glrSetTransform(GlrTransforms *transforms, GLuint index, const float position[3], const float rotation[4], const float scale[3]);
+
+/**
+ * @brief Compute the matrices of the dirty objects.
+ *
+ * Scale components must not be 0 for the normal matrix.
+ *
+ * @return The number of objects computed
+ */
+GLuint glrUpdateTransforms(GlrTransforms *transforms);
+
+/**
+ * @brief Get the world matrix of an object as of the last update.
+ */
+const float *glrTransformWorld(const GlrTransforms *transforms, GLuint index);
+
+/**
+ * @brief Get the normal matrix of an object as of the last update.
+ */
+const float *glrTransformNormal(const GlrTransforms *transforms, GLuint index);
+
+void glrFreeTransforms(GlrTransforms *transforms);
+
+/**
+ * @brief Called by `glrParallelFor` with a range of indices [begin, end).
+ */
+typedef void (*GlrParallelForCallback)(GLuint begin, GLuint end, void *ctx);
+
+/**
+ * @brief Get the number of threads running `glrParallelFor`, including the calling thread.
+ *
+ * It is the number of CPUs, or the `GLR_THREADS` environment variable if set.
+ */
+int glrThreadCount();
+
+/**
+ * @brief Call `callback` for chunks of `grain` indices in [0, count) on the thread pool and wait for all of them.
+ *
+ * The calling thread runs chunks too. Chunks run in any order, and concurrently, so the callback must only write
+ * data owned by its range. A call from inside a callback runs all of its chunks inline on the calling thread, and calls
+ * from different threads take turns.
+ */
+void glrParallelFor(GLuint count, GLuint grain, GlrParallelForCallback callback, void *ctx);
+
+/**
+ * @brief Stop the thread pool. It is called by `glrTeardown`.
+ */
+void glrThreadsShutdown();
+
+/**
+ * @brief Bounding volumes of many objects in structure-of-arrays layout
+ *
+ * The centers can be the positions of a `GlrTransforms`.
+ */
+typedef struct GlrBounds
+{
+  const float *x;
+  const float *y;
+  const float *z;
+  // Bounding sphere radii, or NULL for axis-aligned boxes
+  const float *radius;
+  // Box half extents, used when radius is NULL
+  const float *extentX;
+  const float *extentY;
+  const float *extentZ;
+  GLuint len;
+} GlrBounds;
+
+/**
+ * @brief Extract the normalized view frustum planes from a column-major view projection matrix.
+ *
+ * Each plane is a, b, c, d with the normal pointing inside, in the order left, right, bottom, top, near, far.
+ */
+void glrFrustumPlanes(const float viewProjection[16], float planes[6][4]);
+
+/**
+ * @brief Find the objects intersecting the frustum.
+ *
+ * Objects are tested 8 at a time with AVX or 4 at a time with SSE, large counts are split across `glrParallelFor`.
+ *
+ * @param visible Receives the indices of the visible objects in ascending order, room for `bounds->len` indices
+ * @return The number of visible objects
+ */
+GLuint glrCullFrustum(const float planes[6][4], const GlrBounds *bounds, GLuint *visible);
+
+/**
+ * @brief A low resolution depth buffer that occluders are rasterized into on the CPU
+ *
+ * Each frame, clear it with the view projection, add the occluders, rasterize them and cull objects against it.
+ * Occluders should be a few large, low-poly meshes or boxes inside the objects they stand for.
+ */
+typedef struct GlrOcclusionBuffer
+{
+  // Size in pixels, rounded up to whole tiles
+  int width;
+  int height;
+  // Depth in [0, 1] of each pixel, 1 is far, rows from the bottom
+  float *depth;
+  // Farthest depth of each tile
+  float *tileMax;
+  float viewProjection[16];
+
+  // Screen space triangles added since the last clear
+  float *triangles;
+  GLuint trianglesLen;
+  GLuint trianglesCap;
+} GlrOcclusionBuffer;
+
+GlrOcclusionBuffer *glrCreateOcclusionBuffer(int width, int height);
+
+/**
+ * @brief Remove all occluders and set the view projection of the next frame.
+ */
+void glrClearOcclusionBuffer(GlrOcclusionBuffer *buffer, const float viewProjection[16]);
+
+/**
+ * @brief Add the triangles of an indexed mesh as occluders.
+ * @param stride Bytes between consecutive positions
+ * @param transform The column-major model matrix, or NULL for world space positions
+ */
+void glrAddOccluderMesh(
+    GlrOcclusionBuffer *buffer,
+    const float *positions,
+    size_t stride,
+    const GLuint *indices,
+    GLuint indicesLen,
+    const float transform[16]);
+
+/**
+ * @brief Add the triangles of a model, usually a low-poly LOD, as occluders.
+ */
+void glrAddOccluderModel(GlrOcclusionBuffer *buffer, const GlrModel *model, const float transform[16]);
+
+/**
+ * @brief Add a box from min to max in model space as an occluder.
+ */
+void glrAddOccluderBox(GlrOcclusionBuffer *buffer, const float min[3], const float max[3], const float transform[16]);
+
+/**
+ * @brief Rasterize the occluders into the depth buffer on the thread pool.
+ */
+void glrRasterizeOccluders(GlrOcclusionBuffer *buffer);
+
+/**
+ * @brief Remove the objects hidden behind the occluders from a list of object indices.
+ *
+ * Objects are tested by the screen rectangle and nearest depth of their bounding box. The list is usually the output
+ * of `glrCullFrustum`.
+ *
+ * @param visible The indices into bounds to test, it receives the visible ones in the same order
+ * @return The number of visible objects
+ */
+GLuint glrCullOcclusion(const GlrOcclusionBuffer *buffer, const GlrBounds *bounds, GLuint *visible, GLuint visibleLen);
+
+void glrFreeOcclusionBuffer(GlrOcclusionBuffer *buffer);
+
+/**
+ * @brief GPU occlusion queries of bounding box proxies, one per object
+ *
+ * After drawing the frame, `glrIssueOcclusionQueries` tests the proxies against its depth. Draws of the next frame
+ * wrapped in `glrBeginConditionalDraw` are skipped by the GPU when the proxy was hidden, without waiting for the
+ * result on the CPU. Results are a frame late, so an object can appear one frame after it is revealed.
+ */
+typedef struct GlrOcclusionQueries
+{
+  GLuint len;
+  GLuint *queries;
+  // Whether each query has been issued, objects without a query are drawn unconditionally
+  unsigned char *isIssued;
+  // `GL_ANY_SAMPLES_PASSED_CONSERVATIVE` when supported, otherwise `GL_ANY_SAMPLES_PASSED`
+  GLenum target;
+
+  GLuint program;
+  GLint viewProjectionLocation;
+  GLint centerLocation;
+  GLint extentLocation;
+  GLuint vao;
+  GLuint vbo;
+  GLuint ebo;
+} GlrOcclusionQueries;
+
+/**
+ * @brief Create the queries of len objects.
+ * @param error The output param to receive the error on failure. The caller is responsible for freeing the memory.
+ * @return The queries or NULL on failure
+ */
+GlrOcclusionQueries *glrCreateOcclusionQueries(GLuint len, const GLchar **error);
+
+/**
+ * @brief Test the bounds of the objects against the current depth buffer.
+ *
+ * Call it after the frame is drawn. Objects crossing the near plane get no query and are drawn next frame. It leaves
+ * the proxy program in use.
+ */
+void glrIssueOcclusionQueries(GlrOcclusionQueries *queries, const float viewProjection[16], const GlrBounds *bounds);
+
+/**
+ * @brief Skip the following draws on the GPU if the object was hidden when its query was issued.
+ */
+void glrBeginConditionalDraw(GlrOcclusionQueries *queries, GLuint index);
+
+void glrEndConditionalDraw(GlrOcclusionQueries *queries, GLuint index);
+
+/**
+ * @brief Draw the model unless the object was hidden, see `glrBeginConditionalDraw`.
+ */
+void glrDrawModelConditional(GlrOcclusionQueries *queries, GLuint index, GlrModel *model, GlrModelMaterialUniforms *uniforms);
+
+void glrFreeOcclusionQueries(GlrOcclusionQueries *queries);
+
+#define GLR_MAX_CASCADES 4
+
+/**
+ * @brief Cascaded shadow maps of a directional light
+ *
+ * The camera frustum is split by view distance, and each cascade renders one split into a layer of a depth texture
+ * array. Near cascades cover less of the scene, so the shadow texel density follows the camera.
+ */
+typedef struct GlrShadowCascades
+{
+  int cascadesLen;
+  // Width and height of each layer in texels
+  int resolution;
+  // Weight of logarithmic against uniform split distances, 0.75 by default
+  float splitLambda;
+  // `GL_TEXTURE_2D_ARRAY` of depth with a layer per cascade, set up for a `sampler2DArrayShadow`
+  GLuint texture;
+  GLuint framebuffer;
+
+  // View distance of the far end of each cascade, a fragment uses the first cascade it is closer than
+  float splits[GLR_MAX_CASCADES];
+  // Column-major light view projection of each cascade
+  float viewProjections[GLR_MAX_CASCADES][16];
+
+  // Frames between the updates of each cascade rendered by `glrRenderShadowCascades`, distant cascades update less
+  // often. 1, 1, 2 and 4 by default. A cascade updates early when the camera moves its split out of the fitted box.
+  int updateIntervals[GLR_MAX_CASCADES];
+  // Whether a cascade was fitted again by the last update and has to be rendered
+  unsigned char isDue[GLR_MAX_CASCADES];
+  GLuint64 frame;
+
+  // Depth of the static casters of each cascade, kept while the light and the static geometry stay the same
+  GLuint staticTexture;
+  GLuint readFramebuffer;
+  unsigned char isCached[GLR_MAX_CASCADES];
+  // The view projections the static depth was rendered with
+  float cachedViewProjections[GLR_MAX_CASCADES][16];
+  float lightDirection[3];
+} GlrShadowCascades;
+
+/**
+ * @brief Render the casters of a shadow map with viewProjection into the bound framebuffer.
+ */
+typedef void (*GlrShadowCastersCallback)(const float viewProjection[16], void *ctx);
+
+/**
+ * @brief Create cascadesLen, up to `GLR_MAX_CASCADES`, shadow maps of resolution x resolution texels.
+ */
+GlrShadowCascades *glrCreateShadowCascades(int cascadesLen, int resolution);
+
+/**
+ * @brief Split the camera frustum and fit the light projection of the cascades due this frame.
+ *
+ * Each box is fitted to its split and the scene bounds, it is sized in coarse steps and snapped to whole texels, so
+ * shadows do not shimmer when the camera moves. Cascades that are not due keep their last view projection. A change
+ * of the light direction invalidates the static cache.
+ *
+ * @param view The rigid column-major camera view matrix
+ * @param projection The column-major perspective projection of the camera
+ * @param lightDirection The direction the light shines in
+ * @param sceneMin The world space box enclosing all shadow casters and receivers
+ */
+void glrUpdateShadowCascades(
+    GlrShadowCascades *cascades,
+    const float view[16],
+    const float projection[16],
+    const float lightDirection[3],
+    const float sceneMin[3],
+    const float sceneMax[3]);
+
+/**
+ * @brief Bind and clear the layer of a cascade for rendering the casters with its view projection.
+ */
+void glrBeginShadowCascade(GlrShadowCascades *cascades, int index);
+
+/**
+ * @brief Bind the default framebuffer again, the caller restores the viewport.
+ */
+void glrEndShadowCascades(GlrShadowCascades *cascades);
+
+/**
+ * @brief Render the cascades due this frame from the static cache and the dynamic casters.
+ *
+ * The static casters are only rendered into the cache when it is invalid or the cascade moved. A move by whole texels
+ * scrolls the cached depth and renders just the uncovered strips. The cached depth is then copied into the shadow map
+ * and the dynamic casters are rendered on top. Binds the default framebuffer afterwards, the caller restores the
+ * viewport.
+ *
+ * @param renderDynamic May be NULL when all casters are static
+ */
+void glrRenderShadowCascades(
+    GlrShadowCascades *cascades,
+    GlrShadowCastersCallback renderStatic,
+    GlrShadowCastersCallback renderDynamic,
+    void *ctx);
+
+/**
+ * @brief Render the static casters of all cascades again, when the static geometry changed.
+ */
+void glrInvalidateShadowCascades(GlrShadowCascades *cascades);
+
+/**
+ * @brief Upload the view projections as a `mat4[]` and the splits as a `float[]` uniform of the current program.
+ */
+void glrShadowCascadesUniforms(GlrShadowCascades *cascades, GLint viewProjectionsLocation, GLint splitsLocation);
+
+void glrFreeShadowCascades(GlrShadowCascades *cascades);
+
+// Frames the CPU may write ahead of the GPU
+#define GLR_RING_FRAMES 3
+
+/**
+ * @brief A streaming buffer for data written every frame, such as instance data, uniforms and dynamic vertices
+ *
+ * With GL 4.4 or ARB_buffer_storage the buffer is persistently and coherently mapped. Each of the last
+ * GLR_RING_FRAMES frames owns a part of it, and a fence per frame keeps the CPU from writing into a part the GPU still
+ * reads. Otherwise each write is mapped unsynchronized behind the previous ones, and the buffer is orphaned when it
+ * is full.
+ *
+ * The buffer can be bound to any target with the offsets the writes return.
+ */
+typedef struct GlrRingBuffer
+{
+  GLuint buffer;
+  // Bytes a frame can write, and the size of the buffer
+  GLsizeiptr frameSize;
+  GLsizeiptr size;
+  int isPersistent;
+  unsigned char *mapped;
+
+  // The next free byte, within the part of the current frame when persistent
+  GLsizeiptr head;
+  int frame;
+  // Whether the fence of the current frame's part has been waited on
+  int isFrameReady;
+  GLsync fences[GLR_RING_FRAMES];
+} GlrRingBuffer;
+
+/**
+ * @brief Create a ring of GLR_RING_FRAMES parts of frameSize bytes.
+ *
+ * It is mapped persistently with GL 4.4 or ARB_buffer_storage, and falls back to mapping each write when that fails.
+ */
+GlrRingBuffer *glrCreateRingBuffer(GLsizeiptr frameSize);
+
+/**
+ * @brief Get size bytes to write this frame, then call `glrUnmapRing` before drawing with them.
+ *
+ * @param alignment The alignment of the offset, such as GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT for uniform blocks
+ * @param offset Receives the offset of the bytes in the buffer
+ * @return The bytes, or NULL when they do not fit into the rest of the frame's part of a persistent buffer, or into
+ * the whole buffer otherwise, or when mapping the buffer fails. Nothing is left to unmap after NULL.
+ */
+void *glrMapRing(GlrRingBuffer *ring, GLsizeiptr size, GLsizeiptr alignment, GLintptr *offset);
+
+/**
+ * @brief Finish a write, nothing to do when the buffer is persistently mapped.
+ */
+void glrUnmapRing(GlrRingBuffer *ring);
+
+/**
+ * @brief Fence the writes of the frame after its last draw using them, and move on to the next frame.
+ */
+void glrRingEndFrame(GlrRingBuffer *ring);
+
+void glrFreeRingBuffer(GlrRingBuffer *ring);
+
+/**
+ * @brief A directional light, shading every pixel
+ */
+typedef struct GlrDirectionalLight
+{
+  // The direction the light shines in
+  float direction[3];
+  float ambient[3];
+  float diffuse[3];
+  float specular[3];
+} GlrDirectionalLight;
+
+/**
+ * @brief A point light, or a spot light when it has a direction
+ */
+typedef struct GlrLight
+{
+  float position[3];
+  float ambient[3];
+  float diffuse[3];
+  float specular[3];
+  // Attenuation 1 / (constant + linear * d + quadratic * d^2) at distance d
+  float constant;
+  float linear;
+  float quadratic;
+  // The direction a spot light shines in, zero for a point light
+  float direction[3];
+  // Cosines of the angles of the full and the faded cone of a spot light
+  float cutOff;
+  float outerCutOff;
+} GlrLight;
+
+/**
+ * @brief Get the distance at which a light fades below 5/256 of its brightest color, its light volume.
+ *
+ * A light without attenuation, or one reaching further, gets a radius of 1e6, so its volume covers the far plane and
+ * stays finite for the volume and cluster math.
+ */
+float glrLightRadius(const GlrLight *light);
+
+// vec4s of a packed light
+#define GLR_LIGHT_VEC4S 6
+
+/**
+ * @brief Pack a light into 6 vec4s for a shader: position and radius, ambient and constant, diffuse and linear,
+ * specular and quadratic, direction and cut off, outer cut off.
+ */
+void glrPackLight(const GlrLight *light, float radius, float packed[GLR_LIGHT_VEC4S * 4]);
+
+/**
+ * @brief The lights reaching each object of a scene, for forward shading with a few lights per draw
+ *
+ * Each light's sphere of `glrLightRadius` is tested against the object bounds. When more lights than
+ * maxLightsPerObject reach an object, the ones brightest at its closest point are kept.
+ */
+typedef struct GlrObjectLights
+{
+  GLuint maxLightsPerObject;
+
+  // The light list of each object at maxLightsPerObject apart, and the brightness each light was kept for
+  GLuint *counts;
+  GLuint *indices;
+  float *scores;
+  GLuint objectsLen;
+  GLuint objectsCap;
+
+  // x, y, z and radius of the lights at lightsCap apart, and the packed lights
+  float *spheres;
+  float *packed;
+  GLuint lightsLen;
+  GLuint lightsCap;
+
+  // The packed lights of one object for the upload
+  float *uniformData;
+} GlrObjectLights;
+
+GlrObjectLights *glrCreateObjectLights(GLuint maxLightsPerObject);
+
+/**
+ * @brief Find the lights reaching each object.
+ *
+ * The lights are tested 8 at a time with AVX or 4 at a time with SSE, and the objects are spread over
+ * `glrParallelFor`. The lights must stay alive until the next assignment.
+ */
+void glrAssignObjectLights(
+    GlrObjectLights *objectLights,
+    const GlrLight *lights,
+    GLuint lightsLen,
+    const GlrBounds *bounds);
+
+/**
+ * @brief Upload the lights of an object to the current program.
+ *
+ * @param countLocation An `int` uniform receiving the number of lights
+ * @param lightsLocation A `vec4` array uniform of 6 * maxLightsPerObject receiving the lights packed by `glrPackLight`
+ */
+void glrObjectLightsUniforms(GlrObjectLights *objectLights, GLuint object, GLint countLocation, GLint lightsLocation);
+
+void glrFreeObjectLights(GlrObjectLights *objectLights);
+
+typedef struct GlrGBufferLocations
+{
+  GLint inverseViewProjection;
+  GLint viewPos;
+} GlrGBufferLocations;
+
+/**
+ * @brief A G-buffer and the light volume passes of deferred shading
+ *
+ * The geometry pass writes the surfaces of the scene into the G-buffer once, then every light only shades the
+ * pixels inside its volume. The fragment shader of the geometry pass writes
+ *
+ * - `layout (location = 0) out vec4` the diffuse color in rgb,
+ * - `layout (location = 1) out vec4` the specular color in rgb and the shininess / 256 in a,
+ * - `layout (location = 2) out vec4` the world space normal in xyz.
+ */
+typedef struct GlrDeferred
+{
+  int width;
+  int height;
+
+  // G-buffer textures, the position is reconstructed from the depth
+  GLuint albedo;
+  GLuint specular;
+  GLuint normal;
+  GLuint depth;
+  GLuint framebuffer;
+  // HDR sum of the lights, with the depth of the G-buffer
+  GLuint light;
+  GLuint lightFramebuffer;
+
+  GLuint directionalProgram;
+  GlrGBufferLocations directionalLocations;
+  GLint directionLocation;
+  GLint ambientLocation;
+  GLint diffuseLocation;
+  GLint specularLocation;
+  GLuint emptyVao;
+
+  GLuint volumeProgram;
+  GlrGBufferLocations volumeLocations;
+  GLint viewProjectionLocation;
+  GLint screenSizeLocation;
+  GLuint sphereVao;
+  GLuint sphereVbo;
+  GLuint sphereEbo;
+  // Instance data of the lights, written straight into the ring every frame
+  GlrRingBuffer *lightsRing;
+} GlrDeferred;
+
+/**
+ * @brief Create a G-buffer of width x height pixels and compile the lighting programs.
+ */
+GlrDeferred *glrCreateDeferred(int width, int height, const GLchar **error);
+
+/**
+ * @brief Bind and clear the G-buffer for the geometry pass.
+ */
+void glrBeginGeometryPass(GlrDeferred *deferred);
+
+/**
+ * @brief Shade the G-buffer into the light buffer, which stays bound for forward passes.
+ *
+ * The light buffer is cleared with the current clear color first. The directional light, if any, shades the whole
+ * screen, then each point and spot light draws the back faces of its sphere in a single instanced draw call and adds
+ * up with the others. When the lights cannot be mapped into their ring buffer, the volumes are skipped and the failure
+ * is printed to stderr once.
+ *
+ * @param viewProjection The column-major view projection of the geometry pass
+ * @param viewPosition The camera position in world space
+ */
+void glrDrawDeferredLights(
+    GlrDeferred *deferred,
+    const float viewProjection[16],
+    const float viewPosition[3],
+    const GlrDirectionalLight *directionalLight,
+    const GlrLight *lights,
+    GLuint lightsLen);
+
+/**
+ * @brief Copy the light buffer to the default framebuffer and bind it.
+ */
+void glrPresentDeferred(GlrDeferred *deferred);
+
+void glrFreeDeferred(GlrDeferred *deferred);
+
+// Clusters across the screen and exponential slices along the view depth
+#define GLR_CLUSTERS_X 16
+#define GLR_CLUSTERS_Y 9
+#define GLR_CLUSTERS_Z 24
+
+/**
+ * @brief Lights assigned to clusters of the view frustum for forward shading
+ *
+ * A fragment finds its cluster from its screen position and view depth and only loops over the lights reaching into
+ * it. The fragment shader reads three texture buffers:
+ *
+ * - `samplerBuffer` lights, GLR_LIGHT_VEC4S texels per light packed by `glrPackLight`.
+ * - `usamplerBuffer` grid, the offset and count of the light indices of each cluster, cluster
+ *   (z * GLR_CLUSTERS_Y + y) * GLR_CLUSTERS_X + x.
+ * - `usamplerBuffer` indices, the light indices.
+ *
+ * The slice of view depth d is floor(log(d / near) / log(far / near) * GLR_CLUSTERS_Z).
+ */
+typedef struct GlrLightClusters
+{
+  // Viewport size in pixels
+  int width;
+  int height;
+  // Lights beyond this per cluster are dropped
+  GLuint maxLightsPerCluster;
+
+  float near;
+  float far;
+  // View space x and y per view depth at the right and top edge
+  float unprojectX;
+  float unprojectY;
+
+  GLuint lightsBuffer;
+  GLuint lightsTexture;
+  GLuint gridBuffer;
+  GLuint gridTexture;
+  GLuint indicesBuffer;
+  GLuint indicesTexture;
+
+  // The light list of each cluster at maxLightsPerCluster apart, packed into indices for the upload
+  GLuint *clusterCounts;
+  GLuint *clusterLights;
+  GLuint *grid;
+  GLuint *indices;
+  GLuint indicesLen;
+
+  // View space x, y, depth and radius of each light, and of the lights reaching into each slice
+  float *viewLights;
+  float *candidates;
+  GLuint *candidateIndices;
+  GLuint lightsLen;
+  GLuint lightsCap;
+} GlrLightClusters;
+
+/**
+ * @brief Create the clusters of a width x height viewport with up to maxLightsPerCluster lights each.
+ *
+ * The texture buffers are created by the first `glrUpdateLightClusters`.
+ */
+GlrLightClusters *glrCreateLightClusters(int width, int height, GLuint maxLightsPerCluster);
+
+/**
+ * @brief Assign the lights to the clusters into grid and indices without uploading them.
+ *
+ * Each light's sphere of `glrLightRadius` is tested against the view space box of each cluster, with SIMD over the
+ * lights and the depth slices spread over `glrParallelFor`. A cluster keeps the first maxLightsPerCluster lights
+ * touching it in index order. Needs no GL context.
+ *
+ * @param view The column-major camera view matrix
+ * @param projection The column-major symmetric perspective projection of the camera
+ */
+void glrAssignLightClusters(
+    GlrLightClusters *clusters,
+    const float view[16],
+    const float projection[16],
+    const GlrLight *lights,
+    GLuint lightsLen);
+
+/**
+ * @brief Assign the lights to the clusters with `glrAssignLightClusters` and upload the texture buffers.
+ */
+void glrUpdateLightClusters(
+    GlrLightClusters *clusters,
+    const float view[16],
+    const float projection[16],
+    const GlrLight *lights,
+    GLuint lightsLen);
+
+/**
+ * @brief Bind the lights, grid and indices texture buffers to units firstUnit to firstUnit + 2.
+ *
+ * The buffers exist after the first `glrUpdateLightClusters`.
+ */
+void glrBindLightClusters(GlrLightClusters *clusters, GLuint firstUnit);
+
+/**
+ * @brief Upload near, far, width and height as a `vec4` uniform of the current program.
+ */
+void glrLightClustersUniforms(GlrLightClusters *clusters, GLint paramsLocation);
+
+void glrFreeLightClusters(GlrLightClusters *clusters);
+
+/**
+ * @brief Get the pixel format and type `glTexImage2D` accepts for internalFormat.
+ *
+ * Integer formats map to the *_INTEGER pixel formats with GL_INT or GL_UNSIGNED_INT, depth and depth stencil formats
+ * to GL_DEPTH_COMPONENT and GL_DEPTH_STENCIL, and the other color formats to their components with GL_FLOAT.
+ */
+void glrPixelFormat(GLenum internalFormat, GLenum *format, GLenum *type);
+
+/**
+ * @brief Get the framebuffer attachment of internalFormat: GL_DEPTH_ATTACHMENT, GL_DEPTH_STENCIL_ATTACHMENT or
+ * GL_COLOR_ATTACHMENT0 for color formats.
+ */
+GLenum glrFormatAttachment(GLenum internalFormat);
+
+/**
+ * @brief Create an empty 2D render target texture of internalFormat, clamped to the edge and tracked for owner.
+ *
+ * Color and depth textures are filtered linearly so a smaller pass can downsample them, integer textures are
+ * filtered nearest since they are incomplete otherwise.
+ */
+GLuint glrCreateTargetTexture(GLenum internalFormat, int width, int height, const char *owner);
+
+/**
+ * @brief A pooled offscreen color target with an optional depth attachment
+ */
+typedef struct GlrRenderTarget
+{
+  int width;
+  int height;
+  GLenum colorFormat;
+  // GL_NONE without a depth attachment
+  GLenum depthFormat;
+  GLuint color;
+  GLuint depth;
+  GLuint framebuffer;
+  // The target returns to the pool when this drops to 0
+  int refs;
+} GlrRenderTarget;
+
+/**
+ * @brief Post-processing passes drawn as a fullscreen triangle between pooled render targets
+ *
+ * Targets are keyed by size and format and are kept across frames, so a chain of passes allocates only on its first
+ * frame. A pass releasing its source before the next one acquires a target ping-pongs between the same two.
+ */
+typedef struct GlrPostProcess
+{
+  // Full resolution in pixels
+  int width;
+  int height;
+
+  // Attach this to the program of each pass. It outputs `vec2 TexCoords`, the fragment shader samples its source
+  // from texture unit 0.
+  GLuint vertexShader;
+  GLuint emptyVao;
+
+  GlrRenderTarget **targets;
+  GLuint targetsLen;
+  GLuint targetsCap;
+} GlrPostProcess;
+
+GlrPostProcess *glrCreatePostProcess(int width, int height, const GLchar **error);
+
+/**
+ * @brief Compile the vertex shader of a fullscreen triangle made from gl_VertexID into shader.
+ *
+ * It outputs `vec2 TexCoords` from 0 to 1 and needs no vertex attributes, draw 3 vertices with any vertex array.
+ *
+ * @return The error message or NULL if no error. The caller is responsible for freeing the memory.
+ */
+const GLchar *glrFullscreenVertexShader(GLuint shader);
+
+/**
+ * @brief Take a target of the full resolution divided by divisor from the pool, or create it.
+ *
+ * @param divisor 1 for full, 2 for half and 4 for quarter resolution
+ * @param depthFormat GL_NONE for a target without depth
+ */
+GlrRenderTarget *glrAcquireRenderTarget(GlrPostProcess *post, int divisor, GLenum colorFormat, GLenum depthFormat);
+
+void glrRetainRenderTarget(GlrRenderTarget *target);
+
+/**
+ * @brief Give a target back to the pool once it is no longer sampled.
+ */
+void glrReleaseRenderTarget(GlrRenderTarget *target);
+
+/**
+ * @brief Bind the framebuffer of a target and set the viewport to its size.
+ */
+void glrBindRenderTarget(GlrRenderTarget *target);
+
+/**
+ * @brief Draw a fullscreen triangle with program and source bound to texture unit 0 into target.
+ *
+ * @param target The target to draw into, NULL for the default framebuffer at full resolution
+ */
+void glrDrawPostPass(GlrPostProcess *post, GLuint program, GLuint source, GlrRenderTarget *target);
+
+/**
+ * @brief Acquire a target without depth and draw a pass into it.
+ *
+ * The caller releases the returned target after the passes reading it.
+ */
+GlrRenderTarget *glrPostPass(GlrPostProcess *post, GLuint program, GLuint source, int divisor, GLenum colorFormat);
+
+/**
+ * @brief Delete the targets that are not in use.
+ */
+void glrTrimRenderTargets(GlrPostProcess *post);
+
+/**
+ * @brief Change the full resolution, the targets not in use are deleted.
+ */
+void glrResizePostProcess(GlrPostProcess *post, int width, int height);
+
+void glrFreePostProcess(GlrPostProcess *post);
+
+// Resource of the default framebuffer in every render graph
+#define GLR_GRAPH_BACKBUFFER 0
+#define GLR_GRAPH_MAX_READS 8
+#define GLR_GRAPH_MAX_WRITES 4
+
+typedef void (*GlrGraphPassCallback)(void *ctx);
+
+typedef struct GlrGraphResource
+{
+  const GLchar *name;
+  int width;
+  int height;
+  GLenum format;
+  // Only GL_TEXTURE_2D resources are attached by the graph
+  GLenum target;
+  // The imported texture, or the texture a transient is aliased onto
+  GLuint texture;
+  int isImported;
+  // Index of the texture of a transient, and the first and last live passes using it, -1 when unused
+  int physical;
+  int firstPass;
+  int lastPass;
+} GlrGraphResource;
+
+// A texture shared by transients of the same size and format
+typedef struct GlrGraphPhysical
+{
+  int width;
+  int height;
+  GLenum format;
+  GLuint texture;
+  int lastPass;
+} GlrGraphPhysical;
+
+typedef struct GlrGraphPass
+{
+  const GLchar *name;
+  // Buffers cleared with the current clear values after binding
+  GLbitfield clear;
+  GlrGraphPassCallback execute;
+  void *ctx;
+  GLuint reads[GLR_GRAPH_MAX_READS];
+  GLuint readsLen;
+  GLuint writes[GLR_GRAPH_MAX_WRITES];
+  GLuint writesLen;
+
+  // Filled by `glrCompileRenderGraph`. The framebuffer is -1 for a pass binding its own.
+  int isLive;
+  GLuint framebuffer;
+  GLuint colors[GLR_GRAPH_MAX_WRITES];
+  GLuint colorsLen;
+  GLuint depth;
+  int viewportWidth;
+  int viewportHeight;
+} GlrGraphPass;
+
+/**
+ * @brief A frame described as passes reading and writing textures
+ *
+ * Declare the textures and the passes with their reads and writes in execution order once, compile, and execute every
+ * frame. Compiling:
+ *
+ * - culls the passes whose writes no kept pass reads. Passes writing the backbuffer or an imported texture are kept.
+ * - aliases transient textures of the same size and format whose live passes do not overlap onto one texture. The
+ *   first pass writing a transient must clear or overwrite it.
+ * - creates one framebuffer per set of attachments. Executing binds it only when it changes between passes, and sets
+ *   the viewport only when the size changes.
+ *
+ * Passes writing only textures that are not GL_TEXTURE_2D bind their own framebuffer.
+ */
+typedef struct GlrRenderGraph
+{
+  // Backbuffer size in pixels
+  int width;
+  int height;
+
+  GlrGraphResource *resources;
+  GLuint resourcesLen;
+  GLuint resourcesCap;
+  GlrGraphPass *passes;
+  GLuint passesLen;
+  GLuint passesCap;
+  GlrGraphPhysical *physicals;
+  GLuint physicalsLen;
+  GLuint physicalsCap;
+  GLuint *framebuffers;
+  GLuint framebuffersLen;
+  GLuint framebuffersCap;
+} GlrRenderGraph;
+
+GlrRenderGraph *glrCreateRenderGraph(int width, int height);
+
+/**
+ * @brief Declare a transient texture of the backbuffer size divided by divisor.
+ *
+ * @return The resource, its texture is known after compiling
+ */
+GLuint glrGraphCreateTexture(GlrRenderGraph *graph, const GLchar *name, int divisor, GLenum format);
+
+/**
+ * @brief Declare a texture owned outside the graph, such as a shadow map.
+ */
+GLuint glrGraphImportTexture(
+    GlrRenderGraph *graph,
+    const GLchar *name,
+    GLenum target,
+    GLuint texture,
+    int width,
+    int height,
+    GLenum format);
+
+/**
+ * @brief Add a pass run by execute with ctx, after the passes added before it.
+ *
+ * @return The pass for declaring its reads and writes
+ */
+GLuint glrGraphAddPass(GlrRenderGraph *graph, const GLchar *name, GLbitfield clear, GlrGraphPassCallback execute,
+                       void *ctx);
+
+void glrGraphRead(GlrRenderGraph *graph, GLuint pass, GLuint resource);
+
+/**
+ * @brief Declare a write. Color formats are attached in the order written, a depth format as the depth attachment.
+ */
+void glrGraphWrite(GlrRenderGraph *graph, GLuint pass, GLuint resource);
+
+/**
+ * @brief Get the texture of a resource for binding it in a pass.
+ */
+GLuint glrGraphTexture(const GlrRenderGraph *graph, GLuint resource);
+
+/**
+ * @brief Cull the passes, alias the transients and create the framebuffers. Compile again after changing the graph.
+ *
+ * @return NULL on success or the error message
+ */
+const GLchar *glrCompileRenderGraph(GlrRenderGraph *graph);
+
+/**
+ * @brief Run the kept passes, each inside a CPU and GPU profiler scope named after it.
+ */
+void glrExecuteRenderGraph(GlrRenderGraph *graph);
+
+void glrFreeRenderGraph(GlrRenderGraph *graph);
+
+#ifdef GLR_STATS_WRAP
+#undef glDrawArrays
+#define glDrawArrays glrStatsDrawArrays
+#undef glDrawElements
+#define glDrawElements glrStatsDrawElements
+#undef glUseProgram
+#define glUseProgram glrStatsUseProgram
+#undef glBindVertexArray
+#define glBindVertexArray glrStatsBindVertexArray
+#undef glBindTexture
+#define glBindTexture glrStatsBindTexture
+#undef glBindFramebuffer
+#define glBindFramebuffer glrStatsBindFramebuffer
+#undef glUniform1i
+#define glUniform1i glrStatsUniform1i
+#undef glUniform1f
+#define glUniform1f glrStatsUniform1f
+#undef glUniform3f
+#define glUniform3f glrStatsUniform3f
+#undef glUniform3fv
+#define glUniform3fv glrStatsUniform3fv
+#undef glUniform4fv
+#define glUniform4fv glrStatsUniform4fv
+#undef glUniformMatrix3fv
+#define glUniformMatrix3fv glrStatsUniformMatrix3fv
+#undef glUniformMatrix4fv
+#define glUniformMatrix4fv glrStatsUniformMatrix4fv
+#undef glBufferData
+#define glBufferData glrStatsBufferData
+#undef glBufferSubData
+#define glBufferSubData glrStatsBufferSubData
+#undef glTexImage2D
+#define glTexImage2D glrStatsTexImage2D
+#endif // GLR_STATS_WRAP
 
 #endif // __GLR_H__
@@ -0,0 +1,159 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "glr.h"
+
+// Snapshots are aligned for SIMD matrix types like cglm's mat4.
+#define SNAPSHOT_ALIGNMENT 64
+#define SNAPSHOTS 3
+
+typedef struct GlrAppThread
+{
+  GLFWwindow *window;
+  GlrApp *app;
+  size_t stride;
+  void *memory;
+  unsigned char *snapshots;
+  // Time the input of each snapshot was polled, 0 before the first poll
+  double pollTimes[SNAPSHOTS];
+
+  // The simulation writes into writeSlot and the render thread reads from readSlot. readySlot holds the latest
+  // snapshot, both exchange their slot with it, so neither ever waits for the other to finish with a snapshot.
+  int writeSlot;
+  int readySlot;
+  int readSlot;
+  int hasReady;
+  int isQuitting;
+  GLuint64 published;
+  GLuint64 taken;
+  GLuint64 rendered;
+
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+} GlrAppThread;
+
+static GLchar *strerrorDup(int error)
+{
+  const char *message = strerror(error);
+  size_t len = strlen(message);
+  GLchar *copy = (GLchar *)malloc(len + 1);
+  memcpy(copy, message, len + 1);
+  return copy;
+}
+
+static void *renderThread(void *arg)
+{
+  GlrAppThread *thread = (GlrAppThread *)arg;
+  glfwMakeContextCurrent(thread->window);
+
+  pthread_mutex_lock(&thread->mutex);
+  for (;;)
+  {
+    while (!thread->hasReady && !thread->isQuitting)
+    {
+      pthread_cond_wait(&thread->cond, &thread->mutex);
+    }
+    if (thread->isQuitting)
+    {
+      break;
+    }
+
+    int slot = thread->readySlot;
+    thread->readySlot = thread->readSlot;
+    thread->readSlot = slot;
+    thread->hasReady = 0;
+    ++thread->taken;
+    pthread_cond_broadcast(&thread->cond);
+    pthread_mutex_unlock(&thread->mutex);
+
+    thread->app->render(thread->window, thread->snapshots + slot * thread->stride, thread->app->renderContext);
+    glrFrameInputSampledAt(thread->pollTimes[slot]);
+    glrSwapBuffers(thread->window);
+
+    pthread_mutex_lock(&thread->mutex);
+    ++thread->rendered;
+    pthread_cond_broadcast(&thread->cond);
+  }
+  pthread_mutex_unlock(&thread->mutex);
+
+  glfwMakeContextCurrent(NULL);
+  return NULL;
+}
+
+const GLchar *glrRunApp(GLFWwindow *window, GlrApp *app)
+{
+  GlrAppThread thread = {
+      .window = window,
+      .app = app,
+      .stride = (app->stateSize + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT,
+      .writeSlot = 0,
+      .readySlot = 1,
+      .readSlot = 2,
+  };
+  thread.memory = malloc(thread.stride * SNAPSHOTS + SNAPSHOT_ALIGNMENT);
+  thread.snapshots = (unsigned char *)(((uintptr_t)thread.memory + SNAPSHOT_ALIGNMENT - 1) &
+                                       ~(uintptr_t)(SNAPSHOT_ALIGNMENT - 1));
+  pthread_mutex_init(&thread.mutex, NULL);
+  pthread_cond_init(&thread.cond, NULL);
+
+  // The render thread owns the context until the window closes.
+  glfwMakeContextCurrent(NULL);
+  glrFrameInputSampledAt(0.0);
+  pthread_t renderer;
+  int error = pthread_create(&renderer, NULL, renderThread, &thread);
+  if (error != 0)
+  {
+    glfwMakeContextCurrent(window);
+    pthread_cond_destroy(&thread.cond);
+    pthread_mutex_destroy(&thread.mutex);
+    free(thread.memory);
+    return strerrorDup(error);
+  }
+
+  // The benchmark advances its fixed timestep per rendered frame, so the simulation waits for the render to keep it
+  // deterministic. Otherwise the simulation of a frame overlaps the rendering of the previous one.
+  int isSerialized = glrBenchmarkActive();
+  double pollTime = 0.0;
+  double lastFrame = glrGetTime();
+  while (!glfwWindowShouldClose(window))
+  {
+    double currentFrame = glrGetTime();
+    float deltaTime = (float)(currentFrame - lastFrame);
+    lastFrame = currentFrame;
+    app->simulate(window, app->state, deltaTime);
+
+    memcpy(thread.snapshots + thread.writeSlot * thread.stride, app->state, app->stateSize);
+    thread.pollTimes[thread.writeSlot] = pollTime;
+
+    pthread_mutex_lock(&thread.mutex);
+    int slot = thread.readySlot;
+    thread.readySlot = thread.writeSlot;
+    thread.writeSlot = slot;
+    thread.hasReady = 1;
+    ++thread.published;
+    pthread_cond_broadcast(&thread.cond);
+    // Run at most one frame ahead of the render thread instead of simulating frames that are never rendered.
+    while ((isSerialized ? thread.rendered : thread.taken) < thread.published)
+    {
+      pthread_cond_wait(&thread.cond, &thread.mutex);
+    }
+    pthread_mutex_unlock(&thread.mutex);
+
+    glrPollEvents(window);
+    pollTime = glfwGetTime();
+  }
+
+  pthread_mutex_lock(&thread.mutex);
+  thread.isQuitting = 1;
+  pthread_cond_broadcast(&thread.cond);
+  pthread_mutex_unlock(&thread.mutex);
+  pthread_join(renderer, NULL);
+
+  glfwMakeContextCurrent(window);
+  pthread_cond_destroy(&thread.cond);
+  pthread_mutex_destroy(&thread.mutex);
+  free(thread.memory);
+  return NULL;
+}
@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "glr.h"
+
+// Every allocation is aligned for any scalar or SSE type
+#define ARENA_ALIGNMENT 16
+
+struct GlrArenaBlock
+{
+  GlrArenaBlock *next;
+  size_t size;
+  size_t used;
+};
+
+static size_t alignSize(size_t size)
+{
+  return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+// The data starts after the header, rounded up so it keeps the alignment.
+static unsigned char *blockData(GlrArenaBlock *block)
+{
+  return (unsigned char *)block + alignSize(sizeof(GlrArenaBlock));
+}
+
+static GlrArenaBlock *createBlock(size_t size)
+{
+  GlrArenaBlock *block = (GlrArenaBlock *)malloc(alignSize(sizeof(GlrArenaBlock)) + size);
+  if (block == NULL)
+  {
+    return NULL;
+  }
+  block->next = NULL;
+  block->size = size;
+  block->used = 0;
+  return block;
+}
+
+GlrArena *glrCreateArena(size_t blockSize)
+{
+  GlrArena *arena = (GlrArena *)calloc(1, sizeof(GlrArena));
+  arena->blockSize = alignSize(blockSize > 0 ? blockSize : 1);
+  return arena;
+}
+
+void *glrArenaAlloc(GlrArena *arena, size_t size)
+{
+  size = alignSize(size > 0 ? size : 1);
+  GlrArenaBlock *block = arena->blocks;
+  if (block == NULL || block->used + size > block->size)
+  {
+    // Blocks double, so a load of any size takes a few mallocs and the next one fits in the first block.
+    size_t blockSize = block != NULL ? block->size * 2 : arena->blockSize;
+    block = createBlock(blockSize > size ? blockSize : size);
+    if (block == NULL)
+    {
+      return NULL;
+    }
+    block->next = arena->blocks;
+    arena->blocks = block;
+  }
+  void *data = blockData(block) + block->used;
+  block->used += size;
+  arena->used += size;
+  arena->peak = arena->used > arena->peak ? arena->used : arena->peak;
+  arena->last = data;
+  return data;
+}
+
+void *glrArenaCalloc(GlrArena *arena, size_t count, size_t size)
+{
+  void *data = glrArenaAlloc(arena, count * size);
+  if (data != NULL)
+  {
+    memset(data, 0, count * size);
+  }
+  return data;
+}
+
+void *glrArenaRealloc(GlrArena *arena, void *data, size_t oldSize, size_t newSize)
+{
+  if (data == NULL)
+  {
+    return glrArenaAlloc(arena, newSize);
+  }
+
+  // The last allocation grows or shrinks in place, which is how arrays filled one element at a time grow.
+  GlrArenaBlock *block = arena->blocks;
+  if (data == arena->last)
+  {
+    size_t begin = (unsigned char *)data - blockData(block);
+    size_t oldAligned = block->used - begin;
+    size_t newAligned = alignSize(newSize > 0 ? newSize : 1);
+    if (begin + newAligned <= block->size)
+    {
+      block->used = begin + newAligned;
+      arena->used = arena->used - oldAligned + newAligned;
+      arena->peak = arena->used > arena->peak ? arena->used : arena->peak;
+      return data;
+    }
+  }
+
+  void *moved = glrArenaAlloc(arena, newSize);
+  if (moved != NULL)
+  {
+    memcpy(moved, data, oldSize < newSize ? oldSize : newSize);
+  }
+  return moved;
+}
+
+void glrArenaFree(GlrArena *arena, void *data)
+{
+  // Only the last allocation can be given back, the rest waits for the reset.
+  if (data == NULL || data != arena->last)
+  {
+    return;
+  }
+  GlrArenaBlock *block = arena->blocks;
+  size_t begin = (unsigned char *)data - blockData(block);
+  arena->used -= block->used - begin;
+  block->used = begin;
+  arena->last = NULL;
+}
+
+char *glrArenaReadFile(GlrArena *arena, const char *filename, const char *mode, GLsizei *outLen)
+{
+  FILE *file = fopen(filename, mode);
+  if (!file)
+  {
+    return NULL;
+  }
+
+  fseek(file, 0, SEEK_END);
+  long len = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  char *buffer = (char *)glrArenaAlloc(arena, len + 1);
+  // Text mode may read less than the file size on Windows.
+  size_t readLen = buffer != NULL ? fread(buffer, 1, len, file) : 0;
+  int isFailed = buffer == NULL || ferror(file);
+  fclose(file);
+  if (isFailed)
+  {
+    return NULL;
+  }
+  buffer[readLen] = '\0';
+
+  if (outLen != NULL)
+  {
+    *outLen = (GLsizei)readLen;
+  }
+  return buffer;
+}
+
+void glrResetArena(GlrArena *arena)
+{
+  // Keep the largest block, it is the newest one, and drop the rest.
+  GlrArenaBlock *block = arena->blocks;
+  if (block != NULL)
+  {
+    GlrArenaBlock *next = block->next;
+    while (next != NULL)
+    {
+      GlrArenaBlock *freed = next;
+      next = next->next;
+      free(freed);
+    }
+    block->next = NULL;
+    block->used = 0;
+  }
+  arena->used = 0;
+  arena->last = NULL;
+}
+
+void glrFreeArena(GlrArena *arena)
+{
+  GlrArenaBlock *block = arena->blocks;
+  while (block != NULL)
+  {
+    GlrArenaBlock *next = block->next;
+    free(block);
+    block = next;
+  }
+  free(arena);
+}
@@ -0,0 +1,226 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "glr.h"
+
+// Frames rendered before recording, so lazy driver work does not skew the results.
+#define WARMUP_FRAMES 10
+// Fixed timestep returned by glrGetTime in benchmark mode.
+#define BENCHMARK_TIMESTEP (1.0 / 60.0)
+
+typedef struct GlrBenchmark
+{
+  int isInitialized;
+  // Number of frames to record, 0 when the benchmark mode is off.
+  int frames;
+  // Number of frames swapped, including warmup frames.
+  int frameIndex;
+  // Number of frames recorded.
+  int recorded;
+  const char *output;
+
+  double lastFinishTime;
+  double *cpuTimes;
+  double *gpuTimes;
+  GLuint query;
+  int isQueryActive;
+
+  int hasCamera;
+  float cameraPosition[3];
+  float cameraYaw;
+  float cameraPitch;
+} GlrBenchmark;
+
+static GlrBenchmark benchmark = {0};
+
+static void initBenchmark()
+{
+  benchmark.isInitialized = 1;
+
+  const char *frames = getenv("GLR_BENCHMARK");
+  if (frames == NULL || atoi(frames) <= 0)
+  {
+    return;
+  }
+
+  benchmark.frames = atoi(frames);
+  benchmark.output = getenv("GLR_BENCHMARK_OUTPUT");
+  benchmark.cpuTimes = (double *)malloc(sizeof(double) * benchmark.frames);
+  benchmark.gpuTimes = (double *)malloc(sizeof(double) * benchmark.frames);
+}
+
+static int compareDouble(const void *a, const void *b)
+{
+  double lhs = *(const double *)a, rhs = *(const double *)b;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+static void writeStats(FILE *file, const char *name, double *times, int len)
+{
+  qsort(times, len, sizeof(double), compareDouble);
+
+  double sum = 0.0;
+  for (int i = 0; i < len; ++i)
+  {
+    sum += times[i];
+  }
+
+  // Nearest-rank percentiles
+  const int percentiles[] = {50, 95, 99};
+  fprintf(file, "  \"%s\": {\"mean\": %.4f", name, sum / len);
+  for (unsigned int i = 0; i < sizeof(percentiles) / sizeof(int); ++i)
+  {
+    int rank = (int)ceil(percentiles[i] / 100.0 * len) - 1;
+    fprintf(file, ", \"p%d\": %.4f", percentiles[i], times[rank < 0 ? 0 : rank]);
+  }
+  fprintf(file, ", \"min\": %.4f, \"max\": %.4f}", times[0], times[len - 1]);
+}
+
+static void writeReport(GLFWwindow *window)
+{
+  FILE *file = benchmark.output != NULL ? fopen(benchmark.output, "w") : stdout;
+  if (file == NULL)
+  {
+    perror(benchmark.output);
+    return;
+  }
+
+  const char *name = glfwGetWindowTitle(window);
+  fprintf(file, "{\n  \"name\": \"%s\",\n", name != NULL ? name : "");
+  fprintf(file, "  \"frames\": %d,\n  \"warmupFrames\": %d,\n", benchmark.frames, WARMUP_FRAMES);
+  fprintf(file, "  \"renderer\": \"%s\",\n", (const char *)glGetString(GL_RENDERER));
+  writeStats(file, "cpuFrameTimeMs", benchmark.cpuTimes, benchmark.recorded);
+  fprintf(file, ",\n");
+  writeStats(file, "gpuFrameTimeMs", benchmark.gpuTimes, benchmark.recorded);
+  fprintf(file, ",\n");
+
+  const GlrStats *stats = glrStatsLastFrame();
+  fprintf(file, "  \"lastFrameStats\": {\"drawCalls\": %llu, \"triangles\": %llu, \"programSwitches\": %llu, "
+                "\"vaoBinds\": %llu, \"textureBinds\": %llu, \"framebufferBinds\": %llu, \"uniformCalls\": %llu, "
+                "\"uniformBytes\": %llu, \"uploadBytes\": %llu}\n}\n",
+          (unsigned long long)stats->drawCalls, (unsigned long long)stats->triangles,
+          (unsigned long long)stats->programSwitches, (unsigned long long)stats->vaoBinds,
+          (unsigned long long)stats->textureBinds, (unsigned long long)stats->framebufferBinds,
+          (unsigned long long)stats->uniformCalls, (unsigned long long)stats->uniformBytes,
+          (unsigned long long)stats->uploadBytes);
+
+  if (file != stdout)
+  {
+    fclose(file);
+  }
+}
+
+int glrBenchmarkActive()
+{
+  if (!benchmark.isInitialized)
+  {
+    initBenchmark();
+  }
+  return benchmark.frames > 0;
+}
+
+double glrGetTime()
+{
+  double time = 0.0;
+  if (glrInputFrameTime(&time))
+  {
+    return time;
+  }
+  if (glrBenchmarkActive())
+  {
+    return benchmark.frameIndex * BENCHMARK_TIMESTEP;
+  }
+  return glfwGetTime();
+}
+
+int glrBenchmarkCamera(float position[3], float front[3])
+{
+  // The replayed input drives the camera instead
+  if (!glrBenchmarkActive() || glrInputReplaying())
+  {
+    return 0;
+  }
+
+  // The path starts from the camera set up by the chapter
+  if (!benchmark.hasCamera)
+  {
+    benchmark.hasCamera = 1;
+    for (int i = 0; i < 3; ++i)
+    {
+      benchmark.cameraPosition[i] = position[i];
+    }
+    benchmark.cameraYaw = atan2f(front[2], front[0]);
+    benchmark.cameraPitch = asinf(fmaxf(-1.0f, fminf(1.0f, front[1])));
+  }
+
+  // Sway left and right, nod up and down and dolly along the initial direction.
+  float t = (float)(benchmark.frameIndex * BENCHMARK_TIMESTEP);
+  float yaw = benchmark.cameraYaw + 0.5f * sinf(t * 0.8f);
+  float pitch = benchmark.cameraPitch + 0.2f * sinf(t * 1.3f);
+  float dolly = 1.5f * sinf(t * 0.5f);
+
+  float initialFront[3] = {
+      cosf(benchmark.cameraYaw) * cosf(benchmark.cameraPitch),
+      sinf(benchmark.cameraPitch),
+      sinf(benchmark.cameraYaw) * cosf(benchmark.cameraPitch)};
+  for (int i = 0; i < 3; ++i)
+  {
+    position[i] = benchmark.cameraPosition[i] + initialFront[i] * dolly;
+  }
+  front[0] = cosf(yaw) * cosf(pitch);
+  front[1] = sinf(pitch);
+  front[2] = sinf(yaw) * cosf(pitch);
+
+  return 1;
+}
+
+void glrBenchmarkEndFrame(GLFWwindow *window)
+{
+  if (!glrBenchmarkActive())
+  {
+    return;
+  }
+
+  if (benchmark.query == 0)
+  {
+    glGenQueries(1, &benchmark.query);
+  }
+  if (benchmark.isQueryActive)
+  {
+    glEndQuery(GL_TIME_ELAPSED);
+    benchmark.isQueryActive = 0;
+  }
+
+  // Frame boundary: wait for the GPU, so the query result is ready without stalling and CPU time covers the frame.
+  glFinish();
+  double now = glfwGetTime();
+
+  if (benchmark.frameIndex > WARMUP_FRAMES && benchmark.recorded < benchmark.frames)
+  {
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(benchmark.query, GL_QUERY_RESULT, &elapsed);
+    benchmark.cpuTimes[benchmark.recorded] = (now - benchmark.lastFinishTime) * 1000.0;
+    benchmark.gpuTimes[benchmark.recorded] = elapsed / 1.0e6;
+    ++benchmark.recorded;
+
+    if (benchmark.recorded == benchmark.frames)
+    {
+      writeReport(window);
+      glfwSetWindowShouldClose(window, GLFW_TRUE);
+    }
+  }
+  benchmark.lastFinishTime = now;
+  ++benchmark.frameIndex;
+}
+
+void glrBenchmarkBeginFrame()
+{
+  if (!glrBenchmarkActive())
+  {
+    return;
+  }
+
+  glBeginQuery(GL_TIME_ELAPSED, benchmark.query);
+  benchmark.isQueryActive = 1;
+}
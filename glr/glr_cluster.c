@@ -0,0 +1,298 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "glr.h"
+#include "glr_simd.h"
+
+#define CLUSTERS_LEN (GLR_CLUSTERS_X * GLR_CLUSTERS_Y * GLR_CLUSTERS_Z)
+
+// View depth of the near end of a slice, slices grow exponentially like the perspective.
+static float sliceDepth(const GlrLightClusters *clusters, int slice)
+{
+  return clusters->near * powf(clusters->far / clusters->near, (float)slice / GLR_CLUSTERS_Z);
+}
+
+static void reserveLights(GlrLightClusters *clusters, GLuint len)
+{
+  if (len <= clusters->lightsCap)
+  {
+    return;
+  }
+  clusters->lightsCap = clusters->lightsCap == 0 ? 64 : clusters->lightsCap * 2;
+  if (clusters->lightsCap < len)
+  {
+    clusters->lightsCap = len;
+  }
+  // x, y, depth and radius of each light, and the same for the candidates of each slice
+  clusters->viewLights = (float *)realloc(clusters->viewLights, sizeof(float) * 4 * clusters->lightsCap);
+  clusters->candidates =
+      (float *)realloc(clusters->candidates, sizeof(float) * 4 * clusters->lightsCap * GLR_CLUSTERS_Z);
+  clusters->candidateIndices =
+      (GLuint *)realloc(clusters->candidateIndices, sizeof(GLuint) * clusters->lightsCap * GLR_CLUSTERS_Z);
+}
+
+// Append the candidates touching a cluster box, up to the maximum per cluster.
+static GLuint assignCluster(const GlrLightClusters *clusters, const float *x, const float *y, const float *depth,
+                            const float *radius, const GLuint *indices, GLuint len, const float min[3],
+                            const float max[3], GLuint *out)
+{
+  GLuint count = 0;
+  GLuint l = 0;
+
+#if LANES > 1
+  Vec minX = vecSet1(min[0]), minY = vecSet1(min[1]), minZ = vecSet1(min[2]);
+  Vec maxX = vecSet1(max[0]), maxY = vecSet1(max[1]), maxZ = vecSet1(max[2]);
+  Vec zero = vecZero();
+  for (; l + LANES <= len && count < clusters->maxLightsPerCluster; l += LANES)
+  {
+    // Squared distance from the sphere center to the box
+    Vec px = vecLoad(&x[l]), py = vecLoad(&y[l]), pz = vecLoad(&depth[l]), r = vecLoad(&radius[l]);
+    Vec dx = vecMax(zero, vecMax(vecSub(minX, px), vecSub(px, maxX)));
+    Vec dy = vecMax(zero, vecMax(vecSub(minY, py), vecSub(py, maxY)));
+    Vec dz = vecMax(zero, vecMax(vecSub(minZ, pz), vecSub(pz, maxZ)));
+    Vec distance = vecAdd(vecAdd(vecMul(dx, dx), vecMul(dy, dy)), vecMul(dz, dz));
+    int mask = vecIsLessEqual(distance, vecMul(r, r));
+    for (int lane = 0; mask != 0 && count < clusters->maxLightsPerCluster; ++lane, mask >>= 1)
+    {
+      if (mask & 1)
+      {
+        out[count++] = indices[l + lane];
+      }
+    }
+  }
+#endif
+
+  for (; l < len && count < clusters->maxLightsPerCluster; ++l)
+  {
+    float p[3] = {x[l], y[l], depth[l]};
+    float distance = 0.0f;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      float d = fmaxf(0.0f, fmaxf(min[axis] - p[axis], p[axis] - max[axis]));
+      distance += d * d;
+    }
+    if (distance <= radius[l] * radius[l])
+    {
+      out[count++] = indices[l];
+    }
+  }
+  return count;
+}
+
+// Assign the lights to the clusters of a depth slice.
+static void assignSlice(GlrLightClusters *clusters, int slice)
+{
+  float near = sliceDepth(clusters, slice), far = sliceDepth(clusters, slice + 1);
+  GLuint cap = clusters->lightsCap;
+  float *x = clusters->candidates + (size_t)slice * cap * 4;
+  float *y = x + cap, *depth = y + cap, *radius = depth + cap;
+  GLuint *indices = clusters->candidateIndices + (size_t)slice * cap;
+
+  // Only lights reaching into the slice are tested against its clusters.
+  GLuint len = 0;
+  for (GLuint l = 0; l < clusters->lightsLen; ++l)
+  {
+    const float *light = &clusters->viewLights[l * 4];
+    if (light[2] + light[3] >= near && light[2] - light[3] <= far)
+    {
+      x[len] = light[0];
+      y[len] = light[1];
+      depth[len] = light[2];
+      radius[len] = light[3];
+      indices[len] = l;
+      ++len;
+    }
+  }
+
+  for (int j = 0; j < GLR_CLUSTERS_Y; ++j)
+  {
+    for (int i = 0; i < GLR_CLUSTERS_X; ++i)
+    {
+      // Box around the cluster's piece of the frustum, in view space with the depth growing forward
+      float ndcX[2] = {-1.0f + 2.0f * i / GLR_CLUSTERS_X, -1.0f + 2.0f * (i + 1) / GLR_CLUSTERS_X};
+      float ndcY[2] = {-1.0f + 2.0f * j / GLR_CLUSTERS_Y, -1.0f + 2.0f * (j + 1) / GLR_CLUSTERS_Y};
+      float min[3] = {INFINITY, INFINITY, near}, max[3] = {-INFINITY, -INFINITY, far};
+      for (int corner = 0; corner < 4; ++corner)
+      {
+        float d = corner & 1 ? far : near;
+        float cx = ndcX[corner >> 1] * d * clusters->unprojectX;
+        float cy = ndcY[corner >> 1] * d * clusters->unprojectY;
+        min[0] = fminf(min[0], cx);
+        max[0] = fmaxf(max[0], cx);
+        min[1] = fminf(min[1], cy);
+        max[1] = fmaxf(max[1], cy);
+      }
+
+      GLuint cluster = (slice * GLR_CLUSTERS_Y + j) * GLR_CLUSTERS_X + i;
+      clusters->clusterCounts[cluster] =
+          assignCluster(clusters, x, y, depth, radius, indices, len, min, max,
+                        clusters->clusterLights + (size_t)cluster * clusters->maxLightsPerCluster);
+    }
+  }
+}
+
+static void assignSlices(GLuint begin, GLuint end, void *ctx)
+{
+  for (GLuint slice = begin; slice < end; ++slice)
+  {
+    assignSlice((GlrLightClusters *)ctx, slice);
+  }
+}
+
+static void createTextureBuffer(GLenum format, GLuint *buffer, GLuint *texture)
+{
+  glGenBuffers(1, buffer);
+  glBindBuffer(GL_TEXTURE_BUFFER, *buffer);
+  // A texture buffer needs storage to be complete.
+  glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+  glrTrackBuffer(*buffer, 16, GLR_MEMORY_STREAMING, "glrCreateLightClusters");
+  glGenTextures(1, texture);
+  glBindTexture(GL_TEXTURE_BUFFER, *texture);
+  glTexBuffer(GL_TEXTURE_BUFFER, format, *buffer);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+// Orphan the buffer and upload the data of this frame
+static void upload(GLuint buffer, const void *data, GLsizeiptr size)
+{
+  glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+  glBufferData(GL_TEXTURE_BUFFER, size > 0 ? size : 16, NULL, GL_STREAM_DRAW);
+  glrTrackBuffer(buffer, size > 0 ? size : 16, GLR_MEMORY_STREAMING, "glrUpdateLightClusters");
+  if (size > 0)
+  {
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+  }
+  glrStats()->uploadBytes += size;
+}
+
+GlrLightClusters *glrCreateLightClusters(int width, int height, GLuint maxLightsPerCluster)
+{
+  GlrLightClusters *clusters = (GlrLightClusters *)calloc(1, sizeof(GlrLightClusters));
+  clusters->width = width;
+  clusters->height = height;
+  clusters->maxLightsPerCluster = maxLightsPerCluster;
+  clusters->clusterCounts = (GLuint *)malloc(sizeof(GLuint) * CLUSTERS_LEN);
+  clusters->clusterLights = (GLuint *)malloc(sizeof(GLuint) * CLUSTERS_LEN * maxLightsPerCluster);
+  clusters->grid = (GLuint *)malloc(sizeof(GLuint) * 2 * CLUSTERS_LEN);
+  clusters->indices = (GLuint *)malloc(sizeof(GLuint) * CLUSTERS_LEN * maxLightsPerCluster);
+  return clusters;
+}
+
+void glrAssignLightClusters(
+    GlrLightClusters *clusters,
+    const float view[16],
+    const float projection[16],
+    const GlrLight *lights,
+    GLuint lightsLen)
+{
+  // The near and far planes and the view space extent per depth of a symmetric perspective projection
+  clusters->near = projection[14] / (projection[10] - 1.0f);
+  clusters->far = projection[14] / (projection[10] + 1.0f);
+  clusters->unprojectX = 1.0f / projection[0];
+  clusters->unprojectY = 1.0f / projection[5];
+
+  reserveLights(clusters, lightsLen);
+  clusters->lightsLen = lightsLen;
+  for (GLuint l = 0; l < lightsLen; ++l)
+  {
+    const GlrLight *light = &lights[l];
+    const float *p = light->position;
+    float *viewLight = &clusters->viewLights[l * 4];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      viewLight[axis] = view[axis] * p[0] + view[4 + axis] * p[1] + view[8 + axis] * p[2] + view[12 + axis];
+    }
+    // The view looks down -z, the depth grows forward.
+    viewLight[2] = -viewLight[2];
+    viewLight[3] = glrLightRadius(light);
+  }
+
+  glrParallelFor(GLR_CLUSTERS_Z, 1, assignSlices, clusters);
+
+  // Pack the lists of the clusters one after the other.
+  GLuint offset = 0;
+  for (GLuint cluster = 0; cluster < CLUSTERS_LEN; ++cluster)
+  {
+    GLuint count = clusters->clusterCounts[cluster];
+    clusters->grid[cluster * 2] = offset;
+    clusters->grid[cluster * 2 + 1] = count;
+    memcpy(clusters->indices + offset, clusters->clusterLights + (size_t)cluster * clusters->maxLightsPerCluster,
+           sizeof(GLuint) * count);
+    offset += count;
+  }
+  clusters->indicesLen = offset;
+}
+
+void glrUpdateLightClusters(
+    GlrLightClusters *clusters,
+    const float view[16],
+    const float projection[16],
+    const GlrLight *lights,
+    GLuint lightsLen)
+{
+  // The texture buffers wait for the first update, the assignment alone runs without a GL context.
+  if (clusters->lightsBuffer == 0)
+  {
+    createTextureBuffer(GL_RGBA32F, &clusters->lightsBuffer, &clusters->lightsTexture);
+    createTextureBuffer(GL_RG32UI, &clusters->gridBuffer, &clusters->gridTexture);
+    createTextureBuffer(GL_R32UI, &clusters->indicesBuffer, &clusters->indicesTexture);
+  }
+
+  glrAssignLightClusters(clusters, view, projection, lights, lightsLen);
+
+  float *texels = (float *)malloc(sizeof(float) * 4 * GLR_LIGHT_VEC4S * (lightsLen > 0 ? lightsLen : 1));
+  for (GLuint l = 0; l < lightsLen; ++l)
+  {
+    glrPackLight(&lights[l], clusters->viewLights[l * 4 + 3], &texels[l * 4 * GLR_LIGHT_VEC4S]);
+  }
+  upload(clusters->lightsBuffer, texels, sizeof(float) * 4 * GLR_LIGHT_VEC4S * lightsLen);
+  upload(clusters->gridBuffer, clusters->grid, sizeof(GLuint) * 2 * CLUSTERS_LEN);
+  upload(clusters->indicesBuffer, clusters->indices, sizeof(GLuint) * clusters->indicesLen);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  free(texels);
+}
+
+void glrBindLightClusters(GlrLightClusters *clusters, GLuint firstUnit)
+{
+  GLuint textures[3] = {clusters->lightsTexture, clusters->gridTexture, clusters->indicesTexture};
+  for (int i = 0; i < 3; ++i)
+  {
+    glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+    glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+  }
+  glActiveTexture(GL_TEXTURE0);
+  glrStats()->textureBinds += 3;
+}
+
+void glrLightClustersUniforms(GlrLightClusters *clusters, GLint paramsLocation)
+{
+  GlrStats *stats = glrStats();
+  glUniform4f(paramsLocation, clusters->near, clusters->far, (GLfloat)clusters->width, (GLfloat)clusters->height);
+  ++stats->uniformCalls;
+  stats->uniformBytes += sizeof(GLfloat) * 4;
+}
+
+void glrFreeLightClusters(GlrLightClusters *clusters)
+{
+  if (clusters->lightsBuffer != 0)
+  {
+    GLuint buffers[3] = {clusters->lightsBuffer, clusters->gridBuffer, clusters->indicesBuffer};
+    GLuint textures[3] = {clusters->lightsTexture, clusters->gridTexture, clusters->indicesTexture};
+    for (int i = 0; i < 3; ++i)
+    {
+      glrUntrackBuffer(buffers[i]);
+    }
+    glDeleteBuffers(3, buffers);
+    glDeleteTextures(3, textures);
+  }
+  free(clusters->clusterCounts);
+  free(clusters->clusterLights);
+  free(clusters->grid);
+  free(clusters->indices);
+  free(clusters->viewLights);
+  free(clusters->candidates);
+  free(clusters->candidateIndices);
+  free(clusters);
+}
@@ -0,0 +1,157 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "glr.h"
+#include "glr_simd.h"
+
+// Objects per job chunk, a multiple of LANES
+#define CULL_GRAIN 16384
+
+typedef struct CullJob
+{
+  const float (*planes)[4];
+  const GlrBounds *bounds;
+  GLuint *visible;
+  GLuint *chunkCounts;
+} CullJob;
+
+static int isVisible(const float (*planes)[4], const GlrBounds *bounds, GLuint i)
+{
+  for (int p = 0; p < 6; ++p)
+  {
+    const float *plane = planes[p];
+    float distance = plane[0] * bounds->x[i] + plane[1] * bounds->y[i] + plane[2] * bounds->z[i] + plane[3];
+    // Projected radius of the box onto the plane normal
+    float radius = bounds->radius != NULL
+                       ? bounds->radius[i]
+                       : fabsf(plane[0]) * bounds->extentX[i] + fabsf(plane[1]) * bounds->extentY[i] +
+                             fabsf(plane[2]) * bounds->extentZ[i];
+    if (distance + radius <= 0.0f)
+    {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// Write the visible indices in [begin, end) to out and return their number.
+static GLuint cullRange(const float (*planes)[4], const GlrBounds *bounds, GLuint begin, GLuint end, GLuint *out)
+{
+  GLuint len = 0;
+  GLuint i = begin;
+
+#if LANES > 1
+  Vec a[6], b[6], c[6], d[6], absA[6], absB[6], absC[6];
+  for (int p = 0; p < 6; ++p)
+  {
+    a[p] = vecSet1(planes[p][0]);
+    b[p] = vecSet1(planes[p][1]);
+    c[p] = vecSet1(planes[p][2]);
+    d[p] = vecSet1(planes[p][3]);
+    absA[p] = vecSet1(fabsf(planes[p][0]));
+    absB[p] = vecSet1(fabsf(planes[p][1]));
+    absC[p] = vecSet1(fabsf(planes[p][2]));
+  }
+
+  for (; i + LANES <= end; i += LANES)
+  {
+    Vec x = vecLoad(&bounds->x[i]), y = vecLoad(&bounds->y[i]), z = vecLoad(&bounds->z[i]);
+    int mask = (1 << LANES) - 1;
+    for (int p = 0; p < 6 && mask != 0; ++p)
+    {
+      Vec distance = vecAdd(vecAdd(vecMul(a[p], x), vecMul(b[p], y)), vecAdd(vecMul(c[p], z), d[p]));
+      Vec radius;
+      if (bounds->radius != NULL)
+      {
+        radius = vecLoad(&bounds->radius[i]);
+      }
+      else
+      {
+        radius = vecAdd(vecAdd(vecMul(absA[p], vecLoad(&bounds->extentX[i])), vecMul(absB[p], vecLoad(&bounds->extentY[i]))),
+                        vecMul(absC[p], vecLoad(&bounds->extentZ[i])));
+      }
+      mask &= vecIsPositive(vecAdd(distance, radius));
+    }
+
+    for (int lane = 0; mask != 0; ++lane, mask >>= 1)
+    {
+      if (mask & 1)
+      {
+        out[len++] = i + lane;
+      }
+    }
+  }
+#endif
+
+  for (; i < end; ++i)
+  {
+    if (isVisible(planes, bounds, i))
+    {
+      out[len++] = i;
+    }
+  }
+  return len;
+}
+
+static void cullChunk(GLuint begin, GLuint end, void *ctx)
+{
+  CullJob *job = (CullJob *)ctx;
+  // Each chunk compacts into its own range of the output first
+  job->chunkCounts[begin / CULL_GRAIN] = cullRange(job->planes, job->bounds, begin, end, job->visible + begin);
+}
+
+void glrFrustumPlanes(const float viewProjection[16], float planes[6][4])
+{
+  // Gribb-Hartmann: the planes are the last row of the column-major matrix plus or minus each other row.
+  for (int i = 0; i < 3; ++i)
+  {
+    for (int j = 0; j < 4; ++j)
+    {
+      float row = viewProjection[j * 4 + i];
+      float w = viewProjection[j * 4 + 3];
+      planes[i * 2][j] = w + row;
+      planes[i * 2 + 1][j] = w - row;
+    }
+  }
+
+  // Normalize, so the distances compare against radii in world units
+  for (int p = 0; p < 6; ++p)
+  {
+    float len = sqrtf(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+    if (len > 0.0f)
+    {
+      for (int j = 0; j < 4; ++j)
+      {
+        planes[p][j] /= len;
+      }
+    }
+  }
+}
+
+GLuint glrCullFrustum(const float planes[6][4], const GlrBounds *bounds, GLuint *visible)
+{
+  if (bounds->len <= CULL_GRAIN)
+  {
+    return cullRange(planes, bounds, 0, bounds->len, visible);
+  }
+
+  GLuint chunksLen = (bounds->len + CULL_GRAIN - 1) / CULL_GRAIN;
+  CullJob job = {
+      .planes = planes,
+      .bounds = bounds,
+      .visible = visible,
+      .chunkCounts = (GLuint *)malloc(sizeof(GLuint) * chunksLen),
+  };
+  glrParallelFor(bounds->len, CULL_GRAIN, cullChunk, &job);
+
+  // Move the chunks together, the output stays in ascending order.
+  GLuint len = 0;
+  for (GLuint i = 0; i < chunksLen; ++i)
+  {
+    memmove(visible + len, visible + i * CULL_GRAIN, sizeof(GLuint) * job.chunkCounts[i]);
+    len += job.chunkCounts[i];
+  }
+  free(job.chunkCounts);
+  return len;
+}
@@ -0,0 +1,579 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "glr.h"
+
+// Tessellation of the light volume sphere
+#define SPHERE_RINGS 8
+#define SPHERE_SEGMENTS 12
+#define SPHERE_VERTICES ((SPHERE_RINGS + 1) * (SPHERE_SEGMENTS + 1))
+#define SPHERE_INDICES (SPHERE_RINGS * SPHERE_SEGMENTS * 6)
+// Floats of a light in the instance buffer: position and radius, ambient, diffuse, specular, attenuation,
+// direction, cut offs
+#define LIGHT_FLOATS 21
+// Lights the instance ring holds per frame before it grows
+#define RING_LIGHTS 256
+
+// Reads the G-buffer and shades a surface like the chapters' Phong lighting
+#define GBUFFER_GLSL                                                                                \
+  "uniform sampler2D gAlbedo;\n"                                                                    \
+  "uniform sampler2D gSpecular;\n"                                                                  \
+  "uniform sampler2D gNormal;\n"                                                                    \
+  "uniform sampler2D gDepth;\n"                                                                     \
+  "uniform mat4 inverseViewProjection;\n"                                                           \
+  "uniform vec3 viewPos;\n"                                                                         \
+  "out vec4 FragColor;\n"                                                                           \
+  "struct Surface {\n"                                                                              \
+  "  vec3 position;\n"                                                                              \
+  "  vec3 normal;\n"                                                                                \
+  "  vec3 albedo;\n"                                                                                \
+  "  vec3 specular;\n"                                                                              \
+  "  float shininess;\n"                                                                            \
+  "};\n"                                                                                            \
+  "Surface readSurface(vec2 uv, float depth) {\n"                                                   \
+  "  vec4 position = inverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);\n"            \
+  "  vec4 specular = texture(gSpecular, uv);\n"                                                     \
+  "  return Surface(position.xyz / position.w, normalize(texture(gNormal, uv).xyz),\n"             \
+  "                 texture(gAlbedo, uv).rgb, specular.rgb, specular.a * 256.0);\n"                 \
+  "}\n"                                                                                             \
+  "vec3 shade(Surface s, vec3 lightDir, vec3 ambient, vec3 diffuse, vec3 specular) {\n"            \
+  "  vec3 viewDir = normalize(viewPos - s.position);\n"                                             \
+  "  vec3 reflectDir = reflect(-lightDir, s.normal);\n"                                             \
+  "  return ambient * s.albedo + max(dot(s.normal, lightDir), 0.0) * diffuse * s.albedo +\n"       \
+  "         pow(max(dot(viewDir, reflectDir), 0.0), s.shininess) * specular * s.specular;\n"        \
+  "}\n"
+
+// Drawn as the fullscreen triangle of glrFullscreenVertexShader
+static const GLchar DIRECTIONAL_FRAGMENT_SHADER[] =
+    "#version 330 core\n" GBUFFER_GLSL
+    "in vec2 TexCoords;\n"
+    "uniform vec3 direction;\n"
+    "uniform vec3 ambient;\n"
+    "uniform vec3 diffuse;\n"
+    "uniform vec3 specular;\n"
+    "void main()\n"
+    "{\n"
+    "  float depth = texture(gDepth, TexCoords).r;\n"
+    "  if (depth == 1.0)\n"
+    "  {\n"
+    "    discard;\n"
+    "  }\n"
+    "  Surface s = readSurface(TexCoords, depth);\n"
+    "  FragColor = vec4(shade(s, normalize(-direction), ambient, diffuse, specular), 1.0);\n"
+    "}\n";
+
+// The sphere is scaled to the light radius per instance.
+static const GLchar VOLUME_VERTEX_SHADER[] =
+    "#version 330 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "layout (location = 1) in vec4 aPositionRadius;\n"
+    "layout (location = 2) in vec3 aAmbient;\n"
+    "layout (location = 3) in vec3 aDiffuse;\n"
+    "layout (location = 4) in vec3 aSpecular;\n"
+    "layout (location = 5) in vec3 aAttenuation;\n"
+    "layout (location = 6) in vec3 aDirection;\n"
+    "layout (location = 7) in vec2 aCutOffs;\n"
+    "uniform mat4 viewProjection;\n"
+    "flat out vec4 PositionRadius;\n"
+    "flat out vec3 Ambient;\n"
+    "flat out vec3 Diffuse;\n"
+    "flat out vec3 Specular;\n"
+    "flat out vec3 Attenuation;\n"
+    "flat out vec3 Direction;\n"
+    "flat out vec2 CutOffs;\n"
+    "void main()\n"
+    "{\n"
+    "  PositionRadius = aPositionRadius;\n"
+    "  Ambient = aAmbient;\n"
+    "  Diffuse = aDiffuse;\n"
+    "  Specular = aSpecular;\n"
+    "  Attenuation = aAttenuation;\n"
+    "  Direction = aDirection;\n"
+    "  CutOffs = aCutOffs;\n"
+    "  gl_Position = viewProjection * vec4(aPositionRadius.xyz + aPos * aPositionRadius.w, 1.0);\n"
+    "}\n";
+
+static const GLchar VOLUME_FRAGMENT_SHADER[] =
+    "#version 330 core\n" GBUFFER_GLSL
+    "uniform vec2 screenSize;\n"
+    "flat in vec4 PositionRadius;\n"
+    "flat in vec3 Ambient;\n"
+    "flat in vec3 Diffuse;\n"
+    "flat in vec3 Specular;\n"
+    "flat in vec3 Attenuation;\n"
+    "flat in vec3 Direction;\n"
+    "flat in vec2 CutOffs;\n"
+    "void main()\n"
+    "{\n"
+    "  vec2 uv = gl_FragCoord.xy / screenSize;\n"
+    "  Surface s = readSurface(uv, texture(gDepth, uv).r);\n"
+    "  vec3 toLight = PositionRadius.xyz - s.position;\n"
+    "  float distance = length(toLight);\n"
+    "  if (distance > PositionRadius.w)\n"
+    "  {\n"
+    "    discard;\n"
+    "  }\n"
+    "  vec3 lightDir = toLight / distance;\n"
+    "  float attenuation = 1.0 / (Attenuation.x + Attenuation.y * distance + Attenuation.z * distance * distance);\n"
+    "  // Spot lights have a direction, the light fades between the cut off cosines.\n"
+    "  if (dot(Direction, Direction) > 0.0)\n"
+    "  {\n"
+    "    float theta = dot(lightDir, normalize(-Direction));\n"
+    "    attenuation *= clamp((theta - CutOffs.y) / (CutOffs.x - CutOffs.y), 0.0, 1.0);\n"
+    "  }\n"
+    "  FragColor = vec4(shade(s, lightDir, Ambient, Diffuse, Specular) * attenuation, 1.0);\n"
+    "}\n";
+
+// Column-major inverse by cofactors, zero when the matrix is singular
+static void invert(const float m[16], float out[16])
+{
+  float inv[16];
+  inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] +
+           m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+  inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] -
+           m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+  inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] +
+           m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+  inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] -
+            m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+  inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] -
+           m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+  inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] +
+           m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+  inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] -
+           m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+  inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] +
+            m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+  inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] +
+           m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+  inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] -
+           m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+  inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] +
+            m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+  inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] -
+            m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+  inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] -
+           m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+  inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] +
+           m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+  inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] -
+            m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+  inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] +
+            m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+  float det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+  float invDet = det != 0.0f ? 1.0f / det : 0.0f;
+  for (int i = 0; i < 16; ++i)
+  {
+    out[i] = inv[i] * invDet;
+  }
+}
+
+// Link a compiled vertex shader with a fragment shader source, vertexError is the result of compiling vertexShader.
+static const GLchar *compileProgram(GLuint program, GLuint vertexShader, const GLchar *vertexError,
+                                    const GLchar *fragmentSource, GLint fragmentLen)
+{
+  if (vertexError != NULL)
+  {
+    glDeleteShader(vertexShader);
+    return vertexError;
+  }
+  GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+  const GLchar *error = glrShaderSource(fragmentShader, fragmentSource, fragmentLen);
+  if (error != NULL)
+  {
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    return error;
+  }
+
+  glAttachShader(program, vertexShader);
+  glAttachShader(program, fragmentShader);
+  error = glrLinkProgram(program);
+  glDeleteShader(vertexShader);
+  glDeleteShader(fragmentShader);
+  return error;
+}
+
+// The G-buffer textures are read from units 0 to 3.
+static void bindGBufferSamplers(GLuint program, GlrGBufferLocations *locations)
+{
+  glUseProgram(program);
+  glUniform1i(glGetUniformLocation(program, "gAlbedo"), 0);
+  glUniform1i(glGetUniformLocation(program, "gSpecular"), 1);
+  glUniform1i(glGetUniformLocation(program, "gNormal"), 2);
+  glUniform1i(glGetUniformLocation(program, "gDepth"), 3);
+  locations->inverseViewProjection = glGetUniformLocation(program, "inverseViewProjection");
+  locations->viewPos = glGetUniformLocation(program, "viewPos");
+}
+
+static GLuint createTarget(GLint internalFormat, GLenum format, GLenum type, GLint filter, int width, int height)
+{
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glrTrackTexture(GL_TEXTURE_2D, texture, GLR_MEMORY_RENDER_TARGETS, "glrCreateDeferred");
+  return texture;
+}
+
+static const GLchar *checkFramebuffer(const GLchar *name)
+{
+  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  if (status == GL_FRAMEBUFFER_COMPLETE)
+  {
+    return NULL;
+  }
+  const GLchar *format = "%s framebuffer is incomplete: 0x%x";
+  int len = snprintf(NULL, 0, format, name, status);
+  GLchar *error = (GLchar *)malloc(len + 1);
+  snprintf(error, len + 1, format, name, status);
+  return error;
+}
+
+#define INSTANCE_ATTRIBUTES 7
+
+// Point the instance attributes of the bound VAO at the lights written at offset in the bound buffer.
+static void pointInstanceAttributes(GLintptr offset)
+{
+  static const GLint SIZES[INSTANCE_ATTRIBUTES] = {4, 3, 3, 3, 3, 3, 2};
+  for (GLuint i = 0; i < INSTANCE_ATTRIBUTES; ++i)
+  {
+    glVertexAttribPointer(i + 1, SIZES[i], GL_FLOAT, GL_FALSE, sizeof(GLfloat) * LIGHT_FLOATS, (void *)offset);
+    offset += sizeof(GLfloat) * SIZES[i];
+  }
+}
+
+// Write the lights for instancing into the ring, growing it when a frame needs more room. Returns 0 when the ring
+// cannot be mapped.
+static int writeLights(GlrDeferred *deferred, const GlrLight *lights, GLuint lightsLen, GLintptr *offset)
+{
+  static int isMapErrorReported = 0;
+  GLsizeiptr size = sizeof(GLfloat) * LIGHT_FLOATS * lightsLen;
+  GlrRingBuffer *ring = deferred->lightsRing;
+  // A persistent ring also holds the earlier writes of this frame in its part.
+  GLsizeiptr begin = ring->isPersistent ? (ring->head + sizeof(GLfloat) - 1) / sizeof(GLfloat) * sizeof(GLfloat) : 0;
+  if (begin + size > ring->frameSize)
+  {
+    // The GL keeps the old buffer alive until the draws reading it are done.
+    GLsizeiptr frameSize = ring->frameSize * 2;
+    glrFreeRingBuffer(ring);
+    deferred->lightsRing = glrCreateRingBuffer(frameSize > size ? frameSize : size);
+  }
+  GLfloat *p = (GLfloat *)glrMapRing(deferred->lightsRing, size, sizeof(GLfloat), offset);
+  if (p == NULL)
+  {
+    if (!isMapErrorReported)
+    {
+      fprintf(stderr, "glr: Mapping %ld bytes of deferred lights failed, the light volumes are skipped\n", (long)size);
+      isMapErrorReported = 1;
+    }
+    return 0;
+  }
+  for (GLuint i = 0; i < lightsLen; ++i)
+  {
+    const GlrLight *light = &lights[i];
+    float radius = glrLightRadius(light);
+    *p++ = light->position[0], *p++ = light->position[1], *p++ = light->position[2], *p++ = radius;
+    *p++ = light->ambient[0], *p++ = light->ambient[1], *p++ = light->ambient[2];
+    *p++ = light->diffuse[0], *p++ = light->diffuse[1], *p++ = light->diffuse[2];
+    *p++ = light->specular[0], *p++ = light->specular[1], *p++ = light->specular[2];
+    *p++ = light->constant, *p++ = light->linear, *p++ = light->quadratic;
+    *p++ = light->direction[0], *p++ = light->direction[1], *p++ = light->direction[2];
+    *p++ = light->cutOff, *p++ = light->outerCutOff;
+  }
+  glrUnmapRing(deferred->lightsRing);
+  return 1;
+}
+
+// A UV sphere around the unit sphere, its faces are pushed out until they touch it.
+static void createSphere(GlrDeferred *deferred)
+{
+  const float PI = 3.14159265f;
+  float scale = 1.0f / (cosf(PI / SPHERE_SEGMENTS) * cosf(PI / (2.0f * SPHERE_RINGS)));
+  GLfloat vertices[SPHERE_VERTICES * 3];
+  GLushort indices[SPHERE_INDICES];
+  int vertex = 0;
+  for (int ring = 0; ring <= SPHERE_RINGS; ++ring)
+  {
+    float theta = PI * ring / SPHERE_RINGS;
+    for (int segment = 0; segment <= SPHERE_SEGMENTS; ++segment)
+    {
+      float phi = 2.0f * PI * segment / SPHERE_SEGMENTS;
+      vertices[vertex++] = scale * sinf(theta) * cosf(phi);
+      vertices[vertex++] = scale * cosf(theta);
+      vertices[vertex++] = scale * sinf(theta) * sinf(phi);
+    }
+  }
+  int index = 0;
+  for (int ring = 0; ring < SPHERE_RINGS; ++ring)
+  {
+    for (int segment = 0; segment < SPHERE_SEGMENTS; ++segment)
+    {
+      GLushort a = ring * (SPHERE_SEGMENTS + 1) + segment;
+      GLushort b = a + SPHERE_SEGMENTS + 1;
+      // Counter-clockwise seen from outside
+      indices[index++] = a;
+      indices[index++] = a + 1;
+      indices[index++] = b;
+      indices[index++] = b;
+      indices[index++] = a + 1;
+      indices[index++] = b + 1;
+    }
+  }
+
+  glGenVertexArrays(1, &deferred->sphereVao);
+  glGenBuffers(1, &deferred->sphereVbo);
+  glGenBuffers(1, &deferred->sphereEbo);
+  glBindVertexArray(deferred->sphereVao);
+  glBindBuffer(GL_ARRAY_BUFFER, deferred->sphereVbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 3, (void *)0);
+  glEnableVertexAttribArray(0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, deferred->sphereEbo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+  glrTrackBuffer(deferred->sphereVbo, sizeof(vertices), GLR_MEMORY_GEOMETRY, "glrCreateDeferred");
+  glrTrackBuffer(deferred->sphereEbo, sizeof(indices), GLR_MEMORY_GEOMETRY, "glrCreateDeferred");
+
+  // One light per instance, the attributes point into the ring every frame.
+  for (GLuint i = 0; i < INSTANCE_ATTRIBUTES; ++i)
+  {
+    glVertexAttribDivisor(i + 1, 1);
+    glEnableVertexAttribArray(i + 1);
+  }
+  glBindVertexArray(0);
+  deferred->lightsRing = glrCreateRingBuffer(sizeof(GLfloat) * LIGHT_FLOATS * RING_LIGHTS);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glrStats()->uploadBytes += sizeof(vertices) + sizeof(indices);
+}
+
+GlrDeferred *glrCreateDeferred(int width, int height, const GLchar **error)
+{
+  GLuint directionalProgram = glCreateProgram();
+  GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+  *error = compileProgram(directionalProgram, vertexShader, glrFullscreenVertexShader(vertexShader),
+                          DIRECTIONAL_FRAGMENT_SHADER, sizeof(DIRECTIONAL_FRAGMENT_SHADER) - 1);
+  if (*error != NULL)
+  {
+    glDeleteProgram(directionalProgram);
+    return NULL;
+  }
+  GLuint volumeProgram = glCreateProgram();
+  vertexShader = glCreateShader(GL_VERTEX_SHADER);
+  *error = compileProgram(volumeProgram, vertexShader,
+                          glrShaderSource(vertexShader, VOLUME_VERTEX_SHADER, sizeof(VOLUME_VERTEX_SHADER) - 1),
+                          VOLUME_FRAGMENT_SHADER, sizeof(VOLUME_FRAGMENT_SHADER) - 1);
+  if (*error != NULL)
+  {
+    glDeleteProgram(directionalProgram);
+    glDeleteProgram(volumeProgram);
+    return NULL;
+  }
+
+  GlrDeferred *deferred = (GlrDeferred *)calloc(1, sizeof(GlrDeferred));
+  deferred->width = width;
+  deferred->height = height;
+
+  deferred->directionalProgram = directionalProgram;
+  bindGBufferSamplers(directionalProgram, &deferred->directionalLocations);
+  deferred->directionLocation = glGetUniformLocation(directionalProgram, "direction");
+  deferred->ambientLocation = glGetUniformLocation(directionalProgram, "ambient");
+  deferred->diffuseLocation = glGetUniformLocation(directionalProgram, "diffuse");
+  deferred->specularLocation = glGetUniformLocation(directionalProgram, "specular");
+  deferred->volumeProgram = volumeProgram;
+  bindGBufferSamplers(volumeProgram, &deferred->volumeLocations);
+  deferred->viewProjectionLocation = glGetUniformLocation(volumeProgram, "viewProjection");
+  deferred->screenSizeLocation = glGetUniformLocation(volumeProgram, "screenSize");
+  glUniform2f(deferred->screenSizeLocation, (GLfloat)width, (GLfloat)height);
+  glUseProgram(0);
+
+  // The lighting passes read the G-buffer texels 1:1, post-processing passes may downsample the light buffer.
+  deferred->albedo = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_NEAREST, width, height);
+  deferred->specular = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_NEAREST, width, height);
+  deferred->normal = createTarget(GL_RGBA16F, GL_RGBA, GL_FLOAT, GL_NEAREST, width, height);
+  deferred->depth = createTarget(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT, GL_NEAREST, width, height);
+  deferred->light = createTarget(GL_RGBA16F, GL_RGBA, GL_FLOAT, GL_LINEAR, width, height);
+
+  static const GLenum DRAW_BUFFERS[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2};
+  glGenFramebuffers(1, &deferred->framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, deferred->framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, deferred->albedo, 0);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, deferred->specular, 0);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, deferred->normal, 0);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, deferred->depth, 0);
+  glDrawBuffers(sizeof(DRAW_BUFFERS) / sizeof(DRAW_BUFFERS[0]), DRAW_BUFFERS);
+  *error = checkFramebuffer("G-buffer");
+
+  // The light buffer shares the depth, so volumes are depth tested and forward passes can draw on top.
+  glGenFramebuffers(1, &deferred->lightFramebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, deferred->lightFramebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, deferred->light, 0);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, deferred->depth, 0);
+  if (*error == NULL)
+  {
+    *error = checkFramebuffer("Light");
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  glGenVertexArrays(1, &deferred->emptyVao);
+  createSphere(deferred);
+
+  if (*error != NULL)
+  {
+    glrFreeDeferred(deferred);
+    return NULL;
+  }
+  return deferred;
+}
+
+void glrBeginGeometryPass(GlrDeferred *deferred)
+{
+  glBindFramebuffer(GL_FRAMEBUFFER, deferred->framebuffer);
+  ++glrStats()->framebufferBinds;
+  glViewport(0, 0, deferred->width, deferred->height);
+  // Background pixels keep depth 1 and are skipped by the lighting.
+  static const GLfloat ZERO[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  glClearBufferfv(GL_COLOR, 0, ZERO);
+  glClearBufferfv(GL_COLOR, 1, ZERO);
+  glClearBufferfv(GL_COLOR, 2, ZERO);
+  glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+static void setGBufferUniforms(GlrGBufferLocations *locations, const float inverseViewProjection[16],
+                               const float viewPosition[3])
+{
+  GlrStats *stats = glrStats();
+  glUniformMatrix4fv(locations->inverseViewProjection, 1, GL_FALSE, inverseViewProjection);
+  glUniform3fv(locations->viewPos, 1, viewPosition);
+  stats->uniformCalls += 2;
+  stats->uniformBytes += sizeof(GLfloat) * 19;
+}
+
+void glrDrawDeferredLights(
+    GlrDeferred *deferred,
+    const float viewProjection[16],
+    const float viewPosition[3],
+    const GlrDirectionalLight *directionalLight,
+    const GlrLight *lights,
+    GLuint lightsLen)
+{
+  GlrStats *stats = glrStats();
+  glrProfileGpuBegin("Deferred lights");
+
+  float inverseViewProjection[16];
+  invert(viewProjection, inverseViewProjection);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, deferred->lightFramebuffer);
+  ++glrStats()->framebufferBinds;
+  glViewport(0, 0, deferred->width, deferred->height);
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  GLuint textures[4] = {deferred->albedo, deferred->specular, deferred->normal, deferred->depth};
+  for (int i = 0; i < 4; ++i)
+  {
+    glActiveTexture(GL_TEXTURE0 + i);
+    glBindTexture(GL_TEXTURE_2D, textures[i]);
+  }
+  stats->textureBinds += 4;
+
+  // Lights add up, and none of them writes depth.
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE, GL_ONE);
+  glDepthMask(GL_FALSE);
+
+  if (directionalLight != NULL)
+  {
+    glDisable(GL_DEPTH_TEST);
+    glUseProgram(deferred->directionalProgram);
+    glBindVertexArray(deferred->emptyVao);
+    ++stats->programSwitches;
+    ++stats->vaoBinds;
+    setGBufferUniforms(&deferred->directionalLocations, inverseViewProjection, viewPosition);
+    glUniform3fv(deferred->directionLocation, 1, directionalLight->direction);
+    glUniform3fv(deferred->ambientLocation, 1, directionalLight->ambient);
+    glUniform3fv(deferred->diffuseLocation, 1, directionalLight->diffuse);
+    glUniform3fv(deferred->specularLocation, 1, directionalLight->specular);
+    stats->uniformCalls += 4;
+    stats->uniformBytes += sizeof(GLfloat) * 12;
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glrStatsCountDraw(GL_TRIANGLES, 3);
+  }
+
+  GLintptr offset;
+  if (lightsLen > 0 && writeLights(deferred, lights, lightsLen, &offset))
+  {
+    // Back faces behind the surface shade it, which also works with the camera inside a volume. Depth clamping
+    // keeps the back faces beyond the far plane.
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_GEQUAL);
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_FRONT);
+    glEnable(GL_DEPTH_CLAMP);
+
+    glUseProgram(deferred->volumeProgram);
+    glBindVertexArray(deferred->sphereVao);
+    glBindBuffer(GL_ARRAY_BUFFER, deferred->lightsRing->buffer);
+    pointInstanceAttributes(offset);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    ++stats->programSwitches;
+    ++stats->vaoBinds;
+    setGBufferUniforms(&deferred->volumeLocations, inverseViewProjection, viewPosition);
+    glUniformMatrix4fv(deferred->viewProjectionLocation, 1, GL_FALSE, viewProjection);
+    ++stats->uniformCalls;
+    stats->uniformBytes += sizeof(GLfloat) * 16;
+    glDrawElementsInstanced(GL_TRIANGLES, SPHERE_INDICES, GL_UNSIGNED_SHORT, (void *)0, lightsLen);
+    glrStatsCountDraw(GL_TRIANGLES, SPHERE_INDICES * lightsLen);
+    glrRingEndFrame(deferred->lightsRing);
+
+    glDisable(GL_DEPTH_CLAMP);
+    glCullFace(GL_BACK);
+    glDisable(GL_CULL_FACE);
+    glDepthFunc(GL_LESS);
+  }
+
+  glEnable(GL_DEPTH_TEST);
+  glDepthMask(GL_TRUE);
+  glDisable(GL_BLEND);
+  glBindVertexArray(0);
+  glActiveTexture(GL_TEXTURE0);
+  glrProfileGpuEnd();
+}
+
+void glrPresentDeferred(GlrDeferred *deferred)
+{
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, deferred->lightFramebuffer);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+  ++glrStats()->framebufferBinds;
+  glBlitFramebuffer(0, 0, deferred->width, deferred->height, 0, 0, deferred->width, deferred->height,
+                    GL_COLOR_BUFFER_BIT, GL_NEAREST);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  ++glrStats()->framebufferBinds;
+}
+
+void glrFreeDeferred(GlrDeferred *deferred)
+{
+  GLuint textures[5] = {deferred->albedo, deferred->specular, deferred->normal, deferred->depth, deferred->light};
+  for (int i = 0; i < 5; ++i)
+  {
+    glrUntrackTexture(textures[i]);
+  }
+  glDeleteTextures(5, textures);
+  glDeleteFramebuffers(1, &deferred->framebuffer);
+  glDeleteFramebuffers(1, &deferred->lightFramebuffer);
+  glDeleteProgram(deferred->directionalProgram);
+  glDeleteProgram(deferred->volumeProgram);
+  glDeleteVertexArrays(1, &deferred->emptyVao);
+  glDeleteVertexArrays(1, &deferred->sphereVao);
+  glrUntrackBuffer(deferred->sphereVbo);
+  glrUntrackBuffer(deferred->sphereEbo);
+  glDeleteBuffers(1, &deferred->sphereVbo);
+  glDeleteBuffers(1, &deferred->sphereEbo);
+  glrFreeRingBuffer(deferred->lightsRing);
+  free(deferred);
+}
@@ -0,0 +1,253 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "glr.h"
+
+// The limiter sleeps until this long before the deadline and spins for the rest, sleeps overshoot by up to the
+// scheduler granularity.
+#ifdef _WIN32
+#define SPIN_SECONDS 0.002
+#else
+#define SPIN_SECONDS 0.001
+#endif
+// Frames of present timestamps in flight, results are read back this many frames later so it never stalls.
+#define LATENCY_FRAMES 3
+
+typedef struct GlrFrame
+{
+  GlrSwapMode swapMode;
+  double targetFps;
+  // Deadline of the next swap when the limiter is on
+  double nextSwapTime;
+  double lastSwapTime;
+
+  // Time of the last glrPollEvents, the input of the next frame is sampled there
+  double pollTime;
+  // Whether the poll time is passed by glrFrameInputSampledAt instead
+  int isInputSampledAt;
+  GLuint queries[LATENCY_FRAMES];
+  // Poll time of the frame presented with each query, 0 when the query is unused
+  double queryPollTimes[LATENCY_FRAMES];
+  int queryIndex;
+  double latencySum;
+  GLuint64 latencyFrames;
+  // GPU timestamp in seconds minus CPU time in seconds
+  double gpuOffset;
+
+  GlrFrameTiming timing;
+} GlrFrame;
+
+static GlrFrame frame = {0};
+
+static void sleepSeconds(double seconds)
+{
+#ifdef _WIN32
+  Sleep((DWORD)(seconds * 1000.0));
+#else
+  struct timespec duration;
+  duration.tv_sec = (time_t)seconds;
+  duration.tv_nsec = (long)((seconds - duration.tv_sec) * 1.0e9);
+  nanosleep(&duration, NULL);
+#endif
+}
+
+static void waitForNextSwap()
+{
+  double period = 1.0 / frame.targetFps;
+  double now = glfwGetTime();
+  if (frame.nextSwapTime - now > SPIN_SECONDS)
+  {
+    sleepSeconds(frame.nextSwapTime - now - SPIN_SECONDS);
+  }
+  while (glfwGetTime() < frame.nextSwapTime)
+  {
+  }
+
+  // Schedule from the deadline so the rate does not drift, but do not catch up after a frame missed it.
+  frame.nextSwapTime += period;
+  if (frame.nextSwapTime < now)
+  {
+    frame.nextSwapTime = now + period;
+  }
+}
+
+static void collectLatency(int index)
+{
+  if (frame.queryPollTimes[index] == 0.0)
+  {
+    return;
+  }
+
+  GLint isAvailable = GL_FALSE;
+  glGetQueryObjectiv(frame.queries[index], GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+  // Drop the result rather than stalling when the GPU is more than LATENCY_FRAMES behind.
+  if (isAvailable)
+  {
+    GLuint64 presentNs = 0;
+    glGetQueryObjectui64v(frame.queries[index], GL_QUERY_RESULT, &presentNs);
+    double latency = presentNs / 1.0e9 - frame.gpuOffset - frame.queryPollTimes[index];
+    frame.timing.latency = latency;
+    if (latency > frame.timing.latencyMax)
+    {
+      frame.timing.latencyMax = latency;
+    }
+    frame.latencySum += latency;
+    ++frame.latencyFrames;
+    frame.timing.latencyMean = frame.latencySum / frame.latencyFrames;
+  }
+  frame.queryPollTimes[index] = 0.0;
+}
+
+// Timestamp the present on the GPU, it completes when the swap has been executed.
+static void timestampPresent()
+{
+  if (frame.pollTime == 0.0)
+  {
+    return;
+  }
+  if (frame.queries[0] == 0)
+  {
+    glGenQueries(LATENCY_FRAMES, frame.queries);
+    // Align the GPU clock to the CPU clock once, the drift over a session is negligible for latency.
+    GLint64 gpuNs = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNs);
+    frame.gpuOffset = gpuNs / 1.0e9 - glfwGetTime();
+  }
+
+  frame.queryIndex = (frame.queryIndex + 1) % LATENCY_FRAMES;
+  collectLatency(frame.queryIndex);
+  glQueryCounter(frame.queries[frame.queryIndex], GL_TIMESTAMP);
+  frame.queryPollTimes[frame.queryIndex] = frame.pollTime;
+  frame.pollTime = 0.0;
+}
+
+static GlrSwapMode parseSwapMode(const char *env, GlrSwapMode swapMode)
+{
+  if (env == NULL || env[0] == '\0')
+  {
+    return swapMode;
+  }
+  if (strcmp(env, "vsync") == 0)
+  {
+    return GLR_SWAP_VSYNC;
+  }
+  if (strcmp(env, "adaptive") == 0)
+  {
+    return GLR_SWAP_ADAPTIVE;
+  }
+  if (strcmp(env, "off") == 0)
+  {
+    return GLR_SWAP_OFF;
+  }
+  fprintf(stderr, "Unknown GLR_SWAP mode: %s\n", env);
+  return swapMode;
+}
+
+void glrFrameInit(GlrSetupArgs *args)
+{
+  GlrSwapMode swapMode = parseSwapMode(getenv("GLR_SWAP"), args->swapMode);
+  const char *fps = getenv("GLR_FPS");
+  double targetFps = fps != NULL && fps[0] != '\0' ? atof(fps) : args->targetFps;
+
+  // The benchmark measures the unthrottled frame time.
+  if (glrBenchmarkActive())
+  {
+    swapMode = GLR_SWAP_OFF;
+    targetFps = 0.0;
+  }
+
+  glrSetSwapMode(swapMode);
+  glrSetFrameLimit(targetFps);
+  frame.lastSwapTime = glfwGetTime();
+}
+
+void glrSetSwapMode(GlrSwapMode swapMode)
+{
+  // Adaptive sync swaps late frames immediately instead of waiting for the next vblank.
+  if (swapMode == GLR_SWAP_ADAPTIVE &&
+      !glfwExtensionSupported("WGL_EXT_swap_control_tear") &&
+      !glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+  {
+    swapMode = GLR_SWAP_VSYNC;
+  }
+
+  switch (swapMode)
+  {
+  case GLR_SWAP_VSYNC:
+    glfwSwapInterval(1);
+    break;
+  case GLR_SWAP_ADAPTIVE:
+    glfwSwapInterval(-1);
+    break;
+  case GLR_SWAP_OFF:
+    glfwSwapInterval(0);
+    break;
+  }
+  frame.swapMode = swapMode;
+}
+
+GlrSwapMode glrGetSwapMode()
+{
+  return frame.swapMode;
+}
+
+void glrSetFrameLimit(double targetFps)
+{
+  frame.targetFps = targetFps > 0.0 ? targetFps : 0.0;
+  frame.nextSwapTime = glfwGetTime();
+}
+
+const GlrFrameTiming *glrFrameTiming()
+{
+  return &frame.timing;
+}
+
+void glrFrameInputSampled()
+{
+  if (!frame.isInputSampledAt)
+  {
+    frame.pollTime = glfwGetTime();
+  }
+}
+
+void glrFrameInputSampledAt(double time)
+{
+  frame.isInputSampledAt = 1;
+  frame.pollTime = time;
+}
+
+void glrSwapBuffers(GLFWwindow *window)
+{
+  glrProfileFrame();
+  glrStatsEndFrame();
+  glrBenchmarkEndFrame(window);
+
+  if (frame.targetFps > 0.0)
+  {
+    waitForNextSwap();
+  }
+  glfwSwapBuffers(window);
+  timestampPresent();
+
+  double now = glfwGetTime();
+  frame.timing.frameTime = now - frame.lastSwapTime;
+  frame.lastSwapTime = now;
+  ++frame.timing.frames;
+
+  glrBenchmarkBeginFrame();
+}
+
+void glrFrameShutdown()
+{
+  if (frame.queries[0] != 0)
+  {
+    glDeleteQueries(LATENCY_FRAMES, frame.queries);
+  }
+  frame = (GlrFrame){0};
+}
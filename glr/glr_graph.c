@@ -0,0 +1,397 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "glr.h"
+
+// Framebuffer binding before the first pass and after a pass binding its own
+#define UNKNOWN_FRAMEBUFFER ((GLuint)-1)
+
+static void *grow(void *array, GLuint len, GLuint *cap, size_t size)
+{
+  if (len < *cap)
+  {
+    return array;
+  }
+  *cap = *cap == 0 ? 8 : *cap * 2;
+  return realloc(array, size * *cap);
+}
+
+static const GLchar *formatError(const GLchar *format, const GLchar *name, GLenum status)
+{
+  int len = snprintf(NULL, 0, format, name, status);
+  GLchar *error = (GLchar *)malloc(len + 1);
+  snprintf(error, len + 1, format, name, status);
+  return error;
+}
+
+GlrRenderGraph *glrCreateRenderGraph(int width, int height)
+{
+  GlrRenderGraph *graph = (GlrRenderGraph *)calloc(1, sizeof(GlrRenderGraph));
+  graph->width = width;
+  graph->height = height;
+  // Resource 0 stands for the default framebuffer.
+  GlrGraphResource *backbuffer = (GlrGraphResource *)grow(NULL, 0, &graph->resourcesCap, sizeof(GlrGraphResource));
+  memset(backbuffer, 0, sizeof(GlrGraphResource));
+  backbuffer->name = "Backbuffer";
+  backbuffer->width = width;
+  backbuffer->height = height;
+  backbuffer->isImported = 1;
+  backbuffer->physical = -1;
+  graph->resources = backbuffer;
+  graph->resourcesLen = 1;
+  return graph;
+}
+
+static GLuint addResource(GlrRenderGraph *graph, const GlrGraphResource *resource)
+{
+  graph->resources = (GlrGraphResource *)grow(graph->resources, graph->resourcesLen, &graph->resourcesCap,
+                                              sizeof(GlrGraphResource));
+  graph->resources[graph->resourcesLen] = *resource;
+  return graph->resourcesLen++;
+}
+
+GLuint glrGraphCreateTexture(GlrRenderGraph *graph, const GLchar *name, int divisor, GLenum format)
+{
+  GlrGraphResource resource = {
+      .name = name,
+      .width = (graph->width + divisor - 1) / divisor,
+      .height = (graph->height + divisor - 1) / divisor,
+      .format = format,
+      .target = GL_TEXTURE_2D,
+      .physical = -1,
+  };
+  return addResource(graph, &resource);
+}
+
+GLuint glrGraphImportTexture(GlrRenderGraph *graph, const GLchar *name, GLenum target, GLuint texture, int width,
+                             int height, GLenum format)
+{
+  GlrGraphResource resource = {
+      .name = name,
+      .width = width,
+      .height = height,
+      .format = format,
+      .target = target,
+      .texture = texture,
+      .isImported = 1,
+      .physical = -1,
+  };
+  return addResource(graph, &resource);
+}
+
+GLuint glrGraphAddPass(GlrRenderGraph *graph, const GLchar *name, GLbitfield clear, GlrGraphPassCallback execute,
+                       void *ctx)
+{
+  graph->passes = (GlrGraphPass *)grow(graph->passes, graph->passesLen, &graph->passesCap, sizeof(GlrGraphPass));
+  GlrGraphPass *pass = &graph->passes[graph->passesLen];
+  memset(pass, 0, sizeof(GlrGraphPass));
+  pass->name = name;
+  pass->clear = clear;
+  pass->execute = execute;
+  pass->ctx = ctx;
+  return graph->passesLen++;
+}
+
+void glrGraphRead(GlrRenderGraph *graph, GLuint pass, GLuint resource)
+{
+  GlrGraphPass *p = &graph->passes[pass];
+  if (p->readsLen < GLR_GRAPH_MAX_READS)
+  {
+    p->reads[p->readsLen++] = resource;
+  }
+}
+
+void glrGraphWrite(GlrRenderGraph *graph, GLuint pass, GLuint resource)
+{
+  GlrGraphPass *p = &graph->passes[pass];
+  if (p->writesLen < GLR_GRAPH_MAX_WRITES)
+  {
+    p->writes[p->writesLen++] = resource;
+  }
+}
+
+GLuint glrGraphTexture(const GlrRenderGraph *graph, GLuint resource)
+{
+  return graph->resources[resource].texture;
+}
+
+static int isAttachable(const GlrGraphResource *resource)
+{
+  return resource->target == GL_TEXTURE_2D;
+}
+
+// Walk back from the passes with outputs, keeping the passes whose writes a kept pass reads.
+static void cullPasses(GlrRenderGraph *graph)
+{
+  unsigned char *isNeeded = (unsigned char *)calloc(graph->resourcesLen, 1);
+  for (GLuint i = graph->passesLen; i-- > 0;)
+  {
+    GlrGraphPass *pass = &graph->passes[i];
+    pass->isLive = 0;
+    for (GLuint w = 0; w < pass->writesLen; ++w)
+    {
+      GLuint resource = pass->writes[w];
+      // A partial write may build on an earlier one, so the resource stays needed.
+      if (graph->resources[resource].isImported || isNeeded[resource])
+      {
+        pass->isLive = 1;
+      }
+    }
+    if (pass->isLive)
+    {
+      for (GLuint r = 0; r < pass->readsLen; ++r)
+      {
+        isNeeded[pass->reads[r]] = 1;
+      }
+    }
+  }
+  free(isNeeded);
+}
+
+static void markLifetime(GlrGraphResource *resource, int pass)
+{
+  if (resource->firstPass < 0)
+  {
+    resource->firstPass = pass;
+  }
+  resource->lastPass = pass;
+}
+
+// Give transients whose lifetimes do not overlap the same texture when their size and format match.
+static void aliasTransients(GlrRenderGraph *graph)
+{
+  for (GLuint i = 0; i < graph->resourcesLen; ++i)
+  {
+    graph->resources[i].firstPass = -1;
+    graph->resources[i].lastPass = -1;
+    graph->resources[i].physical = -1;
+  }
+  for (GLuint i = 0; i < graph->passesLen; ++i)
+  {
+    GlrGraphPass *pass = &graph->passes[i];
+    if (!pass->isLive)
+    {
+      continue;
+    }
+    for (GLuint r = 0; r < pass->readsLen; ++r)
+    {
+      markLifetime(&graph->resources[pass->reads[r]], i);
+    }
+    for (GLuint w = 0; w < pass->writesLen; ++w)
+    {
+      markLifetime(&graph->resources[pass->writes[w]], i);
+    }
+  }
+
+  for (GLuint p = 0; p < graph->physicalsLen; ++p)
+  {
+    graph->physicals[p].lastPass = -1;
+  }
+  // A texture is reused once the last pass of its previous resource is done.
+  for (GLuint i = 0; i < graph->resourcesLen; ++i)
+  {
+    GlrGraphResource *resource = &graph->resources[i];
+    if (resource->isImported || resource->firstPass < 0)
+    {
+      continue;
+    }
+    GlrGraphPhysical *match = NULL;
+    for (GLuint p = 0; p < graph->physicalsLen && match == NULL; ++p)
+    {
+      GlrGraphPhysical *physical = &graph->physicals[p];
+      if (physical->width == resource->width && physical->height == resource->height &&
+          physical->format == resource->format && physical->lastPass < resource->firstPass)
+      {
+        match = physical;
+      }
+    }
+    if (match == NULL)
+    {
+      graph->physicals = (GlrGraphPhysical *)grow(graph->physicals, graph->physicalsLen, &graph->physicalsCap,
+                                                  sizeof(GlrGraphPhysical));
+      match = &graph->physicals[graph->physicalsLen++];
+      match->width = resource->width;
+      match->height = resource->height;
+      match->format = resource->format;
+      match->texture =
+          glrCreateTargetTexture(resource->format, resource->width, resource->height, "glrCompileRenderGraph");
+    }
+    match->lastPass = resource->lastPass;
+    resource->physical = (int)(match - graph->physicals);
+    resource->texture = match->texture;
+  }
+}
+
+// Passes drawing into the same attachments share a framebuffer.
+static const GLchar *createFramebuffers(GlrRenderGraph *graph)
+{
+  static const GLenum DRAW_BUFFERS[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2,
+                                        GL_COLOR_ATTACHMENT3};
+  glDeleteFramebuffers(graph->framebuffersLen, graph->framebuffers);
+  graph->framebuffersLen = 0;
+
+  const GLchar *error = NULL;
+  for (GLuint i = 0; i < graph->passesLen; ++i)
+  {
+    GlrGraphPass *pass = &graph->passes[i];
+    pass->framebuffer = UNKNOWN_FRAMEBUFFER;
+    if (!pass->isLive)
+    {
+      continue;
+    }
+
+    GLuint colors[GLR_GRAPH_MAX_WRITES] = {0}, colorsLen = 0, depth = 0;
+    GLenum depthAttachment = GL_DEPTH_ATTACHMENT;
+    const GlrGraphResource *sized = NULL;
+    for (GLuint w = 0; w < pass->writesLen; ++w)
+    {
+      const GlrGraphResource *resource = &graph->resources[pass->writes[w]];
+      if (pass->writes[w] == GLR_GRAPH_BACKBUFFER)
+      {
+        pass->framebuffer = 0;
+        sized = resource;
+      }
+      else if (isAttachable(resource))
+      {
+        GLenum attachment = glrFormatAttachment(resource->format);
+        if (attachment != GL_COLOR_ATTACHMENT0)
+        {
+          depth = resource->texture;
+          depthAttachment = attachment;
+        }
+        else
+        {
+          colors[colorsLen++] = resource->texture;
+        }
+        sized = resource;
+      }
+    }
+    if (sized == NULL)
+    {
+      // The pass binds its own framebuffer.
+      continue;
+    }
+    pass->viewportWidth = sized->width;
+    pass->viewportHeight = sized->height;
+    if (pass->framebuffer == 0)
+    {
+      continue;
+    }
+
+    for (GLuint j = 0; j < i && pass->framebuffer == UNKNOWN_FRAMEBUFFER; ++j)
+    {
+      GlrGraphPass *other = &graph->passes[j];
+      if (other->framebuffer != UNKNOWN_FRAMEBUFFER && other->framebuffer != 0 && other->depth == depth &&
+          other->colorsLen == colorsLen && memcmp(other->colors, colors, sizeof(colors)) == 0)
+      {
+        pass->framebuffer = other->framebuffer;
+      }
+    }
+    memcpy(pass->colors, colors, sizeof(colors));
+    pass->colorsLen = colorsLen;
+    pass->depth = depth;
+    if (pass->framebuffer != UNKNOWN_FRAMEBUFFER)
+    {
+      continue;
+    }
+
+    graph->framebuffers = (GLuint *)grow(graph->framebuffers, graph->framebuffersLen, &graph->framebuffersCap,
+                                         sizeof(GLuint));
+    glGenFramebuffers(1, &pass->framebuffer);
+    graph->framebuffers[graph->framebuffersLen++] = pass->framebuffer;
+    glBindFramebuffer(GL_FRAMEBUFFER, pass->framebuffer);
+    for (GLuint c = 0; c < colorsLen; ++c)
+    {
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + c, GL_TEXTURE_2D, colors[c], 0);
+    }
+    if (depth != 0)
+    {
+      glFramebufferTexture2D(GL_FRAMEBUFFER, depthAttachment, GL_TEXTURE_2D, depth, 0);
+    }
+    if (colorsLen > 0)
+    {
+      glDrawBuffers(colorsLen, DRAW_BUFFERS);
+    }
+    else
+    {
+      glDrawBuffer(GL_NONE);
+      glReadBuffer(GL_NONE);
+    }
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE && error == NULL)
+    {
+      error = formatError("%s framebuffer is incomplete: 0x%x", pass->name, status);
+    }
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  return error;
+}
+
+const GLchar *glrCompileRenderGraph(GlrRenderGraph *graph)
+{
+  cullPasses(graph);
+  aliasTransients(graph);
+  return createFramebuffers(graph);
+}
+
+void glrExecuteRenderGraph(GlrRenderGraph *graph)
+{
+  GlrStats *stats = glrStats();
+  GLuint framebuffer = UNKNOWN_FRAMEBUFFER;
+  int viewportWidth = 0, viewportHeight = 0;
+  for (GLuint i = 0; i < graph->passesLen; ++i)
+  {
+    GlrGraphPass *pass = &graph->passes[i];
+    if (!pass->isLive)
+    {
+      continue;
+    }
+
+    glrProfileBegin(pass->name);
+    glrProfileGpuBegin(pass->name);
+    if (pass->framebuffer != UNKNOWN_FRAMEBUFFER)
+    {
+      if (pass->framebuffer != framebuffer)
+      {
+        glBindFramebuffer(GL_FRAMEBUFFER, pass->framebuffer);
+        ++stats->framebufferBinds;
+        framebuffer = pass->framebuffer;
+      }
+      if (pass->viewportWidth != viewportWidth || pass->viewportHeight != viewportHeight)
+      {
+        glViewport(0, 0, pass->viewportWidth, pass->viewportHeight);
+        viewportWidth = pass->viewportWidth;
+        viewportHeight = pass->viewportHeight;
+      }
+      if (pass->clear != 0)
+      {
+        glClear(pass->clear);
+      }
+    }
+    pass->execute(pass->ctx);
+    if (pass->framebuffer == UNKNOWN_FRAMEBUFFER)
+    {
+      // The pass bound its own framebuffer and viewport.
+      framebuffer = UNKNOWN_FRAMEBUFFER;
+      viewportWidth = viewportHeight = 0;
+    }
+    glrProfileGpuEnd();
+    glrProfileEnd();
+  }
+}
+
+void glrFreeRenderGraph(GlrRenderGraph *graph)
+{
+  glDeleteFramebuffers(graph->framebuffersLen, graph->framebuffers);
+  for (GLuint p = 0; p < graph->physicalsLen; ++p)
+  {
+    glrUntrackTexture(graph->physicals[p].texture);
+    glDeleteTextures(1, &graph->physicals[p].texture);
+  }
+  free(graph->framebuffers);
+  free(graph->physicals);
+  free(graph->resources);
+  free(graph->passes);
+  free(graph);
+}
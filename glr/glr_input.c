@@ -0,0 +1,335 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "glr.h"
+
+// Log layout, in host byte order:
+//
+// header: magic "GLRI", uint32 version, float64 start time
+// events: uint8 type, float64 time followed by the payload of the type
+#define INPUT_LOG_MAGIC "GLRI"
+#define INPUT_LOG_VERSION 2
+// Replay timestep unless `GLR_INPUT_STEP` sets another one
+#define INPUT_REPLAY_TIMESTEP (1.0 / 60.0)
+
+enum
+{
+  // No payload, the time is sampled by glrPollEvents and ends the events polled in the frame
+  INPUT_EVENT_FRAME = 1,
+  // int16 key, uint8 action
+  INPUT_EVENT_KEY = 2,
+  // float64 x, float64 y
+  INPUT_EVENT_CURSOR_POS = 3,
+  // float64 xoffset, float64 yoffset
+  INPUT_EVENT_SCROLL = 4,
+};
+
+enum
+{
+  INPUT_MODE_LIVE = 0,
+  INPUT_MODE_RECORD = 1,
+  INPUT_MODE_REPLAY = 2,
+};
+
+typedef struct GlrInputEvent
+{
+  unsigned char type;
+  double time;
+  short key;
+  unsigned char action;
+  double values[2];
+} GlrInputEvent;
+
+typedef struct GlrInput
+{
+  int mode;
+  FILE *log;
+  // Time of the current frame in record and replay mode
+  double frameTime;
+  double startTime;
+  // Fixed replay timestep, or 0 to replay the recorded frame times
+  double step;
+  // Frames replayed with the fixed timestep
+  GLuint64 frames;
+  // The next event of the replay, read ahead to compare its time
+  GlrInputEvent pending;
+  int hasPending;
+
+  GLFWkeyfun keyCallback;
+  GLFWcursorposfun cursorPosCallback;
+  GLFWscrollfun scrollCallback;
+
+  // Key states recorded into or replayed from the log
+  unsigned char keys[GLFW_KEY_LAST + 1];
+} GlrInput;
+
+static GlrInput input = {0};
+
+// GLFW does not expose the time the OS received an event, so an event carries the time it is dispatched by the poll.
+static void writeEvent(unsigned char type, double time, const void *payload, size_t len)
+{
+  fwrite(&type, 1, 1, input.log);
+  fwrite(&time, sizeof(double), 1, input.log);
+  if (len > 0)
+  {
+    fwrite(payload, 1, len, input.log);
+  }
+}
+
+static void recordKey(GLFWwindow *window, int key, int scancode, int action, int mods)
+{
+  if (key >= 0 && key <= GLFW_KEY_LAST)
+  {
+    unsigned char payload[3];
+    short key16 = (short)key;
+    memcpy(payload, &key16, sizeof(short));
+    payload[2] = (unsigned char)action;
+    writeEvent(INPUT_EVENT_KEY, glfwGetTime(), payload, sizeof(payload));
+    input.keys[key] = action != GLFW_RELEASE ? GLFW_PRESS : GLFW_RELEASE;
+  }
+  if (input.keyCallback != NULL)
+  {
+    input.keyCallback(window, key, scancode, action, mods);
+  }
+}
+
+static void recordCursorPos(GLFWwindow *window, double xpos, double ypos)
+{
+  double payload[2] = {xpos, ypos};
+  writeEvent(INPUT_EVENT_CURSOR_POS, glfwGetTime(), payload, sizeof(payload));
+  if (input.cursorPosCallback != NULL)
+  {
+    input.cursorPosCallback(window, xpos, ypos);
+  }
+}
+
+static void recordScroll(GLFWwindow *window, double xoffset, double yoffset)
+{
+  double payload[2] = {xoffset, yoffset};
+  writeEvent(INPUT_EVENT_SCROLL, glfwGetTime(), payload, sizeof(payload));
+  if (input.scrollCallback != NULL)
+  {
+    input.scrollCallback(window, xoffset, yoffset);
+  }
+}
+
+// Read the next event, returns 0 at the end of the log.
+static int readEvent(GlrInputEvent *event)
+{
+  unsigned char key[3];
+  if (fread(&event->type, 1, 1, input.log) != 1 || fread(&event->time, sizeof(double), 1, input.log) != 1)
+  {
+    return 0;
+  }
+  switch (event->type)
+  {
+  case INPUT_EVENT_FRAME:
+    return 1;
+  case INPUT_EVENT_KEY:
+    if (fread(key, sizeof(key), 1, input.log) != 1)
+    {
+      return 0;
+    }
+    memcpy(&event->key, key, sizeof(short));
+    event->action = key[2];
+    return event->key >= 0 && event->key <= GLFW_KEY_LAST;
+  case INPUT_EVENT_CURSOR_POS:
+  case INPUT_EVENT_SCROLL:
+    return fread(event->values, sizeof(event->values), 1, input.log) == 1;
+  default:
+    return 0;
+  }
+}
+
+static void dispatchEvent(GLFWwindow *window, const GlrInputEvent *event)
+{
+  switch (event->type)
+  {
+  case INPUT_EVENT_KEY:
+    input.keys[event->key] = event->action != GLFW_RELEASE ? GLFW_PRESS : GLFW_RELEASE;
+    if (input.keyCallback != NULL)
+    {
+      input.keyCallback(window, event->key, 0, event->action, 0);
+    }
+    break;
+  case INPUT_EVENT_CURSOR_POS:
+    if (input.cursorPosCallback != NULL)
+    {
+      input.cursorPosCallback(window, event->values[0], event->values[1]);
+    }
+    break;
+  case INPUT_EVENT_SCROLL:
+    if (input.scrollCallback != NULL)
+    {
+      input.scrollCallback(window, event->values[0], event->values[1]);
+    }
+    break;
+  }
+}
+
+// Dispatch the events of the next frame, returns 0 at the end of the log.
+static int replayFrame(GLFWwindow *window)
+{
+  if (input.step <= 0.0)
+  {
+    // The recorded frames are replayed one by one, with their own times.
+    GlrInputEvent event;
+    while (readEvent(&event))
+    {
+      if (event.type == INPUT_EVENT_FRAME)
+      {
+        input.frameTime = event.time;
+        return 1;
+      }
+      dispatchEvent(window, &event);
+    }
+    return 0;
+  }
+
+  // The clock advances by the fixed step and every event up to it is dispatched, however the frames were recorded.
+  // The frame times multiply instead of adding up, so they do not drift over a long session.
+  input.frameTime = input.startTime + ++input.frames * input.step;
+  while (input.hasPending && input.pending.time <= input.frameTime)
+  {
+    dispatchEvent(window, &input.pending);
+    input.hasPending = readEvent(&input.pending);
+  }
+  return input.hasPending;
+}
+
+void glrInputInit(GLFWwindow *window)
+{
+  input.frameTime = glfwGetTime();
+
+  const char *replayFile = getenv("GLR_INPUT_REPLAY");
+  const char *recordFile = getenv("GLR_INPUT_RECORD");
+  if (replayFile != NULL && replayFile[0] != '\0')
+  {
+    input.log = fopen(replayFile, "rb");
+    char magic[4];
+    unsigned int version = 0;
+    if (input.log == NULL ||
+        fread(magic, sizeof(magic), 1, input.log) != 1 ||
+        memcmp(magic, INPUT_LOG_MAGIC, sizeof(magic)) != 0 ||
+        fread(&version, sizeof(version), 1, input.log) != 1 ||
+        version != INPUT_LOG_VERSION ||
+        fread(&input.startTime, sizeof(double), 1, input.log) != 1)
+    {
+      fprintf(stderr, "Invalid input log: %s\n", replayFile);
+      if (input.log != NULL)
+      {
+        fclose(input.log);
+        input.log = NULL;
+      }
+      return;
+    }
+    input.mode = INPUT_MODE_REPLAY;
+    input.frameTime = input.startTime;
+    const char *step = getenv("GLR_INPUT_STEP");
+    input.step = step != NULL && step[0] != '\0' ? atof(step) : INPUT_REPLAY_TIMESTEP;
+    input.hasPending = readEvent(&input.pending);
+  }
+  else if (recordFile != NULL && recordFile[0] != '\0')
+  {
+    input.log = fopen(recordFile, "wb");
+    if (input.log == NULL)
+    {
+      perror(recordFile);
+      return;
+    }
+    unsigned int version = INPUT_LOG_VERSION;
+    fwrite(INPUT_LOG_MAGIC, 4, 1, input.log);
+    fwrite(&version, sizeof(version), 1, input.log);
+    fwrite(&input.frameTime, sizeof(double), 1, input.log);
+    input.mode = INPUT_MODE_RECORD;
+  }
+
+  if (input.mode == INPUT_MODE_RECORD)
+  {
+    input.keyCallback = glfwSetKeyCallback(window, recordKey);
+  }
+}
+
+int glrInputReplaying()
+{
+  return input.mode == INPUT_MODE_REPLAY;
+}
+
+int glrInputFrameTime(double *time)
+{
+  if (input.mode == INPUT_MODE_LIVE)
+  {
+    return 0;
+  }
+  *time = input.frameTime;
+  return 1;
+}
+
+int glrGetKey(GLFWwindow *window, int key)
+{
+  // Recording reads the same key states as replaying, so both see identical input.
+  if (input.mode != INPUT_MODE_LIVE)
+  {
+    return key >= 0 && key <= GLFW_KEY_LAST ? input.keys[key] : GLFW_RELEASE;
+  }
+  return glfwGetKey(window, key);
+}
+
+void glrSetCursorPosCallback(GLFWwindow *window, GLFWcursorposfun callback)
+{
+  input.cursorPosCallback = callback;
+  switch (input.mode)
+  {
+  case INPUT_MODE_LIVE:
+    glfwSetCursorPosCallback(window, callback);
+    break;
+  case INPUT_MODE_RECORD:
+    glfwSetCursorPosCallback(window, recordCursorPos);
+    break;
+  }
+}
+
+void glrSetScrollCallback(GLFWwindow *window, GLFWscrollfun callback)
+{
+  input.scrollCallback = callback;
+  switch (input.mode)
+  {
+  case INPUT_MODE_LIVE:
+    glfwSetScrollCallback(window, callback);
+    break;
+  case INPUT_MODE_RECORD:
+    glfwSetScrollCallback(window, recordScroll);
+    break;
+  }
+}
+
+void glrPollEvents(GLFWwindow *window)
+{
+  glfwPollEvents();
+  glrFrameInputSampled();
+
+  switch (input.mode)
+  {
+  case INPUT_MODE_RECORD:
+    input.frameTime = glfwGetTime();
+    writeEvent(INPUT_EVENT_FRAME, input.frameTime, NULL, 0);
+    break;
+  case INPUT_MODE_REPLAY:
+    // Live events are ignored, one step of the log is replayed per rendered frame.
+    if (!replayFrame(window))
+    {
+      glfwSetWindowShouldClose(window, GLFW_TRUE);
+    }
+    break;
+  }
+}
+
+void glrInputShutdown()
+{
+  if (input.log != NULL)
+  {
+    fclose(input.log);
+  }
+  input = (GlrInput){0};
+}
@@ -0,0 +1,266 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "glr.h"
+#include "glr_simd.h"
+
+// Light volumes end where a light is dimmer than this fraction of its brightest color
+#define LIGHT_THRESHOLD (5.0f / 256.0f)
+// Radius of lights without an end, a huge sphere covers the far plane like an infinite one and keeps the math finite
+#define MAX_LIGHT_RADIUS 1.0e6f
+// Objects per job chunk
+#define ASSIGN_GRAIN 64
+
+typedef struct AssignJob
+{
+  GlrObjectLights *objectLights;
+  const GlrLight *lights;
+  const GlrBounds *bounds;
+} AssignJob;
+
+static float max3(const float v[3])
+{
+  float m = v[0] > v[1] ? v[0] : v[1];
+  return m > v[2] ? m : v[2];
+}
+
+static float brightest(const GlrLight *light)
+{
+  return fmaxf(max3(light->diffuse), fmaxf(max3(light->specular), max3(light->ambient)));
+}
+
+float glrLightRadius(const GlrLight *light)
+{
+  // Solve constant + linear * d + quadratic * d^2 = brightest / threshold for the distance d.
+  float k = brightest(light) / LIGHT_THRESHOLD;
+  if (k <= light->constant)
+  {
+    return 0.0f;
+  }
+  float radius = MAX_LIGHT_RADIUS;
+  if (light->quadratic > 0.0f)
+  {
+    radius = (-light->linear + sqrtf(light->linear * light->linear - 4.0f * light->quadratic * (light->constant - k))) /
+             (2.0f * light->quadratic);
+  }
+  else if (light->linear > 0.0f)
+  {
+    radius = (k - light->constant) / light->linear;
+  }
+  return fminf(radius, MAX_LIGHT_RADIUS);
+}
+
+void glrPackLight(const GlrLight *light, float radius, float packed[GLR_LIGHT_VEC4S * 4])
+{
+  memcpy(packed, light->position, sizeof(float) * 3), packed[3] = radius;
+  memcpy(packed + 4, light->ambient, sizeof(float) * 3), packed[7] = light->constant;
+  memcpy(packed + 8, light->diffuse, sizeof(float) * 3), packed[11] = light->linear;
+  memcpy(packed + 12, light->specular, sizeof(float) * 3), packed[15] = light->quadratic;
+  memcpy(packed + 16, light->direction, sizeof(float) * 3), packed[19] = light->cutOff;
+  packed[20] = light->outerCutOff, packed[21] = 0.0f, packed[22] = 0.0f, packed[23] = 0.0f;
+}
+
+static void reserveObjects(GlrObjectLights *objectLights, GLuint len)
+{
+  if (len <= objectLights->objectsCap)
+  {
+    return;
+  }
+  objectLights->objectsCap = objectLights->objectsCap == 0 ? 64 : objectLights->objectsCap * 2;
+  if (objectLights->objectsCap < len)
+  {
+    objectLights->objectsCap = len;
+  }
+  size_t slots = (size_t)objectLights->objectsCap * objectLights->maxLightsPerObject;
+  objectLights->counts = (GLuint *)realloc(objectLights->counts, sizeof(GLuint) * objectLights->objectsCap);
+  objectLights->indices = (GLuint *)realloc(objectLights->indices, sizeof(GLuint) * slots);
+  objectLights->scores = (float *)realloc(objectLights->scores, sizeof(float) * slots);
+}
+
+static void reserveLights(GlrObjectLights *objectLights, GLuint len)
+{
+  if (len <= objectLights->lightsCap)
+  {
+    return;
+  }
+  objectLights->lightsCap = objectLights->lightsCap == 0 ? 64 : objectLights->lightsCap * 2;
+  if (objectLights->lightsCap < len)
+  {
+    objectLights->lightsCap = len;
+  }
+  // x, y, z and radius of each light
+  objectLights->spheres = (float *)realloc(objectLights->spheres, sizeof(float) * 4 * objectLights->lightsCap);
+  objectLights->packed =
+      (float *)realloc(objectLights->packed, sizeof(float) * 4 * GLR_LIGHT_VEC4S * objectLights->lightsCap);
+}
+
+// Keep a light hitting an object. When the list is full, the light replaces the weakest one if it is stronger.
+static void keepLight(GlrObjectLights *objectLights, const GlrLight *light, GLuint object, GLuint index,
+                      float distanceSquared)
+{
+  GLuint max = objectLights->maxLightsPerObject;
+  GLuint *indices = objectLights->indices + (size_t)object * max;
+  float *scores = objectLights->scores + (size_t)object * max;
+  GLuint *count = &objectLights->counts[object];
+
+  // Brightness at the closest point of the object
+  float d = sqrtf(distanceSquared);
+  float score = brightest(light) / (light->constant + light->linear * d + light->quadratic * d * d);
+  if (*count < max)
+  {
+    indices[*count] = index;
+    scores[*count] = score;
+    ++*count;
+    return;
+  }
+
+  GLuint weakest = 0;
+  for (GLuint i = 1; i < max; ++i)
+  {
+    weakest = scores[i] < scores[weakest] ? i : weakest;
+  }
+  if (score > scores[weakest])
+  {
+    indices[weakest] = index;
+    scores[weakest] = score;
+  }
+}
+
+// Test the light spheres against an object's box, a sphere is a box of extent 0 with a larger radius.
+static void assignObject(GlrObjectLights *objectLights, const GlrLight *lights, const GlrBounds *bounds, GLuint object)
+{
+  float center[3] = {bounds->x[object], bounds->y[object], bounds->z[object]};
+  float extent[3] = {0.0f, 0.0f, 0.0f};
+  float grow = 0.0f;
+  if (bounds->radius != NULL)
+  {
+    grow = bounds->radius[object];
+  }
+  else
+  {
+    extent[0] = bounds->extentX[object];
+    extent[1] = bounds->extentY[object];
+    extent[2] = bounds->extentZ[object];
+  }
+
+  objectLights->counts[object] = 0;
+  const float *spheres = objectLights->spheres;
+  GLuint len = objectLights->lightsLen;
+  GLuint cap = objectLights->lightsCap;
+  const float *x = spheres, *y = spheres + cap, *z = spheres + cap * 2, *radius = spheres + cap * 3;
+  GLuint l = 0;
+
+#if LANES > 1
+  Vec cx = vecSet1(center[0]), cy = vecSet1(center[1]), cz = vecSet1(center[2]);
+  Vec ex = vecSet1(extent[0]), ey = vecSet1(extent[1]), ez = vecSet1(extent[2]);
+  Vec g = vecSet1(grow), zero = vecZero();
+  for (; l + LANES <= len; l += LANES)
+  {
+    Vec px = vecLoad(&x[l]), py = vecLoad(&y[l]), pz = vecLoad(&z[l]);
+    Vec dx = vecMax(zero, vecSub(vecMax(vecSub(px, cx), vecSub(cx, px)), ex));
+    Vec dy = vecMax(zero, vecSub(vecMax(vecSub(py, cy), vecSub(cy, py)), ey));
+    Vec dz = vecMax(zero, vecSub(vecMax(vecSub(pz, cz), vecSub(cz, pz)), ez));
+    Vec distance = vecAdd(vecAdd(vecMul(dx, dx), vecMul(dy, dy)), vecMul(dz, dz));
+    Vec reach = vecAdd(vecLoad(&radius[l]), g);
+    int mask = vecIsLessEqual(distance, vecMul(reach, reach));
+    for (int lane = 0; mask != 0; ++lane, mask >>= 1)
+    {
+      if (mask & 1)
+      {
+        float d[3] = {fmaxf(0.0f, fabsf(x[l + lane] - center[0]) - extent[0]),
+                      fmaxf(0.0f, fabsf(y[l + lane] - center[1]) - extent[1]),
+                      fmaxf(0.0f, fabsf(z[l + lane] - center[2]) - extent[2])};
+        float closest = fmaxf(0.0f, sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) - grow);
+        keepLight(objectLights, &lights[l + lane], object, l + lane, closest * closest);
+      }
+    }
+  }
+#endif
+
+  for (; l < len; ++l)
+  {
+    float d[3] = {fmaxf(0.0f, fabsf(x[l] - center[0]) - extent[0]),
+                  fmaxf(0.0f, fabsf(y[l] - center[1]) - extent[1]),
+                  fmaxf(0.0f, fabsf(z[l] - center[2]) - extent[2])};
+    float distance = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    if (distance <= radius[l] + grow)
+    {
+      float closest = fmaxf(0.0f, distance - grow);
+      keepLight(objectLights, &lights[l], object, l, closest * closest);
+    }
+  }
+}
+
+static void assignObjects(GLuint begin, GLuint end, void *ctx)
+{
+  AssignJob *job = (AssignJob *)ctx;
+  for (GLuint object = begin; object < end; ++object)
+  {
+    assignObject(job->objectLights, job->lights, job->bounds, object);
+  }
+}
+
+GlrObjectLights *glrCreateObjectLights(GLuint maxLightsPerObject)
+{
+  GlrObjectLights *objectLights = (GlrObjectLights *)calloc(1, sizeof(GlrObjectLights));
+  objectLights->maxLightsPerObject = maxLightsPerObject;
+  objectLights->uniformData = (float *)malloc(sizeof(float) * 4 * GLR_LIGHT_VEC4S * maxLightsPerObject);
+  return objectLights;
+}
+
+void glrAssignObjectLights(GlrObjectLights *objectLights, const GlrLight *lights, GLuint lightsLen,
+                           const GlrBounds *bounds)
+{
+  reserveObjects(objectLights, bounds->len);
+  reserveLights(objectLights, lightsLen);
+  objectLights->objectsLen = bounds->len;
+  objectLights->lightsLen = lightsLen;
+
+  GLuint cap = objectLights->lightsCap;
+  for (GLuint l = 0; l < lightsLen; ++l)
+  {
+    float radius = glrLightRadius(&lights[l]);
+    objectLights->spheres[l] = lights[l].position[0];
+    objectLights->spheres[cap + l] = lights[l].position[1];
+    objectLights->spheres[cap * 2 + l] = lights[l].position[2];
+    objectLights->spheres[cap * 3 + l] = radius;
+    glrPackLight(&lights[l], radius, &objectLights->packed[l * 4 * GLR_LIGHT_VEC4S]);
+  }
+
+  AssignJob job = {.objectLights = objectLights, .lights = lights, .bounds = bounds};
+  glrParallelFor(bounds->len, ASSIGN_GRAIN, assignObjects, &job);
+}
+
+void glrObjectLightsUniforms(GlrObjectLights *objectLights, GLuint object, GLint countLocation, GLint lightsLocation)
+{
+  GlrStats *stats = glrStats();
+  GLuint count = object < objectLights->objectsLen ? objectLights->counts[object] : 0;
+  const GLuint *indices = objectLights->indices + (size_t)object * objectLights->maxLightsPerObject;
+  for (GLuint i = 0; i < count; ++i)
+  {
+    memcpy(&objectLights->uniformData[i * 4 * GLR_LIGHT_VEC4S], &objectLights->packed[indices[i] * 4 * GLR_LIGHT_VEC4S],
+           sizeof(float) * 4 * GLR_LIGHT_VEC4S);
+  }
+
+  glUniform1i(countLocation, (GLint)count);
+  ++stats->uniformCalls;
+  stats->uniformBytes += sizeof(GLint);
+  if (count > 0)
+  {
+    glUniform4fv(lightsLocation, count * GLR_LIGHT_VEC4S, objectLights->uniformData);
+    ++stats->uniformCalls;
+    stats->uniformBytes += sizeof(GLfloat) * 4 * GLR_LIGHT_VEC4S * count;
+  }
+}
+
+void glrFreeObjectLights(GlrObjectLights *objectLights)
+{
+  free(objectLights->counts);
+  free(objectLights->indices);
+  free(objectLights->scores);
+  free(objectLights->spheres);
+  free(objectLights->packed);
+  free(objectLights->uniformData);
+  free(objectLights);
+}
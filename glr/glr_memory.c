@@ -0,0 +1,281 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "glr.h"
+
+static const char *CATEGORY_NAMES[GLR_MEMORY_CATEGORIES] = {"geometry", "streaming", "textures", "renderTargets"};
+
+static GlrMemoryAllocation *allocations = NULL;
+static GLuint allocationsLen = 0;
+static GLuint allocationsCap = 0;
+static GlrMemoryStats stats = {0};
+static GLuint64 budget = 0;
+static int isBudgetRead = 0;
+static int isOverBudget = 0;
+
+// Bytes per texel of an internal format. Drivers pad 3 component formats to 4.
+static GLuint64 texelBytes(GLenum format)
+{
+  switch (format)
+  {
+  case GL_R8:
+  case GL_RED:
+  case GL_STENCIL_INDEX8:
+    return 1;
+  case GL_RG8:
+  case GL_RG:
+  case GL_R16F:
+  case GL_DEPTH_COMPONENT16:
+    return 2;
+  case GL_RG16F:
+  case GL_R32F:
+  case GL_R32UI:
+  case GL_R11F_G11F_B10F:
+  case GL_DEPTH_COMPONENT24:
+  case GL_DEPTH_COMPONENT32F:
+  case GL_DEPTH24_STENCIL8:
+  case GL_DEPTH_COMPONENT:
+    return 4;
+  case GL_RGB16F:
+  case GL_RGBA16F:
+  case GL_RG32F:
+  case GL_RG32UI:
+  case GL_DEPTH32F_STENCIL8:
+    return 8;
+  case GL_RGB32F:
+  case GL_RGBA32F:
+  case GL_RGBA32UI:
+    return 16;
+  default:
+    return 4;
+  }
+}
+
+static void readBudget()
+{
+  isBudgetRead = 1;
+  const char *env = getenv("GLR_MEMORY_BUDGET");
+  if (env != NULL && budget == 0)
+  {
+    budget = (GLuint64)strtoull(env, NULL, 10) * 1024 * 1024;
+  }
+}
+
+static GlrMemoryAllocation *findAllocation(GLuint name, int isTexture)
+{
+  for (GLuint i = 0; i < allocationsLen; ++i)
+  {
+    if (allocations[i].name == name && allocations[i].isTexture == isTexture)
+    {
+      return &allocations[i];
+    }
+  }
+  return NULL;
+}
+
+static void addBytes(GlrMemoryCategory category, GLint64 bytes)
+{
+  stats.bytes += bytes;
+  stats.categoryBytes[category] += bytes;
+  stats.peakBytes = stats.bytes > stats.peakBytes ? stats.bytes : stats.peakBytes;
+  if (stats.categoryBytes[category] > stats.categoryPeakBytes[category])
+  {
+    stats.categoryPeakBytes[category] = stats.categoryBytes[category];
+  }
+
+  if (!isBudgetRead)
+  {
+    readBudget();
+  }
+  if (budget > 0 && stats.bytes > budget && !isOverBudget)
+  {
+    fprintf(stderr, "glr: GPU memory %.1f MiB is over the budget of %.1f MiB\n", stats.bytes / 1048576.0,
+            budget / 1048576.0);
+  }
+  isOverBudget = budget > 0 && stats.bytes > budget;
+}
+
+// Record an allocation, replacing the size of an object allocated again.
+static void track(GLuint name, int isTexture, GlrMemoryCategory category, const char *owner, GLenum format,
+                  int width, int height, int layers, GLuint64 bytes)
+{
+  if (name == 0)
+  {
+    return;
+  }
+  GlrMemoryAllocation *allocation = findAllocation(name, isTexture);
+  if (allocation != NULL)
+  {
+    addBytes(allocation->category, -(GLint64)allocation->bytes);
+  }
+  else
+  {
+    if (allocationsLen == allocationsCap)
+    {
+      allocationsCap = allocationsCap == 0 ? 64 : allocationsCap * 2;
+      allocations = (GlrMemoryAllocation *)realloc(allocations, sizeof(GlrMemoryAllocation) * allocationsCap);
+    }
+    allocation = &allocations[allocationsLen++];
+    ++stats.allocations;
+  }
+  *allocation = (GlrMemoryAllocation){
+      .name = name,
+      .isTexture = isTexture,
+      .category = category,
+      .owner = owner,
+      .format = format,
+      .width = width,
+      .height = height,
+      .layers = layers,
+      .bytes = bytes,
+  };
+  addBytes(category, (GLint64)bytes);
+}
+
+static void untrack(GLuint name, int isTexture)
+{
+  GlrMemoryAllocation *allocation = findAllocation(name, isTexture);
+  if (allocation == NULL)
+  {
+    return;
+  }
+  addBytes(allocation->category, -(GLint64)allocation->bytes);
+  *allocation = allocations[--allocationsLen];
+  --stats.allocations;
+}
+
+void glrTrackBuffer(GLuint buffer, GLsizeiptr size, GlrMemoryCategory category, const char *owner)
+{
+  track(buffer, 0, category, owner, GL_NONE, (int)size, 1, 1, (GLuint64)size);
+}
+
+// The glGetIntegerv query of the texture bound to target
+static GLenum textureBinding(GLenum target)
+{
+  switch (target)
+  {
+  case GL_TEXTURE_1D:
+    return GL_TEXTURE_BINDING_1D;
+  case GL_TEXTURE_1D_ARRAY:
+    return GL_TEXTURE_BINDING_1D_ARRAY;
+  case GL_TEXTURE_2D_ARRAY:
+    return GL_TEXTURE_BINDING_2D_ARRAY;
+  case GL_TEXTURE_3D:
+    return GL_TEXTURE_BINDING_3D;
+  case GL_TEXTURE_RECTANGLE:
+    return GL_TEXTURE_BINDING_RECTANGLE;
+  case GL_TEXTURE_CUBE_MAP:
+    return GL_TEXTURE_BINDING_CUBE_MAP;
+  case GL_TEXTURE_CUBE_MAP_ARRAY:
+    return GL_TEXTURE_BINDING_CUBE_MAP_ARRAY;
+  case GL_TEXTURE_2D_MULTISAMPLE:
+    return GL_TEXTURE_BINDING_2D_MULTISAMPLE;
+  case GL_TEXTURE_2D_MULTISAMPLE_ARRAY:
+    return GL_TEXTURE_BINDING_2D_MULTISAMPLE_ARRAY;
+  default:
+    return GL_TEXTURE_BINDING_2D;
+  }
+}
+
+void glrTrackTexture(GLenum target, GLuint texture, GlrMemoryCategory category, const char *owner)
+{
+  // The GL knows the size of every level, including the mipmaps and the compressed ones.
+  GLint bound = 0;
+  glGetIntegerv(textureBinding(target), &bound);
+  glBindTexture(target, texture);
+  GLint width = 0, height = 0, layers = 1, format = GL_NONE;
+  glGetTexLevelParameteriv(target, 0, GL_TEXTURE_WIDTH, &width);
+  glGetTexLevelParameteriv(target, 0, GL_TEXTURE_HEIGHT, &height);
+  glGetTexLevelParameteriv(target, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+  GLuint64 bytes = 0;
+  for (GLint level = 0;; ++level)
+  {
+    GLint levelWidth = 0, levelHeight = 0, levelDepth = 1, isCompressed = GL_FALSE;
+    glGetTexLevelParameteriv(target, level, GL_TEXTURE_WIDTH, &levelWidth);
+    if (levelWidth == 0)
+    {
+      break;
+    }
+    glGetTexLevelParameteriv(target, level, GL_TEXTURE_HEIGHT, &levelHeight);
+    glGetTexLevelParameteriv(target, level, GL_TEXTURE_DEPTH, &levelDepth);
+    glGetTexLevelParameteriv(target, level, GL_TEXTURE_COMPRESSED, &isCompressed);
+    if (level == 0)
+    {
+      layers = levelDepth;
+    }
+    if (isCompressed)
+    {
+      GLint size = 0;
+      glGetTexLevelParameteriv(target, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+      bytes += size;
+    }
+    else
+    {
+      bytes += texelBytes(format) * levelWidth * levelHeight * levelDepth;
+    }
+  }
+  glBindTexture(target, (GLuint)bound);
+  track(texture, 1, category, owner, format, width, height, layers, bytes);
+}
+
+void glrUntrackBuffer(GLuint buffer)
+{
+  untrack(buffer, 0);
+}
+
+void glrUntrackTexture(GLuint texture)
+{
+  untrack(texture, 1);
+}
+
+const GlrMemoryStats *glrMemoryStats()
+{
+  return &stats;
+}
+
+GLuint glrMemoryAllocations(const GlrMemoryAllocation **list)
+{
+  *list = allocations;
+  return allocationsLen;
+}
+
+void glrSetMemoryBudget(GLuint64 bytes)
+{
+  budget = bytes;
+  isBudgetRead = 1;
+}
+
+void glrMemoryDump()
+{
+  const char *env = getenv("GLR_MEMORY");
+  if (env == NULL || env[0] == '\0' || strcmp(env, "0") == 0)
+  {
+    return;
+  }
+
+  fprintf(stderr, "%-16s %12s %12s\n", "glr memory MiB", "current", "peak");
+  for (int i = 0; i < GLR_MEMORY_CATEGORIES; ++i)
+  {
+    fprintf(stderr, "%-16s %12.2f %12.2f\n", CATEGORY_NAMES[i], stats.categoryBytes[i] / 1048576.0,
+            stats.categoryPeakBytes[i] / 1048576.0);
+  }
+  fprintf(stderr, "%-16s %12.2f %12.2f\n", "total", stats.bytes / 1048576.0, stats.peakBytes / 1048576.0);
+
+  // Whatever is still tracked at teardown was never freed.
+  for (GLuint i = 0; i < allocationsLen; ++i)
+  {
+    const GlrMemoryAllocation *allocation = &allocations[i];
+    fprintf(stderr, "leak: %s %u of %s, %s %dx%dx%d 0x%x, %llu bytes\n", allocation->isTexture ? "texture" : "buffer",
+            allocation->name, allocation->owner, CATEGORY_NAMES[allocation->category], allocation->width,
+            allocation->height, allocation->layers, allocation->format, (unsigned long long)allocation->bytes);
+  }
+}
+
+void glrMemoryShutdown()
+{
+  free(allocations);
+  allocations = NULL;
+  allocationsLen = 0;
+  allocationsCap = 0;
+}
@@ -2,6 +2,18 @@
 #include <stdlib.h>
 
 #include "glr.h"
+
+// First block of the load arena, enough for the temporaries of a small model
+#define LOAD_ARENA_BLOCK_SIZE (1 << 20)
+
+// Everything tinyobj allocates is only alive during a load, it all goes to one arena that is reset afterwards. Loads
+// run one at a time on the context's thread, see glrLoadModel.
+static GlrArena *loadArena = NULL;
+
+#define TINYOBJ_MALLOC(size) glrArenaAlloc(loadArena, size)
+#define TINYOBJ_CALLOC(count, size) glrArenaCalloc(loadArena, count, size)
+#define TINYOBJ_REALLOC_SIZED(data, oldSize, newSize) glrArenaRealloc(loadArena, data, oldSize, newSize)
+#define TINYOBJ_FREE(data) glrArenaFree(loadArena, data)
 #define TINYOBJ_LOADER_C_IMPLEMENTATION
 #include "tinyobj_loader_c.h"
 
@@ -26,7 +38,7 @@ static const char *resolveTexturePath(const char *objFile, const char *texName)
   }
   size_t dirLen = dirEnd - objFile;
   size_t texFileLen = dirLen + texNameLen;
-  char *texFile = (char *)malloc(texFileLen + 1);
+  char *texFile = (char *)glrArenaAlloc(loadArena, texFileLen + 1);
   texFile[texFileLen] = '\0';
   memcpy(texFile, objFile, dirLen);
   memcpy(texFile + dirLen, texName, texNameLen);
@@ -36,7 +48,7 @@ static const char *resolveTexturePath(const char *objFile, const char *texName)
 static void loadFile(void *ctx, const char *filename, const int is_mtl, const char *obj_filename, char **buffer, size_t *len)
 {
   GLsizei glrLen = 0;
-  *buffer = glrReadFile(filename, "r", &glrLen);
+  *buffer = glrArenaReadFile(loadArena, filename, "r", &glrLen);
   *len = (size_t)glrLen;
 }
 
@@ -47,10 +59,19 @@ GlrModel *glrLoadModel(char *filename, GlrLoadTextureCallback loadTexture)
   size_t shapesLen = 0, materialsLen = 0;
   tinyobj_attrib_t attrib;
   tinyobj_attrib_init(&attrib);
+  if (loadArena == NULL)
+  {
+    loadArena = glrCreateArena(LOAD_ARENA_BLOCK_SIZE);
+  }
 
+  glrProfileBegin("glrLoadModel");
+  glrProfileBegin("Parse OBJ");
   int tinyobjResult = tinyobj_parse_obj(&attrib, &shapes, &shapesLen, &materials, &materialsLen, filename, loadFile, NULL, TINYOBJ_FLAG_TRIANGULATE);
+  glrProfileEnd();
   if (tinyobjResult != TINYOBJ_SUCCESS)
   {
+    glrResetArena(loadArena);
+    glrProfileEnd();
     return NULL;
   }
 
@@ -59,9 +80,10 @@ GlrModel *glrLoadModel(char *filename, GlrLoadTextureCallback loadTexture)
 
   model->verticesLen = attrib.num_vertices;
 
+  glrProfileBegin("Deduplicate vertices");
   // Save the first v/vt/vn for each v
-  tinyobj_vertex_index_t **vMap = (tinyobj_vertex_index_t **)malloc(sizeof(void *) * attrib.num_vertices);
-  memset(vMap, 0, sizeof(void *) * attrib.num_vertices);
+  tinyobj_vertex_index_t **vMap =
+      (tinyobj_vertex_index_t **)glrArenaCalloc(loadArena, attrib.num_vertices, sizeof(void *));
   for (unsigned int i = 0; i < attrib.num_faces; i++)
   {
     tinyobj_vertex_index_t *face = &attrib.faces[i];
@@ -103,9 +125,24 @@ GlrModel *glrLoadModel(char *filename, GlrLoadTextureCallback loadTexture)
     }
   }
 
-  free(vMap);
-  vMap = NULL;
+  glrProfileEnd();
+
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    model->boundsMin[axis] = model->verticesLen > 0 ? model->vertices[0].position[axis] : 0.0f;
+    model->boundsMax[axis] = model->boundsMin[axis];
+  }
+  for (GLuint i = 1; i < model->verticesLen; ++i)
+  {
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      float value = model->vertices[i].position[axis];
+      model->boundsMin[axis] = value < model->boundsMin[axis] ? value : model->boundsMin[axis];
+      model->boundsMax[axis] = value > model->boundsMax[axis] ? value : model->boundsMax[axis];
+    }
+  }
 
+  glrProfileBegin("Build batches");
   model->batchesLen = 1;
   for (unsigned int i = 1; i < attrib.num_face_num_verts; ++i)
   {
@@ -134,7 +171,9 @@ GlrModel *glrLoadModel(char *filename, GlrLoadTextureCallback loadTexture)
       model->batches[batchIndex].materialIndex = materialIndex;
     }
   }
+  glrProfileEnd();
 
+  glrProfileBegin("Load materials");
   model->materialsLen = materialsLen;
   model->materials = (GlrModelMaterial *)malloc(sizeof(GlrModelMaterial) * materialsLen);
   for (unsigned int i = 0; i < materialsLen; ++i)
@@ -146,19 +185,23 @@ GlrModel *glrLoadModel(char *filename, GlrLoadTextureCallback loadTexture)
 
     glGenTextures(1, &glrMaterial->diffuse);
     loadTexture(glrMaterial->diffuse, resolveTexturePath(filename, material->diffuse_texname));
+    glrTrackTexture(GL_TEXTURE_2D, glrMaterial->diffuse, GLR_MEMORY_TEXTURES, "glrLoadModel");
     glGenTextures(1, &glrMaterial->specular);
     loadTexture(glrMaterial->specular, resolveTexturePath(filename, material->specular_texname));
+    glrTrackTexture(GL_TEXTURE_2D, glrMaterial->specular, GLR_MEMORY_TEXTURES, "glrLoadModel");
   }
+  glrProfileEnd();
 
-  tinyobj_shapes_free(shapes, shapesLen);
-  tinyobj_materials_free(materials, materialsLen);
-  tinyobj_attrib_free(&attrib);
+  // The file buffers, the parsed OBJ, vMap and the texture paths all go at once.
+  glrResetArena(loadArena);
+  glrProfileEnd();
 
   return model;
 }
 
 void glrBindModel(GlrModel *model)
 {
+  glrProfileBegin("glrBindModel");
   glGenBuffers(1, &model->vbo);
   glGenBuffers(1, &model->ebo);
   glGenVertexArrays(1, &model->vao);
@@ -167,6 +210,8 @@ void glrBindModel(GlrModel *model)
   glBufferData(GL_ARRAY_BUFFER, model->verticesLen * sizeof(GlrModelVertex), model->vertices, GL_STATIC_DRAW);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model->ebo);
   glBufferData(GL_ELEMENT_ARRAY_BUFFER, model->indicesLen * sizeof(GLuint), model->indices, GL_STATIC_DRAW);
+  glrTrackBuffer(model->vbo, model->verticesLen * sizeof(GlrModelVertex), GLR_MEMORY_GEOMETRY, "glrBindModel");
+  glrTrackBuffer(model->ebo, model->indicesLen * sizeof(GLuint), GLR_MEMORY_GEOMETRY, "glrBindModel");
 
   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GlrModelVertex), (void *)(offsetof(GlrModelVertex, position)));
   glEnableVertexAttribArray(0);
@@ -179,12 +224,17 @@ void glrBindModel(GlrModel *model)
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   glBindVertexArray(0);
+
+  glrStats()->uploadBytes += model->verticesLen * sizeof(GlrModelVertex) + model->indicesLen * sizeof(GLuint);
+  glrProfileEnd();
 }
 
 void glrDrawModel(GlrModel *model, GlrModelMaterialUniforms *uniforms)
 {
+  GlrStats *stats = glrStats();
   glBindVertexArray(model->vao);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model->ebo);
+  ++stats->vaoBinds;
 
   for (unsigned int i = 0; i < model->batchesLen; ++i)
   {
@@ -201,8 +251,36 @@ void glrDrawModel(GlrModel *model, GlrModelMaterialUniforms *uniforms)
       glActiveTexture(GL_TEXTURE1);
       glBindTexture(GL_TEXTURE_2D, material->specular);
       glUniform1i(uniforms->specular, 1);
+
+      stats->textureBinds += 2;
+      stats->uniformCalls += 3;
+      stats->uniformBytes += sizeof(GLfloat) + sizeof(GLint) * 2;
     }
     glDrawElements(GL_TRIANGLES, batch->indicesLen, GL_UNSIGNED_INT, batch->indicesOffset);
+    glrStatsCountDraw(GL_TRIANGLES, batch->indicesLen);
+  }
+}
+
+void glrModelBounds(const GlrModel *model, const float transform[16], float center[3], float extent[3])
+{
+  float localCenter[3], localExtent[3];
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    localCenter[axis] = (model->boundsMin[axis] + model->boundsMax[axis]) * 0.5f;
+    localExtent[axis] = (model->boundsMax[axis] - model->boundsMin[axis]) * 0.5f;
+  }
+
+  // The extent along each world axis is the sum of the absolute projections of the box axes.
+  for (int row = 0; row < 3; ++row)
+  {
+    center[row] = transform[12 + row];
+    extent[row] = 0.0f;
+    for (int col = 0; col < 3; ++col)
+    {
+      float m = transform[col * 4 + row];
+      center[row] += m * localCenter[col];
+      extent[row] += (m < 0.0f ? -m : m) * localExtent[col];
+    }
   }
 }
 
@@ -211,9 +289,30 @@ void glrDrawModel(GlrModel *model, GlrModelMaterialUniforms *uniforms)
  */
 void glrFreeModel(GlrModel *model)
 {
+  for (GLuint i = 0; i < model->materialsLen; ++i)
+  {
+    glrUntrackTexture(model->materials[i].diffuse);
+    glrUntrackTexture(model->materials[i].specular);
+    glDeleteTextures(1, &model->materials[i].diffuse);
+    glDeleteTextures(1, &model->materials[i].specular);
+  }
+  glrUntrackBuffer(model->vbo);
+  glrUntrackBuffer(model->ebo);
+  glDeleteBuffers(1, &model->vbo);
+  glDeleteBuffers(1, &model->ebo);
+  glDeleteVertexArrays(1, &model->vao);
   free(model->vertices);
   free(model->indices);
   free(model->materials);
   free(model->batches);
   free(model);
 }
+
+void glrModelShutdown()
+{
+  if (loadArena != NULL)
+  {
+    glrFreeArena(loadArena);
+    loadArena = NULL;
+  }
+}
@@ -0,0 +1,424 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define GLR_OCCLUSION_SSE
+#endif
+
+#include "glr.h"
+
+// Tiles of TILE_SIZE x TILE_SIZE pixels keep their farthest depth, the buffer is padded to whole tiles.
+#define TILE_SIZE 8
+// Vertices closer than this in clip w are behind the near plane
+#define MIN_W 1.0e-3f
+// Floats per screen space triangle: x, y and depth of 3 vertices
+#define TRIANGLE_FLOATS 9
+// Objects per job chunk when testing
+#define TEST_GRAIN 1024
+
+static const GLuint BOX_INDICES[36] = {
+    0, 1, 3, 0, 3, 2, // -x
+    4, 6, 7, 4, 7, 5, // +x
+    0, 4, 5, 0, 5, 1, // -y
+    2, 3, 7, 2, 7, 6, // +y
+    0, 2, 6, 0, 6, 4, // -z
+    1, 5, 7, 1, 7, 3, // +z
+};
+
+typedef struct TestJob
+{
+  const GlrOcclusionBuffer *buffer;
+  const GlrBounds *bounds;
+  GLuint *visible;
+  GLuint *chunkCounts;
+} TestJob;
+
+// Transform a point by a column-major mat4
+static void transformPoint(const float m[16], const float p[3], float out[4])
+{
+  for (int row = 0; row < 4; ++row)
+  {
+    out[row] = m[row] * p[0] + m[4 + row] * p[1] + m[8 + row] * p[2] + m[12 + row];
+  }
+}
+
+static void multiply(const float a[16], const float b[16], float out[16])
+{
+  for (int col = 0; col < 4; ++col)
+  {
+    for (int row = 0; row < 4; ++row)
+    {
+      out[col * 4 + row] = a[row] * b[col * 4] + a[4 + row] * b[col * 4 + 1] + a[8 + row] * b[col * 4 + 2] +
+                           a[12 + row] * b[col * 4 + 3];
+    }
+  }
+}
+
+// Map clip space to pixels and depth in [0, 1], y goes up like in GL.
+static void toScreen(const GlrOcclusionBuffer *buffer, const float clip[4], float out[3])
+{
+  float invW = 1.0f / clip[3];
+  out[0] = (clip[0] * invW * 0.5f + 0.5f) * buffer->width;
+  out[1] = (clip[1] * invW * 0.5f + 0.5f) * buffer->height;
+  out[2] = clip[2] * invW * 0.5f + 0.5f;
+}
+
+static void reserveTriangles(GlrOcclusionBuffer *buffer, GLuint len)
+{
+  if (len <= buffer->trianglesCap)
+  {
+    return;
+  }
+  buffer->trianglesCap = buffer->trianglesCap == 0 ? 1024 : buffer->trianglesCap * 2;
+  if (buffer->trianglesCap < len)
+  {
+    buffer->trianglesCap = len;
+  }
+  buffer->triangles = (float *)realloc(buffer->triangles, sizeof(float) * TRIANGLE_FLOATS * buffer->trianglesCap);
+}
+
+// Keep the nearest depth of the triangle in the rows [rowBegin, rowEnd), sampled at pixel centers.
+static void rasterizeTriangle(GlrOcclusionBuffer *buffer, const float *triangle, int rowBegin, int rowEnd)
+{
+  float x0 = triangle[0], y0 = triangle[1], z0 = triangle[2];
+  float x1 = triangle[3], y1 = triangle[4], z1 = triangle[5];
+  float x2 = triangle[6], y2 = triangle[7], z2 = triangle[8];
+
+  int minX = (int)floorf(fminf(x0, fminf(x1, x2)));
+  int maxX = (int)ceilf(fmaxf(x0, fmaxf(x1, x2)));
+  int minY = (int)floorf(fminf(y0, fminf(y1, y2)));
+  int maxY = (int)ceilf(fmaxf(y0, fmaxf(y1, y2)));
+  minX = minX < 0 ? 0 : minX & ~3;
+  maxX = maxX > buffer->width ? buffer->width : maxX;
+  minY = minY < rowBegin ? rowBegin : minY;
+  maxY = maxY > rowEnd ? rowEnd : maxY;
+  if (minX >= maxX || minY >= maxY)
+  {
+    return;
+  }
+
+  // The triangles are counter-clockwise, so a pixel is inside when all edge functions are positive.
+  float area = (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0);
+  float dzdx = ((z1 - z0) * (y2 - y0) - (z2 - z0) * (y1 - y0)) / area;
+  float dzdy = ((z2 - z0) * (x1 - x0) - (z1 - z0) * (x2 - x0)) / area;
+
+  // Edge functions and depth at the center of the first pixel, and their steps per pixel
+  float px = minX + 0.5f, py = minY + 0.5f;
+  float e0 = (x2 - x1) * (py - y1) - (y2 - y1) * (px - x1);
+  float e1 = (x0 - x2) * (py - y2) - (y0 - y2) * (px - x2);
+  float e2 = (x1 - x0) * (py - y0) - (y1 - y0) * (px - x0);
+  float e0dx = -(y2 - y1), e1dx = -(y0 - y2), e2dx = -(y1 - y0);
+  float e0dy = x2 - x1, e1dy = x0 - x2, e2dy = x1 - x0;
+  float z = z0 + dzdx * (px - x0) + dzdy * (py - y0);
+
+#ifdef GLR_OCCLUSION_SSE
+  const __m128 steps = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f), zero = _mm_setzero_ps();
+  __m128 edge0dx = _mm_set1_ps(e0dx), edge1dx = _mm_set1_ps(e1dx), edge2dx = _mm_set1_ps(e2dx);
+  __m128 depthDx = _mm_set1_ps(dzdx);
+  // Values of the 4 pixels of a span, and the step to the next span
+  __m128 edge0Lanes = _mm_mul_ps(edge0dx, steps), edge1Lanes = _mm_mul_ps(edge1dx, steps);
+  __m128 edge2Lanes = _mm_mul_ps(edge2dx, steps), depthLanes = _mm_mul_ps(depthDx, steps);
+  __m128 edge0Span = _mm_mul_ps(edge0dx, _mm_set1_ps(4.0f)), edge1Span = _mm_mul_ps(edge1dx, _mm_set1_ps(4.0f));
+  __m128 edge2Span = _mm_mul_ps(edge2dx, _mm_set1_ps(4.0f)), depthSpan = _mm_mul_ps(depthDx, _mm_set1_ps(4.0f));
+#endif
+
+  for (int y = minY; y < maxY; ++y)
+  {
+    float *row = &buffer->depth[y * buffer->width];
+    int x = minX;
+#ifdef GLR_OCCLUSION_SSE
+    __m128 edge0 = _mm_add_ps(_mm_set1_ps(e0), edge0Lanes);
+    __m128 edge1 = _mm_add_ps(_mm_set1_ps(e1), edge1Lanes);
+    __m128 edge2 = _mm_add_ps(_mm_set1_ps(e2), edge2Lanes);
+    __m128 depth = _mm_add_ps(_mm_set1_ps(z), depthLanes);
+    // The width is a multiple of 4, so spans never cross the row end.
+    for (; x < maxX; x += 4)
+    {
+      __m128 isInside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge0, zero), _mm_cmpge_ps(edge1, zero)),
+                                   _mm_cmpge_ps(edge2, zero));
+      if (_mm_movemask_ps(isInside) != 0)
+      {
+        __m128 old = _mm_loadu_ps(&row[x]);
+        __m128 nearest = _mm_min_ps(old, depth);
+        _mm_storeu_ps(&row[x], _mm_or_ps(_mm_and_ps(isInside, nearest), _mm_andnot_ps(isInside, old)));
+      }
+      edge0 = _mm_add_ps(edge0, edge0Span);
+      edge1 = _mm_add_ps(edge1, edge1Span);
+      edge2 = _mm_add_ps(edge2, edge2Span);
+      depth = _mm_add_ps(depth, depthSpan);
+    }
+#else
+    float edge0 = e0, edge1 = e1, edge2 = e2, depth = z;
+    for (; x < maxX; ++x)
+    {
+      if (edge0 >= 0.0f && edge1 >= 0.0f && edge2 >= 0.0f && depth < row[x])
+      {
+        row[x] = depth;
+      }
+      edge0 += e0dx;
+      edge1 += e1dx;
+      edge2 += e2dx;
+      depth += dzdx;
+    }
+#endif
+    e0 += e0dy;
+    e1 += e1dy;
+    e2 += e2dy;
+    z += dzdy;
+  }
+}
+
+// Clear one row of tiles and rasterize all triangles into it, then update the farthest depth of its tiles.
+static void rasterizeBand(GLuint begin, GLuint end, void *ctx)
+{
+  GlrOcclusionBuffer *buffer = (GlrOcclusionBuffer *)ctx;
+  int tilesX = buffer->width / TILE_SIZE;
+
+  for (GLuint band = begin; band < end; ++band)
+  {
+    int rowBegin = band * TILE_SIZE, rowEnd = rowBegin + TILE_SIZE;
+    for (int i = rowBegin * buffer->width; i < rowEnd * buffer->width; ++i)
+    {
+      buffer->depth[i] = 1.0f;
+    }
+    for (GLuint i = 0; i < buffer->trianglesLen; ++i)
+    {
+      rasterizeTriangle(buffer, &buffer->triangles[i * TRIANGLE_FLOATS], rowBegin, rowEnd);
+    }
+
+    for (int tile = 0; tile < tilesX; ++tile)
+    {
+      float farthest = 0.0f;
+      for (int y = rowBegin; y < rowEnd; ++y)
+      {
+        const float *row = &buffer->depth[y * buffer->width + tile * TILE_SIZE];
+        for (int x = 0; x < TILE_SIZE; ++x)
+        {
+          farthest = row[x] > farthest ? row[x] : farthest;
+        }
+      }
+      buffer->tileMax[band * tilesX + tile] = farthest;
+    }
+  }
+}
+
+// Whether any pixel of the screen rectangle is farther than depth
+static int isRectVisible(const GlrOcclusionBuffer *buffer, int minX, int minY, int maxX, int maxY, float depth)
+{
+  int tilesX = buffer->width / TILE_SIZE;
+  for (int tileY = minY / TILE_SIZE; tileY * TILE_SIZE < maxY; ++tileY)
+  {
+    for (int tileX = minX / TILE_SIZE; tileX * TILE_SIZE < maxX; ++tileX)
+    {
+      // Every pixel of the tile is nearer, so it hides this part of the object.
+      if (buffer->tileMax[tileY * tilesX + tileX] < depth)
+      {
+        continue;
+      }
+
+      int x0 = tileX * TILE_SIZE > minX ? tileX * TILE_SIZE : minX;
+      int x1 = (tileX + 1) * TILE_SIZE < maxX ? (tileX + 1) * TILE_SIZE : maxX;
+      int y0 = tileY * TILE_SIZE > minY ? tileY * TILE_SIZE : minY;
+      int y1 = (tileY + 1) * TILE_SIZE < maxY ? (tileY + 1) * TILE_SIZE : maxY;
+      for (int y = y0; y < y1; ++y)
+      {
+        const float *row = &buffer->depth[y * buffer->width];
+        for (int x = x0; x < x1; ++x)
+        {
+          if (row[x] >= depth)
+          {
+            return 1;
+          }
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+static int isObjectVisible(const GlrOcclusionBuffer *buffer, const GlrBounds *bounds, GLuint i)
+{
+  float extent[3] = {
+      bounds->radius != NULL ? bounds->radius[i] : bounds->extentX[i],
+      bounds->radius != NULL ? bounds->radius[i] : bounds->extentY[i],
+      bounds->radius != NULL ? bounds->radius[i] : bounds->extentZ[i]};
+  float center[3] = {bounds->x[i], bounds->y[i], bounds->z[i]};
+
+  // Screen rectangle and nearest depth of the box corners
+  float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY, minDepth = INFINITY;
+  for (int corner = 0; corner < 8; ++corner)
+  {
+    float point[3] = {
+        center[0] + (corner & 4 ? extent[0] : -extent[0]),
+        center[1] + (corner & 2 ? extent[1] : -extent[1]),
+        center[2] + (corner & 1 ? extent[2] : -extent[2])};
+    float clip[4], screen[3];
+    transformPoint(buffer->viewProjection, point, clip);
+    // Crossing the near plane, the camera may be inside the object.
+    if (clip[3] < MIN_W)
+    {
+      return 1;
+    }
+    toScreen(buffer, clip, screen);
+    minX = fminf(minX, screen[0]);
+    maxX = fmaxf(maxX, screen[0]);
+    minY = fminf(minY, screen[1]);
+    maxY = fmaxf(maxY, screen[1]);
+    minDepth = fminf(minDepth, screen[2]);
+  }
+
+  int x0 = minX < 0.0f ? 0 : (int)minX;
+  int y0 = minY < 0.0f ? 0 : (int)minY;
+  int x1 = maxX > buffer->width ? buffer->width : (int)ceilf(maxX);
+  int y1 = maxY > buffer->height ? buffer->height : (int)ceilf(maxY);
+  // Off screen objects are left to frustum culling.
+  if (x0 >= x1 || y0 >= y1)
+  {
+    return 1;
+  }
+  return isRectVisible(buffer, x0, y0, x1, y1, minDepth);
+}
+
+static void testChunk(GLuint begin, GLuint end, void *ctx)
+{
+  TestJob *job = (TestJob *)ctx;
+  // Compact in place, a chunk only writes before the index it reads.
+  GLuint len = begin;
+  for (GLuint i = begin; i < end; ++i)
+  {
+    if (isObjectVisible(job->buffer, job->bounds, job->visible[i]))
+    {
+      job->visible[len++] = job->visible[i];
+    }
+  }
+  job->chunkCounts[begin / TEST_GRAIN] = len - begin;
+}
+
+GlrOcclusionBuffer *glrCreateOcclusionBuffer(int width, int height)
+{
+  GlrOcclusionBuffer *buffer = (GlrOcclusionBuffer *)calloc(1, sizeof(GlrOcclusionBuffer));
+  buffer->width = (width + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE;
+  buffer->height = (height + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE;
+  buffer->depth = (float *)malloc(sizeof(float) * buffer->width * buffer->height);
+  buffer->tileMax = (float *)malloc(sizeof(float) * (buffer->width / TILE_SIZE) * (buffer->height / TILE_SIZE));
+  return buffer;
+}
+
+void glrClearOcclusionBuffer(GlrOcclusionBuffer *buffer, const float viewProjection[16])
+{
+  memcpy(buffer->viewProjection, viewProjection, sizeof(buffer->viewProjection));
+  buffer->trianglesLen = 0;
+}
+
+void glrAddOccluderMesh(
+    GlrOcclusionBuffer *buffer,
+    const float *positions,
+    size_t stride,
+    const GLuint *indices,
+    GLuint indicesLen,
+    const float transform[16])
+{
+  float modelViewProjection[16];
+  if (transform != NULL)
+  {
+    multiply(buffer->viewProjection, transform, modelViewProjection);
+  }
+  const float *matrix = transform != NULL ? modelViewProjection : buffer->viewProjection;
+
+  reserveTriangles(buffer, buffer->trianglesLen + indicesLen / 3);
+  for (GLuint i = 0; i + 2 < indicesLen; i += 3)
+  {
+    float *triangle = &buffer->triangles[buffer->trianglesLen * TRIANGLE_FLOATS];
+    int isClipped = 0;
+    for (int v = 0; v < 3 && !isClipped; ++v)
+    {
+      const float *position = (const float *)((const char *)positions + stride * indices[i + v]);
+      float clip[4];
+      transformPoint(matrix, position, clip);
+      // Occluders only need to be correct where drawn, so triangles crossing the near plane are dropped.
+      isClipped = clip[3] < MIN_W;
+      if (!isClipped)
+      {
+        toScreen(buffer, clip, &triangle[v * 3]);
+      }
+    }
+    if (isClipped)
+    {
+      continue;
+    }
+
+    float area = (triangle[3] - triangle[0]) * (triangle[7] - triangle[1]) -
+                 (triangle[4] - triangle[1]) * (triangle[6] - triangle[0]);
+    if (area == 0.0f || isnan(area))
+    {
+      continue;
+    }
+    // Both faces occlude, make every triangle counter-clockwise on screen.
+    if (area < 0.0f)
+    {
+      float swap[3];
+      memcpy(swap, &triangle[3], sizeof(swap));
+      memcpy(&triangle[3], &triangle[6], sizeof(swap));
+      memcpy(&triangle[6], swap, sizeof(swap));
+    }
+    ++buffer->trianglesLen;
+  }
+}
+
+void glrAddOccluderModel(GlrOcclusionBuffer *buffer, const GlrModel *model, const float transform[16])
+{
+  glrAddOccluderMesh(
+      buffer,
+      model->vertices[0].position,
+      sizeof(GlrModelVertex),
+      model->indices,
+      model->indicesLen,
+      transform);
+}
+
+void glrAddOccluderBox(GlrOcclusionBuffer *buffer, const float min[3], const float max[3], const float transform[16])
+{
+  float corners[8][3];
+  for (int corner = 0; corner < 8; ++corner)
+  {
+    corners[corner][0] = corner & 4 ? max[0] : min[0];
+    corners[corner][1] = corner & 2 ? max[1] : min[1];
+    corners[corner][2] = corner & 1 ? max[2] : min[2];
+  }
+  glrAddOccluderMesh(buffer, corners[0], sizeof(corners[0]), BOX_INDICES, 36, transform);
+}
+
+void glrRasterizeOccluders(GlrOcclusionBuffer *buffer)
+{
+  glrParallelFor(buffer->height / TILE_SIZE, 1, rasterizeBand, buffer);
+}
+
+GLuint glrCullOcclusion(const GlrOcclusionBuffer *buffer, const GlrBounds *bounds, GLuint *visible, GLuint visibleLen)
+{
+  GLuint chunksLen = (visibleLen + TEST_GRAIN - 1) / TEST_GRAIN;
+  TestJob job = {
+      .buffer = buffer,
+      .bounds = bounds,
+      .visible = visible,
+      .chunkCounts = (GLuint *)malloc(sizeof(GLuint) * (chunksLen > 0 ? chunksLen : 1)),
+  };
+  glrParallelFor(visibleLen, TEST_GRAIN, testChunk, &job);
+
+  GLuint len = 0;
+  for (GLuint i = 0; i < chunksLen; ++i)
+  {
+    memmove(visible + len, visible + i * TEST_GRAIN, sizeof(GLuint) * job.chunkCounts[i]);
+    len += job.chunkCounts[i];
+  }
+  free(job.chunkCounts);
+  return len;
+}
+
+void glrFreeOcclusionBuffer(GlrOcclusionBuffer *buffer)
+{
+  free(buffer->depth);
+  free(buffer->tileMax);
+  free(buffer->triangles);
+  free(buffer);
+}
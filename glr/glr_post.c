@@ -0,0 +1,315 @@
+#include <stdlib.h>
+
+#include "glr.h"
+
+// A triangle covering the screen, made from the vertex index
+static const GLchar FULLSCREEN_VERTEX_SHADER[] =
+    "#version 330 core\n"
+    "out vec2 TexCoords;\n"
+    "void main()\n"
+    "{\n"
+    "  TexCoords = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+    "  gl_Position = vec4(TexCoords * 2.0 - 1.0, 0.0, 1.0);\n"
+    "}\n";
+
+void glrPixelFormat(GLenum internalFormat, GLenum *format, GLenum *type)
+{
+  *type = GL_FLOAT;
+  switch (internalFormat)
+  {
+  case GL_DEPTH_COMPONENT16:
+  case GL_DEPTH_COMPONENT24:
+  case GL_DEPTH_COMPONENT32F:
+    *format = GL_DEPTH_COMPONENT;
+    break;
+  case GL_DEPTH24_STENCIL8:
+    *format = GL_DEPTH_STENCIL;
+    *type = GL_UNSIGNED_INT_24_8;
+    break;
+  case GL_DEPTH32F_STENCIL8:
+    *format = GL_DEPTH_STENCIL;
+    *type = GL_FLOAT_32_UNSIGNED_INT_24_8_REV;
+    break;
+  case GL_R8:
+  case GL_R16:
+  case GL_R16F:
+  case GL_R32F:
+    *format = GL_RED;
+    break;
+  case GL_RG8:
+  case GL_RG16:
+  case GL_RG16F:
+  case GL_RG32F:
+    *format = GL_RG;
+    break;
+  case GL_RGB8:
+  case GL_RGB16F:
+  case GL_RGB32F:
+  case GL_R11F_G11F_B10F:
+    *format = GL_RGB;
+    break;
+  // Integer formats only accept integer pixel formats of a type with their sign.
+  case GL_R8I:
+  case GL_R16I:
+  case GL_R32I:
+    *format = GL_RED_INTEGER;
+    *type = GL_INT;
+    break;
+  case GL_R8UI:
+  case GL_R16UI:
+  case GL_R32UI:
+    *format = GL_RED_INTEGER;
+    *type = GL_UNSIGNED_INT;
+    break;
+  case GL_RG8I:
+  case GL_RG16I:
+  case GL_RG32I:
+    *format = GL_RG_INTEGER;
+    *type = GL_INT;
+    break;
+  case GL_RG8UI:
+  case GL_RG16UI:
+  case GL_RG32UI:
+    *format = GL_RG_INTEGER;
+    *type = GL_UNSIGNED_INT;
+    break;
+  case GL_RGB8I:
+  case GL_RGB16I:
+  case GL_RGB32I:
+    *format = GL_RGB_INTEGER;
+    *type = GL_INT;
+    break;
+  case GL_RGB8UI:
+  case GL_RGB16UI:
+  case GL_RGB32UI:
+    *format = GL_RGB_INTEGER;
+    *type = GL_UNSIGNED_INT;
+    break;
+  case GL_RGBA8I:
+  case GL_RGBA16I:
+  case GL_RGBA32I:
+    *format = GL_RGBA_INTEGER;
+    *type = GL_INT;
+    break;
+  case GL_RGBA8UI:
+  case GL_RGBA16UI:
+  case GL_RGBA32UI:
+    *format = GL_RGBA_INTEGER;
+    *type = GL_UNSIGNED_INT;
+    break;
+  case GL_RGB10_A2UI:
+    *format = GL_RGBA_INTEGER;
+    *type = GL_UNSIGNED_INT_2_10_10_10_REV;
+    break;
+  default:
+    *format = GL_RGBA;
+    break;
+  }
+}
+
+GLenum glrFormatAttachment(GLenum internalFormat)
+{
+  GLenum format, type;
+  glrPixelFormat(internalFormat, &format, &type);
+  return format == GL_DEPTH_STENCIL     ? GL_DEPTH_STENCIL_ATTACHMENT
+         : format == GL_DEPTH_COMPONENT ? GL_DEPTH_ATTACHMENT
+                                        : GL_COLOR_ATTACHMENT0;
+}
+
+GLuint glrCreateTargetTexture(GLenum internalFormat, int width, int height, const char *owner)
+{
+  GLenum format, type;
+  glrPixelFormat(internalFormat, &format, &type);
+  // Linear filtering lets a smaller pass downsample its source for free, integer textures are incomplete with it.
+  int isInteger = format == GL_RED_INTEGER || format == GL_RG_INTEGER || format == GL_RGB_INTEGER ||
+                  format == GL_RGBA_INTEGER;
+  GLint filter = isInteger ? GL_NEAREST : GL_LINEAR;
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glrTrackTexture(GL_TEXTURE_2D, texture, GLR_MEMORY_RENDER_TARGETS, owner);
+  return texture;
+}
+
+const GLchar *glrFullscreenVertexShader(GLuint shader)
+{
+  return glrShaderSource(shader, FULLSCREEN_VERTEX_SHADER, sizeof(FULLSCREEN_VERTEX_SHADER) - 1);
+}
+
+static GlrRenderTarget *createTarget(int width, int height, GLenum colorFormat, GLenum depthFormat)
+{
+  GlrRenderTarget *target = (GlrRenderTarget *)calloc(1, sizeof(GlrRenderTarget));
+  target->width = width;
+  target->height = height;
+  target->colorFormat = colorFormat;
+  target->depthFormat = depthFormat;
+  target->color = glrCreateTargetTexture(colorFormat, width, height, "glrAcquireRenderTarget");
+  if (depthFormat != GL_NONE)
+  {
+    target->depth = glrCreateTargetTexture(depthFormat, width, height, "glrAcquireRenderTarget");
+  }
+
+  glGenFramebuffers(1, &target->framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target->color, 0);
+  if (depthFormat != GL_NONE)
+  {
+    glFramebufferTexture2D(GL_FRAMEBUFFER, glrFormatAttachment(depthFormat), GL_TEXTURE_2D, target->depth, 0);
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  return target;
+}
+
+static void freeTarget(GlrRenderTarget *target)
+{
+  glDeleteFramebuffers(1, &target->framebuffer);
+  glrUntrackTexture(target->color);
+  glDeleteTextures(1, &target->color);
+  if (target->depth != 0)
+  {
+    glrUntrackTexture(target->depth);
+    glDeleteTextures(1, &target->depth);
+  }
+  free(target);
+}
+
+GlrPostProcess *glrCreatePostProcess(int width, int height, const GLchar **error)
+{
+  GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+  *error = glrFullscreenVertexShader(vertexShader);
+  if (*error != NULL)
+  {
+    glDeleteShader(vertexShader);
+    return NULL;
+  }
+
+  GlrPostProcess *post = (GlrPostProcess *)calloc(1, sizeof(GlrPostProcess));
+  post->width = width;
+  post->height = height;
+  post->vertexShader = vertexShader;
+  glGenVertexArrays(1, &post->emptyVao);
+  return post;
+}
+
+GlrRenderTarget *glrAcquireRenderTarget(GlrPostProcess *post, int divisor, GLenum colorFormat, GLenum depthFormat)
+{
+  // Round up, so a quarter of an odd size still covers every pixel.
+  int width = (post->width + divisor - 1) / divisor;
+  int height = (post->height + divisor - 1) / divisor;
+  for (GLuint i = 0; i < post->targetsLen; ++i)
+  {
+    GlrRenderTarget *target = post->targets[i];
+    if (target->refs == 0 && target->width == width && target->height == height &&
+        target->colorFormat == colorFormat && target->depthFormat == depthFormat)
+    {
+      target->refs = 1;
+      return target;
+    }
+  }
+
+  if (post->targetsLen == post->targetsCap)
+  {
+    post->targetsCap = post->targetsCap == 0 ? 8 : post->targetsCap * 2;
+    post->targets = (GlrRenderTarget **)realloc(post->targets, sizeof(GlrRenderTarget *) * post->targetsCap);
+  }
+  GlrRenderTarget *target = createTarget(width, height, colorFormat, depthFormat);
+  target->refs = 1;
+  post->targets[post->targetsLen++] = target;
+  return target;
+}
+
+void glrRetainRenderTarget(GlrRenderTarget *target)
+{
+  ++target->refs;
+}
+
+void glrReleaseRenderTarget(GlrRenderTarget *target)
+{
+  --target->refs;
+}
+
+void glrBindRenderTarget(GlrRenderTarget *target)
+{
+  glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+  ++glrStats()->framebufferBinds;
+  glViewport(0, 0, target->width, target->height);
+}
+
+void glrDrawPostPass(GlrPostProcess *post, GLuint program, GLuint source, GlrRenderTarget *target)
+{
+  GlrStats *stats = glrStats();
+  if (target != NULL)
+  {
+    glrBindRenderTarget(target);
+  }
+  else
+  {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    ++stats->framebufferBinds;
+    glViewport(0, 0, post->width, post->height);
+  }
+
+  // Every pixel is written once, there is nothing to test against.
+  glDisable(GL_DEPTH_TEST);
+  glUseProgram(program);
+  glBindVertexArray(post->emptyVao);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, source);
+  ++stats->programSwitches;
+  ++stats->vaoBinds;
+  ++stats->textureBinds;
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  glrStatsCountDraw(GL_TRIANGLES, 3);
+
+  glEnable(GL_DEPTH_TEST);
+  glBindVertexArray(0);
+}
+
+GlrRenderTarget *glrPostPass(GlrPostProcess *post, GLuint program, GLuint source, int divisor, GLenum colorFormat)
+{
+  GlrRenderTarget *target = glrAcquireRenderTarget(post, divisor, colorFormat, GL_NONE);
+  glrDrawPostPass(post, program, source, target);
+  return target;
+}
+
+void glrTrimRenderTargets(GlrPostProcess *post)
+{
+  GLuint kept = 0;
+  for (GLuint i = 0; i < post->targetsLen; ++i)
+  {
+    if (post->targets[i]->refs == 0)
+    {
+      freeTarget(post->targets[i]);
+    }
+    else
+    {
+      post->targets[kept++] = post->targets[i];
+    }
+  }
+  post->targetsLen = kept;
+}
+
+void glrResizePostProcess(GlrPostProcess *post, int width, int height)
+{
+  post->width = width;
+  post->height = height;
+  glrTrimRenderTargets(post);
+}
+
+void glrFreePostProcess(GlrPostProcess *post)
+{
+  for (GLuint i = 0; i < post->targetsLen; ++i)
+  {
+    freeTarget(post->targets[i]);
+  }
+  free(post->targets);
+  glDeleteShader(post->vertexShader);
+  glDeleteVertexArrays(1, &post->emptyVao);
+  free(post);
+}
@@ -0,0 +1,282 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "glr.h"
+
+// Frames of GPU queries in flight, results are read back this many frames later so it never stalls.
+#define GPU_FRAMES 3
+#define MAX_GPU_SCOPES 64
+#define MAX_CPU_DEPTH 32
+
+#define CPU_TID 1
+#define GPU_TID 2
+
+typedef struct GlrProfileEvent
+{
+  const char *name;
+  int tid;
+  double startUs;
+  double durationUs;
+} GlrProfileEvent;
+
+typedef struct GlrCpuScope
+{
+  const char *name;
+  double startUs;
+} GlrCpuScope;
+
+typedef struct GlrGpuScope
+{
+  const char *name;
+  // Index of the begin and end timestamp queries
+  GLuint begin;
+  GLuint end;
+  // Whether the end query was issued
+  int isClosed;
+} GlrGpuScope;
+
+typedef struct GlrGpuFrame
+{
+  GLuint queries[MAX_GPU_SCOPES * 2];
+  GlrGpuScope scopes[MAX_GPU_SCOPES];
+  int scopesLen;
+  int queriesLen;
+  // Stack of open scopes
+  int openScopes[MAX_CPU_DEPTH];
+  int openScopesLen;
+} GlrGpuFrame;
+
+typedef struct GlrProfiler
+{
+  int isInitialized;
+  const char *output;
+
+  GlrProfileEvent *events;
+  size_t eventsLen;
+  size_t eventsCap;
+
+  GlrCpuScope cpuScopes[MAX_CPU_DEPTH];
+  int cpuScopesLen;
+
+  GlrGpuFrame gpuFrames[GPU_FRAMES];
+  int gpuFrameIndex;
+  int hasGpuQueries;
+  // GPU timestamp in microseconds minus CPU time in microseconds
+  double gpuOffsetUs;
+} GlrProfiler;
+
+static GlrProfiler profiler = {0};
+
+static double nowUs()
+{
+  return glfwGetTime() * 1.0e6;
+}
+
+static void pushEvent(const char *name, int tid, double startUs, double durationUs)
+{
+  if (profiler.eventsLen == profiler.eventsCap)
+  {
+    profiler.eventsCap = profiler.eventsCap == 0 ? 1024 : profiler.eventsCap * 2;
+    profiler.events = (GlrProfileEvent *)realloc(profiler.events, sizeof(GlrProfileEvent) * profiler.eventsCap);
+  }
+
+  GlrProfileEvent *event = &profiler.events[profiler.eventsLen++];
+  event->name = name;
+  event->tid = tid;
+  event->startUs = startUs;
+  event->durationUs = durationUs;
+}
+
+static void initGpuQueries()
+{
+  profiler.hasGpuQueries = 1;
+  for (int i = 0; i < GPU_FRAMES; ++i)
+  {
+    glGenQueries(MAX_GPU_SCOPES * 2, profiler.gpuFrames[i].queries);
+  }
+
+  // Align the GPU clock to the CPU clock once, the drift over a session is negligible for tracing.
+  GLint64 gpuNs = 0;
+  glGetInteger64v(GL_TIMESTAMP, &gpuNs);
+  profiler.gpuOffsetUs = gpuNs / 1.0e3 - nowUs();
+}
+
+static void collectGpuFrame(GlrGpuFrame *frame)
+{
+  for (int i = 0; i < frame->scopesLen; ++i)
+  {
+    // The end query of a scope left open was never issued, there is nothing to read.
+    GlrGpuScope *scope = &frame->scopes[i];
+    if (!scope->isClosed)
+    {
+      continue;
+    }
+
+    // Scopes nest, so the end reserved last is not the one issued last. Each scope is checked on its own, and its
+    // result dropped rather than stalling when the GPU is more than GPU_FRAMES behind.
+    GLint isAvailable = GL_FALSE;
+    glGetQueryObjectiv(frame->queries[scope->end], GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+    if (!isAvailable)
+    {
+      continue;
+    }
+    GLuint64 beginNs = 0, endNs = 0;
+    glGetQueryObjectui64v(frame->queries[scope->begin], GL_QUERY_RESULT, &beginNs);
+    glGetQueryObjectui64v(frame->queries[scope->end], GL_QUERY_RESULT, &endNs);
+    pushEvent(scope->name, GPU_TID, beginNs / 1.0e3 - profiler.gpuOffsetUs, (endNs - beginNs) / 1.0e3);
+  }
+
+  frame->scopesLen = 0;
+  frame->queriesLen = 0;
+  frame->openScopesLen = 0;
+}
+
+int glrProfilerActive()
+{
+  if (!profiler.isInitialized)
+  {
+    profiler.isInitialized = 1;
+    profiler.output = getenv("GLR_PROFILE");
+    if (profiler.output != NULL && profiler.output[0] == '\0')
+    {
+      profiler.output = NULL;
+    }
+  }
+  return profiler.output != NULL;
+}
+
+void glrProfileBegin(const char *name)
+{
+  if (!glrProfilerActive() || profiler.cpuScopesLen == MAX_CPU_DEPTH)
+  {
+    return;
+  }
+
+  GlrCpuScope *scope = &profiler.cpuScopes[profiler.cpuScopesLen++];
+  scope->name = name;
+  scope->startUs = nowUs();
+}
+
+void glrProfileEnd()
+{
+  if (!glrProfilerActive() || profiler.cpuScopesLen == 0)
+  {
+    return;
+  }
+
+  GlrCpuScope *scope = &profiler.cpuScopes[--profiler.cpuScopesLen];
+  pushEvent(scope->name, CPU_TID, scope->startUs, nowUs() - scope->startUs);
+}
+
+void glrProfileGpuBegin(const char *name)
+{
+  if (!glrProfilerActive())
+  {
+    return;
+  }
+  if (!profiler.hasGpuQueries)
+  {
+    initGpuQueries();
+  }
+
+  GlrGpuFrame *frame = &profiler.gpuFrames[profiler.gpuFrameIndex];
+  if (frame->scopesLen == MAX_GPU_SCOPES || frame->openScopesLen == MAX_CPU_DEPTH)
+  {
+    return;
+  }
+
+  int scopeIndex = frame->scopesLen++;
+  GlrGpuScope *scope = &frame->scopes[scopeIndex];
+  scope->name = name;
+  scope->begin = frame->queriesLen++;
+  // Reserve the end query now, so a frame never has more than two queries per scope.
+  scope->end = frame->queriesLen++;
+  scope->isClosed = 0;
+  frame->openScopes[frame->openScopesLen++] = scopeIndex;
+  glQueryCounter(frame->queries[scope->begin], GL_TIMESTAMP);
+}
+
+void glrProfileGpuEnd()
+{
+  if (!glrProfilerActive() || !profiler.hasGpuQueries)
+  {
+    return;
+  }
+
+  GlrGpuFrame *frame = &profiler.gpuFrames[profiler.gpuFrameIndex];
+  if (frame->openScopesLen == 0)
+  {
+    return;
+  }
+
+  GlrGpuScope *scope = &frame->scopes[frame->openScopes[--frame->openScopesLen]];
+  glQueryCounter(frame->queries[scope->end], GL_TIMESTAMP);
+  scope->isClosed = 1;
+}
+
+void glrProfileFrame()
+{
+  if (!glrProfilerActive() || !profiler.hasGpuQueries)
+  {
+    return;
+  }
+
+  profiler.gpuFrameIndex = (profiler.gpuFrameIndex + 1) % GPU_FRAMES;
+  collectGpuFrame(&profiler.gpuFrames[profiler.gpuFrameIndex]);
+}
+
+int glrProfileWriteTrace(const char *filename)
+{
+  FILE *file = fopen(filename, "w");
+  if (file == NULL)
+  {
+    return -1;
+  }
+
+  // Chrome trace event format, loadable in chrome://tracing and Perfetto
+  fprintf(file, "{\"traceEvents\":[\n");
+  fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"CPU\"}},\n", CPU_TID);
+  fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"GPU\"}}", GPU_TID);
+  for (size_t i = 0; i < profiler.eventsLen; ++i)
+  {
+    GlrProfileEvent *event = &profiler.events[i];
+    fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+            event->name, event->tid, event->startUs, event->durationUs);
+  }
+  fprintf(file, "\n]}\n");
+
+  fclose(file);
+  return 0;
+}
+
+void glrProfilerShutdown()
+{
+  if (glrProfilerActive())
+  {
+    if (profiler.hasGpuQueries)
+    {
+      // Collect the frames still in flight, the oldest first.
+      glFinish();
+      for (int i = 1; i <= GPU_FRAMES; ++i)
+      {
+        collectGpuFrame(&profiler.gpuFrames[(profiler.gpuFrameIndex + i) % GPU_FRAMES]);
+      }
+    }
+
+    if (glrProfileWriteTrace(profiler.output) != 0)
+    {
+      perror(profiler.output);
+    }
+  }
+
+  if (profiler.hasGpuQueries)
+  {
+    for (int i = 0; i < GPU_FRAMES; ++i)
+    {
+      glDeleteQueries(MAX_GPU_SCOPES * 2, profiler.gpuFrames[i].queries);
+    }
+  }
+
+  free(profiler.events);
+  profiler = (GlrProfiler){0};
+}
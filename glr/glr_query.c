@@ -0,0 +1,221 @@
+#include <stdlib.h>
+
+#include "glr.h"
+
+// Corners closer than this in clip w are behind the near plane
+#define MIN_W 1.0e-3f
+
+// The proxy is a unit cube scaled to the bounds, it only writes the query.
+static const GLchar PROXY_VERTEX_SHADER[] =
+    "#version 330 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "uniform mat4 viewProjection;\n"
+    "uniform vec3 center;\n"
+    "uniform vec3 extent;\n"
+    "void main()\n"
+    "{\n"
+    "  gl_Position = viewProjection * vec4(center + aPos * extent, 1.0);\n"
+    "}\n";
+
+static const GLchar PROXY_FRAGMENT_SHADER[] =
+    "#version 330 core\n"
+    "void main()\n"
+    "{\n"
+    "}\n";
+
+static const GLfloat CUBE_VERTICES[24] = {
+    -1.0f, -1.0f, -1.0f,
+    -1.0f, -1.0f, 1.0f,
+    -1.0f, 1.0f, -1.0f,
+    -1.0f, 1.0f, 1.0f,
+    1.0f, -1.0f, -1.0f,
+    1.0f, -1.0f, 1.0f,
+    1.0f, 1.0f, -1.0f,
+    1.0f, 1.0f, 1.0f,
+};
+
+static const GLuint CUBE_INDICES[36] = {
+    0, 1, 3, 0, 3, 2, // -x
+    4, 6, 7, 4, 7, 5, // +x
+    0, 4, 5, 0, 5, 1, // -y
+    2, 3, 7, 2, 7, 6, // +y
+    0, 2, 6, 0, 6, 4, // -z
+    1, 5, 7, 1, 7, 3, // +z
+};
+
+static const GLchar *compileProxyProgram(GLuint program)
+{
+  GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+  const GLchar *error = glrShaderSource(vertexShader, PROXY_VERTEX_SHADER, sizeof(PROXY_VERTEX_SHADER) - 1);
+  if (error != NULL)
+  {
+    return error;
+  }
+  GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+  error = glrShaderSource(fragmentShader, PROXY_FRAGMENT_SHADER, sizeof(PROXY_FRAGMENT_SHADER) - 1);
+  if (error != NULL)
+  {
+    glDeleteShader(vertexShader);
+    return error;
+  }
+
+  glAttachShader(program, vertexShader);
+  glAttachShader(program, fragmentShader);
+  error = glrLinkProgram(program);
+  glDeleteShader(vertexShader);
+  glDeleteShader(fragmentShader);
+  return error;
+}
+
+// Whether a corner of the box is behind the near plane, its proxy would be clipped then.
+static int isCrossingNear(const float viewProjection[16], const float center[3], const float extent[3])
+{
+  for (int corner = 0; corner < 8; ++corner)
+  {
+    float point[3] = {
+        center[0] + (corner & 4 ? extent[0] : -extent[0]),
+        center[1] + (corner & 2 ? extent[1] : -extent[1]),
+        center[2] + (corner & 1 ? extent[2] : -extent[2])};
+    float w = viewProjection[3] * point[0] + viewProjection[7] * point[1] + viewProjection[11] * point[2] +
+              viewProjection[15];
+    if (w < MIN_W)
+    {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+GlrOcclusionQueries *glrCreateOcclusionQueries(GLuint len, const GLchar **error)
+{
+  GLuint program = glCreateProgram();
+  *error = compileProxyProgram(program);
+  if (*error != NULL)
+  {
+    glDeleteProgram(program);
+    return NULL;
+  }
+
+  GlrOcclusionQueries *queries = (GlrOcclusionQueries *)calloc(1, sizeof(GlrOcclusionQueries));
+  queries->len = len;
+  queries->queries = (GLuint *)malloc(sizeof(GLuint) * len);
+  queries->isIssued = (unsigned char *)calloc(len, 1);
+  glGenQueries(len, queries->queries);
+  // The conservative query may pass for samples that are not covered, but it is cheaper on tiled GPUs.
+  queries->target = GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility ? GL_ANY_SAMPLES_PASSED_CONSERVATIVE
+                                                                   : GL_ANY_SAMPLES_PASSED;
+
+  queries->program = program;
+  queries->viewProjectionLocation = glGetUniformLocation(program, "viewProjection");
+  queries->centerLocation = glGetUniformLocation(program, "center");
+  queries->extentLocation = glGetUniformLocation(program, "extent");
+
+  glGenVertexArrays(1, &queries->vao);
+  glGenBuffers(1, &queries->vbo);
+  glGenBuffers(1, &queries->ebo);
+  glBindVertexArray(queries->vao);
+  glBindBuffer(GL_ARRAY_BUFFER, queries->vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(CUBE_VERTICES), CUBE_VERTICES, GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, queries->ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(CUBE_INDICES), CUBE_INDICES, GL_STATIC_DRAW);
+  glrTrackBuffer(queries->vbo, sizeof(CUBE_VERTICES), GLR_MEMORY_GEOMETRY, "glrCreateOcclusionQueries");
+  glrTrackBuffer(queries->ebo, sizeof(CUBE_INDICES), GLR_MEMORY_GEOMETRY, "glrCreateOcclusionQueries");
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 3, (void *)0);
+  glEnableVertexAttribArray(0);
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glrStats()->uploadBytes += sizeof(CUBE_VERTICES) + sizeof(CUBE_INDICES);
+
+  return queries;
+}
+
+void glrIssueOcclusionQueries(GlrOcclusionQueries *queries, const float viewProjection[16], const GlrBounds *bounds)
+{
+  GlrStats *stats = glrStats();
+  glrProfileGpuBegin("Occlusion queries");
+
+  glUseProgram(queries->program);
+  glBindVertexArray(queries->vao);
+  ++stats->programSwitches;
+  ++stats->vaoBinds;
+  glUniformMatrix4fv(queries->viewProjectionLocation, 1, GL_FALSE, viewProjection);
+  ++stats->uniformCalls;
+  stats->uniformBytes += sizeof(GLfloat) * 16;
+
+  // Test against the depth of the frame without changing it
+  glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+  glDepthMask(GL_FALSE);
+
+  const float *extents[3] = {bounds->extentX, bounds->extentY, bounds->extentZ};
+  GLuint len = bounds->len < queries->len ? bounds->len : queries->len;
+  for (GLuint i = 0; i < len; ++i)
+  {
+    float center[3] = {bounds->x[i], bounds->y[i], bounds->z[i]};
+    float extent[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      extent[axis] = bounds->radius != NULL ? bounds->radius[i] : extents[axis][i];
+    }
+
+    // Objects around the camera are always drawn.
+    if (isCrossingNear(viewProjection, center, extent))
+    {
+      queries->isIssued[i] = 0;
+      continue;
+    }
+
+    glUniform3fv(queries->centerLocation, 1, center);
+    glUniform3fv(queries->extentLocation, 1, extent);
+    glBeginQuery(queries->target, queries->queries[i]);
+    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, (void *)0);
+    glEndQuery(queries->target);
+    queries->isIssued[i] = 1;
+
+    glrStatsCountDraw(GL_TRIANGLES, 36);
+    stats->uniformCalls += 2;
+    stats->uniformBytes += sizeof(GLfloat) * 6;
+  }
+
+  glDepthMask(GL_TRUE);
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  glBindVertexArray(0);
+  glrProfileGpuEnd();
+}
+
+void glrBeginConditionalDraw(GlrOcclusionQueries *queries, GLuint index)
+{
+  // Without a result yet the GPU draws anyway instead of waiting for it.
+  if (index < queries->len && queries->isIssued[index])
+  {
+    glBeginConditionalRender(queries->queries[index], GL_QUERY_NO_WAIT);
+  }
+}
+
+void glrEndConditionalDraw(GlrOcclusionQueries *queries, GLuint index)
+{
+  if (index < queries->len && queries->isIssued[index])
+  {
+    glEndConditionalRender();
+  }
+}
+
+void glrDrawModelConditional(GlrOcclusionQueries *queries, GLuint index, GlrModel *model, GlrModelMaterialUniforms *uniforms)
+{
+  glrBeginConditionalDraw(queries, index);
+  glrDrawModel(model, uniforms);
+  glrEndConditionalDraw(queries, index);
+}
+
+void glrFreeOcclusionQueries(GlrOcclusionQueries *queries)
+{
+  glDeleteQueries(queries->len, queries->queries);
+  glDeleteProgram(queries->program);
+  glDeleteVertexArrays(1, &queries->vao);
+  glrUntrackBuffer(queries->vbo);
+  glrUntrackBuffer(queries->ebo);
+  glDeleteBuffers(1, &queries->vbo);
+  glDeleteBuffers(1, &queries->ebo);
+  free(queries->queries);
+  free(queries->isIssued);
+  free(queries);
+}
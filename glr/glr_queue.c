@@ -0,0 +1,290 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "glr.h"
+
+// Opaque key, from the most significant bit:
+//
+//   1 bit  transparent (0)
+//   32 bit state: 10 bit program, 12 bit material (diffuse texture), 10 bit VAO
+//   31 bit depth, front to back
+//
+// Transparent key:
+//
+//   1 bit  transparent (1)
+//   31 bit depth, back to front
+//   32 bit state
+//
+// GL names are truncated to their fields. A collision only costs a redundant state change, the draw compares the real
+// state before binding.
+#define KEY_TRANSPARENT ((GLuint64)1 << 63)
+#define KEY_DEPTH_MASK 0x7FFFFFFFull
+
+static GLuint64 depthBits(float depth)
+{
+  if (!(depth > 0.0f))
+  {
+    return 0;
+  }
+  // Positive floats order like their bit patterns, the sign bit is always 0.
+  uint32_t bits;
+  memcpy(&bits, &depth, sizeof(float));
+  return bits & KEY_DEPTH_MASK;
+}
+
+static GLuint64 makeKey(const GlrDrawItem *item)
+{
+  GLuint64 program = item->program & 0x3FF;
+  GLuint64 material = (item->material != NULL ? item->material->diffuse : 0) & 0xFFF;
+  GLuint64 vao = item->vao & 0x3FF;
+  GLuint64 state = program << 22 | material << 10 | vao;
+
+  if (item->isTransparent)
+  {
+    return KEY_TRANSPARENT | (KEY_DEPTH_MASK - depthBits(item->depth)) << 32 | state;
+  }
+  return state << 31 | depthBits(item->depth);
+}
+
+// Inverse transpose of the upper 3x3 of a column-major mat4, as a column-major mat3.
+static void normalMatrix(const float *m, float *n)
+{
+#define A(row, col) m[(col) * 4 + (row)]
+  float c00 = A(1, 1) * A(2, 2) - A(1, 2) * A(2, 1);
+  float c01 = A(1, 2) * A(2, 0) - A(1, 0) * A(2, 2);
+  float c02 = A(1, 0) * A(2, 1) - A(1, 1) * A(2, 0);
+  float c10 = A(0, 2) * A(2, 1) - A(0, 1) * A(2, 2);
+  float c11 = A(0, 0) * A(2, 2) - A(0, 2) * A(2, 0);
+  float c12 = A(0, 1) * A(2, 0) - A(0, 0) * A(2, 1);
+  float c20 = A(0, 1) * A(1, 2) - A(0, 2) * A(1, 1);
+  float c21 = A(0, 2) * A(1, 0) - A(0, 0) * A(1, 2);
+  float c22 = A(0, 0) * A(1, 1) - A(0, 1) * A(1, 0);
+  float det = A(0, 0) * c00 + A(0, 1) * c01 + A(0, 2) * c02;
+#undef A
+  float invDet = det != 0.0f ? 1.0f / det : 0.0f;
+
+  // The cofactor matrix divided by the determinant is the inverse transpose.
+  n[0] = c00 * invDet;
+  n[1] = c10 * invDet;
+  n[2] = c20 * invDet;
+  n[3] = c01 * invDet;
+  n[4] = c11 * invDet;
+  n[5] = c21 * invDet;
+  n[6] = c02 * invDet;
+  n[7] = c12 * invDet;
+  n[8] = c22 * invDet;
+}
+
+static void reserve(GlrRenderQueue *queue, GLuint len)
+{
+  if (len <= queue->itemsCap)
+  {
+    return;
+  }
+
+  queue->itemsCap = queue->itemsCap == 0 ? 256 : queue->itemsCap * 2;
+  if (queue->itemsCap < len)
+  {
+    queue->itemsCap = len;
+  }
+  queue->items = (GlrDrawItem *)realloc(queue->items, sizeof(GlrDrawItem) * queue->itemsCap);
+  queue->keys = (GLuint64 *)realloc(queue->keys, sizeof(GLuint64) * queue->itemsCap * 2);
+  queue->order = (GLuint *)realloc(queue->order, sizeof(GLuint) * queue->itemsCap * 2);
+}
+
+GlrRenderQueue *glrCreateRenderQueue()
+{
+  return (GlrRenderQueue *)calloc(1, sizeof(GlrRenderQueue));
+}
+
+void glrPushDrawItem(GlrRenderQueue *queue, const GlrDrawItem *item)
+{
+  reserve(queue, queue->itemsLen + 1);
+  queue->items[queue->itemsLen++] = *item;
+  queue->sorted = NULL;
+}
+
+void glrPushModel(GlrRenderQueue *queue, GlrModel *model, const GlrDrawItem *item)
+{
+  reserve(queue, queue->itemsLen + model->batchesLen);
+  queue->sorted = NULL;
+  for (unsigned int i = 0; i < model->batchesLen; ++i)
+  {
+    GlrModelBatch *batch = &model->batches[i];
+    GlrDrawItem *batchItem = &queue->items[queue->itemsLen++];
+    *batchItem = *item;
+    batchItem->vao = model->vao;
+    batchItem->ebo = model->ebo;
+    batchItem->material = batch->materialIndex >= 0 ? &model->materials[batch->materialIndex] : NULL;
+    batchItem->mode = GL_TRIANGLES;
+    batchItem->count = batch->indicesLen;
+    batchItem->indexType = GL_UNSIGNED_INT;
+    batchItem->indicesOffset = batch->indicesOffset;
+  }
+}
+
+void glrSortRenderQueue(GlrRenderQueue *queue)
+{
+  GLuint len = queue->itemsLen;
+  GLuint64 *keys = queue->keys, *keysTmp = queue->keys + queue->itemsCap;
+  GLuint *order = queue->order, *orderTmp = queue->order + queue->itemsCap;
+  for (GLuint i = 0; i < len; ++i)
+  {
+    keys[i] = makeKey(&queue->items[i]);
+    order[i] = i;
+  }
+
+  // LSD radix sort over 8 bit digits, it is stable so equal keys keep their submission order.
+  for (unsigned int shift = 0; shift < 64; shift += 8)
+  {
+    GLuint counts[256] = {0};
+    for (GLuint i = 0; i < len; ++i)
+    {
+      ++counts[(keys[i] >> shift) & 0xFF];
+    }
+    // Skip the digits shared by all keys, e.g. the unused high bits of GL names.
+    if (len == 0 || counts[(keys[0] >> shift) & 0xFF] == len)
+    {
+      continue;
+    }
+
+    GLuint offset = 0;
+    for (unsigned int digit = 0; digit < 256; ++digit)
+    {
+      GLuint count = counts[digit];
+      counts[digit] = offset;
+      offset += count;
+    }
+    for (GLuint i = 0; i < len; ++i)
+    {
+      GLuint dst = counts[(keys[i] >> shift) & 0xFF]++;
+      keysTmp[dst] = keys[i];
+      orderTmp[dst] = order[i];
+    }
+
+    GLuint64 *swapKeys = keys;
+    keys = keysTmp;
+    keysTmp = swapKeys;
+    GLuint *swapOrder = order;
+    order = orderTmp;
+    orderTmp = swapOrder;
+  }
+
+  queue->sorted = order;
+}
+
+static int isSameMaterial(const GlrModelMaterial *a, const GlrModelMaterial *b)
+{
+  return a == b || (a != NULL && b != NULL &&
+                    a->diffuse == b->diffuse && a->specular == b->specular && a->shininess == b->shininess);
+}
+
+void glrDrawRenderQueue(GlrRenderQueue *queue)
+{
+  GlrStats *stats = glrStats();
+  const GlrDrawItem *last = NULL;
+  int isBlending = 0;
+
+  for (GLuint i = 0; i < queue->itemsLen; ++i)
+  {
+    const GlrDrawItem *item = &queue->items[queue->sorted != NULL ? queue->sorted[i] : i];
+
+    if (item->isTransparent && !isBlending)
+    {
+      glEnable(GL_BLEND);
+      glDepthMask(GL_FALSE);
+      isBlending = 1;
+    }
+
+    int isNewProgram = last == NULL || item->program != last->program;
+    if (isNewProgram)
+    {
+      glUseProgram(item->program);
+      ++stats->programSwitches;
+    }
+    int isNewVao = last == NULL || item->vao != last->vao;
+    if (isNewVao)
+    {
+      glBindVertexArray(item->vao);
+      ++stats->vaoBinds;
+    }
+    // The element buffer binding is part of the VAO state
+    if (item->ebo != 0 && (isNewVao || item->ebo != last->ebo))
+    {
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, item->ebo);
+    }
+    // Sampler and shininess uniforms are program state, so a new program rebinds the material too.
+    if (item->material != NULL && (isNewProgram || !isSameMaterial(item->material, last->material)))
+    {
+      glActiveTexture(GL_TEXTURE0);
+      glBindTexture(GL_TEXTURE_2D, item->material->diffuse);
+      glActiveTexture(GL_TEXTURE1);
+      glBindTexture(GL_TEXTURE_2D, item->material->specular);
+      stats->textureBinds += 2;
+
+      if (item->materialUniforms != NULL)
+      {
+        glUniform1f(item->materialUniforms->shininess, item->material->shininess);
+        glUniform1i(item->materialUniforms->diffuse, 0);
+        glUniform1i(item->materialUniforms->specular, 1);
+        stats->uniformCalls += 3;
+        stats->uniformBytes += sizeof(GLfloat) + sizeof(GLint) * 2;
+      }
+    }
+
+    if (item->modelLocation >= 0)
+    {
+      glUniformMatrix4fv(item->modelLocation, 1, GL_FALSE, item->transform);
+      ++stats->uniformCalls;
+      stats->uniformBytes += sizeof(GLfloat) * 16;
+    }
+    if (item->normalMatrixLocation >= 0)
+    {
+      GLfloat normal[9];
+      if (item->normalMatrix == NULL)
+      {
+        normalMatrix(item->transform, normal);
+      }
+      glUniformMatrix3fv(item->normalMatrixLocation, 1, GL_FALSE, item->normalMatrix != NULL ? item->normalMatrix : normal);
+      ++stats->uniformCalls;
+      stats->uniformBytes += sizeof(GLfloat) * 9;
+    }
+    if (item->setUniforms != NULL)
+    {
+      item->setUniforms(item);
+    }
+
+    if (item->indexType != 0)
+    {
+      glDrawElements(item->mode, item->count, item->indexType, item->indicesOffset);
+    }
+    else
+    {
+      glDrawArrays(item->mode, item->first, item->count);
+    }
+    glrStatsCountDraw(item->mode, item->count);
+
+    last = item;
+  }
+
+  if (isBlending)
+  {
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+  }
+}
+
+void glrClearRenderQueue(GlrRenderQueue *queue)
+{
+  queue->itemsLen = 0;
+  queue->sorted = NULL;
+}
+
+void glrFreeRenderQueue(GlrRenderQueue *queue)
+{
+  free(queue->items);
+  free(queue->keys);
+  free(queue->order);
+  free(queue);
+}
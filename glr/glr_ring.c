@@ -0,0 +1,154 @@
+#include <stdlib.h>
+
+#include "glr.h"
+
+// Wait up to a second at a time for the GPU to release a frame
+#define FENCE_TIMEOUT_NS 1000000000ull
+
+static GLsizeiptr alignUp(GLsizeiptr offset, GLsizeiptr alignment)
+{
+  return alignment > 1 ? (offset + alignment - 1) / alignment * alignment : offset;
+}
+
+GlrRingBuffer *glrCreateRingBuffer(GLsizeiptr frameSize)
+{
+  GlrRingBuffer *ring = (GlrRingBuffer *)calloc(1, sizeof(GlrRingBuffer));
+  ring->frameSize = frameSize;
+  ring->size = frameSize * GLR_RING_FRAMES;
+  ring->isPersistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+
+  // The copy target leaves the bindings of the caller alone, a buffer is not tied to the target it is created on.
+  glGenBuffers(1, &ring->buffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, ring->buffer);
+  if (ring->isPersistent)
+  {
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_COPY_WRITE_BUFFER, ring->size, NULL, flags);
+    ring->mapped = (unsigned char *)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, ring->size, flags);
+    if (ring->mapped == NULL)
+    {
+      // Immutable storage cannot be specified again, a new buffer takes the path without buffer storage.
+      glDeleteBuffers(1, &ring->buffer);
+      glGenBuffers(1, &ring->buffer);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, ring->buffer);
+      ring->isPersistent = 0;
+    }
+  }
+  if (!ring->isPersistent)
+  {
+    glBufferData(GL_COPY_WRITE_BUFFER, ring->size, NULL, GL_STREAM_DRAW);
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  glrTrackBuffer(ring->buffer, ring->size, GLR_MEMORY_STREAMING, "glrCreateRingBuffer");
+  return ring;
+}
+
+// Block until the GPU is done with the part of the buffer the current frame writes into.
+static void waitForFrame(GlrRingBuffer *ring)
+{
+  GLsync fence = ring->fences[ring->frame];
+  if (fence == NULL)
+  {
+    return;
+  }
+  GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+  GLenum result;
+  while ((result = glClientWaitSync(fence, flags, FENCE_TIMEOUT_NS)) == GL_TIMEOUT_EXPIRED)
+  {
+    flags = 0;
+  }
+  if (result == GL_WAIT_FAILED)
+  {
+    // Nothing sensible is left to wait for, writing on is the best that can be done.
+    glFinish();
+  }
+  glDeleteSync(fence);
+  ring->fences[ring->frame] = NULL;
+}
+
+void *glrMapRing(GlrRingBuffer *ring, GLsizeiptr size, GLsizeiptr alignment, GLintptr *offset)
+{
+  if (ring->isPersistent)
+  {
+    // Each frame writes into its own third, which the fence of three frames ago protects.
+    if (!ring->isFrameReady)
+    {
+      waitForFrame(ring);
+      ring->isFrameReady = 1;
+    }
+    GLsizeiptr begin = alignUp(ring->head, alignment);
+    if (begin + size > ring->frameSize)
+    {
+      return NULL;
+    }
+    ring->head = begin + size;
+    *offset = ring->frameSize * ring->frame + begin;
+    glrStats()->uploadBytes += size;
+    return ring->mapped + *offset;
+  }
+
+  // Without buffer storage, appends are mapped unsynchronized and a full buffer is orphaned instead of waited on.
+  if (size > ring->size)
+  {
+    return NULL;
+  }
+  GLsizeiptr begin = alignUp(ring->head, alignment);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, ring->buffer);
+  if (begin + size > ring->size)
+  {
+    glBufferData(GL_COPY_WRITE_BUFFER, ring->size, NULL, GL_STREAM_DRAW);
+    begin = 0;
+  }
+  void *data = glMapBufferRange(GL_COPY_WRITE_BUFFER, begin, size,
+                                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+  ring->head = begin + size;
+  *offset = begin;
+  glrStats()->uploadBytes += size;
+  return data;
+}
+
+void glrUnmapRing(GlrRingBuffer *ring)
+{
+  if (ring->isPersistent)
+  {
+    return;
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, ring->buffer);
+  glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void glrRingEndFrame(GlrRingBuffer *ring)
+{
+  if (!ring->isPersistent)
+  {
+    return;
+  }
+  if (ring->isFrameReady)
+  {
+    ring->fences[ring->frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+  ring->frame = (ring->frame + 1) % GLR_RING_FRAMES;
+  ring->head = 0;
+  ring->isFrameReady = 0;
+}
+
+void glrFreeRingBuffer(GlrRingBuffer *ring)
+{
+  for (int i = 0; i < GLR_RING_FRAMES; ++i)
+  {
+    if (ring->fences[i] != NULL)
+    {
+      glDeleteSync(ring->fences[i]);
+    }
+  }
+  if (ring->isPersistent)
+  {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ring->buffer);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+  glrUntrackBuffer(ring->buffer);
+  glDeleteBuffers(1, &ring->buffer);
+  free(ring);
+}
@@ -1,7 +1,79 @@
+#include <stdlib.h>
+#include <string.h>
+
 #include "glr.h"
 
 const char* UNKNOWN_GLR_SETUP_ERROR = "Unknown GLR Setup Error";
+const char* INCOMPLETE_HEADLESS_FRAMEBUFFER_ERROR = "Headless framebuffer is incomplete";
 static GLenum glewError = GLEW_OK;
+static const char *headlessError = NULL;
+
+static GLuint headlessFramebuffer = 0;
+static GLuint headlessRenderbuffers[2] = {0, 0};
+static PFNGLBINDFRAMEBUFFERPROC bindFramebuffer = NULL;
+
+// Redirect the default framebuffer to the headless one, so chapters can keep binding 0.
+static void GLAPIENTRY bindHeadlessFramebuffer(GLenum target, GLuint framebuffer)
+{
+  bindFramebuffer(target, framebuffer == 0 ? headlessFramebuffer : framebuffer);
+}
+
+static int isHeadlessRequested(GlrSetupArgs *args)
+{
+  const char *env = getenv("GLR_HEADLESS");
+  return args->headless || (env != NULL && env[0] != '\0' && strcmp(env, "0") != 0);
+}
+
+static GLFWwindow *createHeadlessWindow(GlrSetupArgs *args)
+{
+  // The null platform has no display, the context is created via EGL surfaceless or OSMesa instead.
+  static const int CONTEXT_APIS[] = {GLFW_EGL_CONTEXT_API, GLFW_OSMESA_CONTEXT_API};
+
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  for (unsigned int i = 0; i < sizeof(CONTEXT_APIS) / sizeof(int); ++i)
+  {
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, CONTEXT_APIS[i]);
+    GLFWwindow *window = glfwCreateWindow(
+        args->windowWidth,
+        args->windowHeight,
+        args->windowTitle,
+        NULL, NULL);
+    if (window)
+    {
+      return window;
+    }
+  }
+
+  return NULL;
+}
+
+static int setupHeadlessFramebuffer(GlrSetupArgs *args)
+{
+  glGenRenderbuffers(2, headlessRenderbuffers);
+  glBindRenderbuffer(GL_RENDERBUFFER, headlessRenderbuffers[0]);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, args->windowWidth, args->windowHeight);
+  glBindRenderbuffer(GL_RENDERBUFFER, headlessRenderbuffers[1]);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, args->windowWidth, args->windowHeight);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glGenFramebuffers(1, &headlessFramebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, headlessFramebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, headlessRenderbuffers[0]);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, headlessRenderbuffers[1]);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+  {
+    headlessError = INCOMPLETE_HEADLESS_FRAMEBUFFER_ERROR;
+    return 0;
+  }
+
+  // A surfaceless context starts with an empty viewport.
+  glViewport(0, 0, args->windowWidth, args->windowHeight);
+
+  bindFramebuffer = __glewBindFramebuffer;
+  __glewBindFramebuffer = bindHeadlessFramebuffer;
+
+  return 1;
+}
 
 GLFWwindow *glrSetup(GlrSetupArgs *args)
 {
@@ -15,8 +87,13 @@ GLFWwindow *glrSetup(GlrSetupArgs *args)
   {
     args = &DEFAULT_ARGS;
   }
+  int headless = isHeadlessRequested(args);
 
   /* Initialize the library */
+  if (headless)
+  {
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+  }
   if (!glfwInit())
   {
     return NULL;
@@ -27,11 +104,18 @@ GLFWwindow *glrSetup(GlrSetupArgs *args)
   // glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 
   /* Create a windowed mode window and its OpenGL context */
-  window = glfwCreateWindow(
-      args->windowWidth,
-      args->windowHeight,
-      args->windowTitle,
-      NULL, NULL);
+  if (headless)
+  {
+    window = createHeadlessWindow(args);
+  }
+  else
+  {
+    window = glfwCreateWindow(
+        args->windowWidth,
+        args->windowHeight,
+        args->windowTitle,
+        NULL, NULL);
+  }
   if (!window)
   {
     glfwTerminate();
@@ -43,15 +127,34 @@ GLFWwindow *glrSetup(GlrSetupArgs *args)
 
   /* Init after GL context is available */
   glewError = glewInit();
+  // GLEW built for GLX reports the missing X display with EGL contexts, but the entry points are still loaded.
+  if (headless && GLEW_ERROR_NO_GLX_DISPLAY == glewError)
+  {
+    glewError = GLEW_OK;
+  }
   if (GLEW_OK != glewError)
   {
     glfwTerminate();
     return NULL;
   }
 
+  if (headless && !setupHeadlessFramebuffer(args))
+  {
+    glfwTerminate();
+    return NULL;
+  }
+
+  glrFrameInit(args);
+  glrInputInit(window);
+
   return window;
 }
 
+GLuint glrHeadlessFramebuffer()
+{
+  return headlessFramebuffer;
+}
+
 const char* glrSetupError() {
   const char* err = NULL;
   if (GLFW_NO_ERROR != glfwGetError(&err) && err != NULL) {
@@ -62,6 +165,11 @@ const char* glrSetupError() {
     glewError = GLEW_OK;
     return glewGetErrorString(err);
   }
+  if (headlessError != NULL) {
+    err = headlessError;
+    headlessError = NULL;
+    return err;
+  }
 
   return UNKNOWN_GLR_SETUP_ERROR;
 }
@@ -59,7 +59,14 @@ const GLchar* glrShaderSourceFromFile(GLuint shader, const char *filename)
 const GLchar* glrShaderBinary(GLuint shader, GLenum binaryFormat, const void *binary, GLsizei length, const GLchar *entryPoint)
 {
   glShaderBinary(1, &shader, binaryFormat, binary, length);
-  glSpecializeShader(shader, entryPoint, 0, NULL, NULL);
+  if (GLEW_VERSION_4_6)
+  {
+    glSpecializeShader(shader, entryPoint, 0, NULL, NULL);
+  }
+  else
+  {
+    glSpecializeShaderARB(shader, entryPoint, 0, NULL, NULL);
+  }
 
   return glrGetShaderError(shader);
 }
@@ -75,9 +82,36 @@ const GLchar* glrShaderBinaryFromFile(GLuint shader, GLenum binaryFormat, const
   return glrShaderBinary(shader, binaryFormat, buffer, len, entryPoint);
 }
 
-const GLchar *glrLinkProgram(GLuint program) {
-  glLinkProgram(program);
+GLboolean glrSpirvSupported()
+{
+  return GLEW_VERSION_4_6 || GLEW_ARB_gl_spirv;
+}
 
+const GLchar *glrShaderFromFile(GLuint shader, const char *filename)
+{
+  if (glrSpirvSupported())
+  {
+    size_t filenameLen = strlen(filename);
+    char *spirvFilename = (char *)malloc(filenameLen + sizeof(".spv"));
+    memcpy(spirvFilename, filename, filenameLen);
+    memcpy(spirvFilename + filenameLen, ".spv", sizeof(".spv"));
+
+    GLsizei len = 0;
+    char *binary = glrReadFile(spirvFilename, "rb", &len);
+    free(spirvFilename);
+    if (binary != NULL)
+    {
+      const GLchar *error = glrShaderBinary(shader, GL_SHADER_BINARY_FORMAT_SPIR_V_ARB, binary, len, "main");
+      free(binary);
+      return error;
+    }
+  }
+
+  return glrShaderSourceFromFile(shader, filename);
+}
+
+static const GLchar *glrGetProgramError(GLuint program)
+{
   GLint isLinked = 0;
   glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
 
@@ -96,3 +130,92 @@ const GLchar *glrLinkProgram(GLuint program) {
 
   return NULL;
 }
+
+const GLchar *glrLinkProgram(GLuint program)
+{
+  glLinkProgram(program);
+
+  return glrGetProgramError(program);
+}
+
+void glrMaxShaderCompilerThreads(GLuint count)
+{
+  if (GLEW_KHR_parallel_shader_compile)
+  {
+    glMaxShaderCompilerThreadsKHR(count);
+  }
+}
+
+void glrShaderSourceAsync(GLuint shader, const GLchar *string, GLsizei length)
+{
+  GLint lengthInt = (GLint)length;
+  glShaderSource(shader, 1, &string, &lengthInt);
+  glCompileShader(shader);
+}
+
+const GLchar *glrShaderSourceFromFileAsync(GLuint shader, const char *filename)
+{
+  GLsizei len = 0;
+  char *buffer = glrReadFile(filename, "r", &len);
+  if (buffer == NULL)
+  {
+    return strerrorDup();
+  }
+  glrShaderSourceAsync(shader, buffer, len);
+  // The driver has copied the source in glShaderSource.
+  free(buffer);
+  return NULL;
+}
+
+void glrLinkProgramAsync(GLuint program)
+{
+  glLinkProgram(program);
+}
+
+GLboolean glrShaderIsCompleted(GLuint shader)
+{
+  if (!GLEW_KHR_parallel_shader_compile)
+  {
+    // Without the extension the status query in glrShaderResult is the sync point.
+    return GL_TRUE;
+  }
+
+  GLint isCompleted = GL_FALSE;
+  glGetShaderiv(shader, GL_COMPLETION_STATUS_KHR, &isCompleted);
+  return (GLboolean)isCompleted;
+}
+
+GLboolean glrProgramIsCompleted(GLuint program)
+{
+  if (!GLEW_KHR_parallel_shader_compile)
+  {
+    return GL_TRUE;
+  }
+
+  GLint isCompleted = GL_FALSE;
+  glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &isCompleted);
+  return (GLboolean)isCompleted;
+}
+
+GLsizei glrProgramsPending(const GLuint *programs, GLsizei len)
+{
+  GLsizei pending = 0;
+  for (GLsizei i = 0; i < len; ++i)
+  {
+    if (!glrProgramIsCompleted(programs[i]))
+    {
+      ++pending;
+    }
+  }
+  return pending;
+}
+
+const GLchar *glrShaderResult(GLuint shader)
+{
+  return glrGetShaderError(shader);
+}
+
+const GLchar *glrProgramResult(GLuint program)
+{
+  return glrGetProgramError(program);
+}
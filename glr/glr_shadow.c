@@ -0,0 +1,492 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "glr.h"
+
+// Weight of the logarithmic split distances against the uniform ones
+#define DEFAULT_SPLIT_LAMBDA 0.75f
+// Steps of the cascade size per split diameter. The size only changes in these steps, so the texel grid
+// stays put while the camera turns.
+#define SIZE_STEPS 16.0f
+// Margin around the fitted box in texels, for filtering
+#define MARGIN_TEXELS 2.0f
+// Margin a cascade that is not due must still keep around the receivers, 2x2 PCF reads one texel out
+#define STALE_MARGIN_TEXELS 1.0f
+// How far a cached translation may be from whole texels to scroll the cache
+#define SCROLL_TOLERANCE 1.0e-2f
+
+static float dot3(const float a[3], const float b[3])
+{
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void cross3(const float a[3], const float b[3], float out[3])
+{
+  out[0] = a[1] * b[2] - a[2] * b[1];
+  out[1] = a[2] * b[0] - a[0] * b[2];
+  out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static void normalize3(float v[3])
+{
+  float len = sqrtf(dot3(v, v));
+  if (len > 0.0f)
+  {
+    v[0] /= len;
+    v[1] /= len;
+    v[2] /= len;
+  }
+}
+
+// World space corners of the camera frustum between the view distances near and far. The view is rigid, so its
+// inverse is the transposed rotation.
+static void splitCorners(const float view[16], const float projection[16], float near, float far, float corners[8][3])
+{
+  for (int corner = 0; corner < 8; ++corner)
+  {
+    float distance = corner & 4 ? far : near;
+    float p[3] = {
+        (corner & 1 ? distance : -distance) / projection[0],
+        (corner & 2 ? distance : -distance) / projection[5],
+        -distance};
+    p[0] -= view[12];
+    p[1] -= view[13];
+    p[2] -= view[14];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      corners[corner][axis] = view[axis * 4] * p[0] + view[axis * 4 + 1] * p[1] + view[axis * 4 + 2] * p[2];
+    }
+  }
+}
+
+// The light space of a light view looking along the light direction, like glm_lookat
+typedef struct LightSpace
+{
+  float right[3];
+  float up[3];
+  float forward[3];
+} LightSpace;
+
+static void lightSpace(const float direction[3], LightSpace *space)
+{
+  space->forward[0] = direction[0];
+  space->forward[1] = direction[1];
+  space->forward[2] = direction[2];
+  normalize3(space->forward);
+
+  float up[3] = {0.0f, 1.0f, 0.0f};
+  if (fabsf(space->forward[1]) > 0.99f)
+  {
+    up[1] = 0.0f;
+    up[2] = 1.0f;
+  }
+  cross3(space->forward, up, space->right);
+  normalize3(space->right);
+  cross3(space->right, space->forward, space->up);
+}
+
+// Bounds of points in light space, x and y across the light and depth along it
+static void lightBounds(const LightSpace *space, const float (*points)[3], int len, float min[3], float max[3])
+{
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    min[axis] = INFINITY;
+    max[axis] = -INFINITY;
+  }
+  for (int i = 0; i < len; ++i)
+  {
+    float p[3] = {dot3(space->right, points[i]), dot3(space->up, points[i]), dot3(space->forward, points[i])};
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      min[axis] = p[axis] < min[axis] ? p[axis] : min[axis];
+      max[axis] = p[axis] > max[axis] ? p[axis] : max[axis];
+    }
+  }
+}
+
+// Light space bounds of the receivers of a split. Across the light, only the part of the split inside the scene
+// receives shadows. Along the light, the receivers end at the far end of the split.
+static void receiverBounds(
+    const LightSpace *space,
+    const float corners[8][3],
+    const float sceneCorners[8][3],
+    float min[3],
+    float max[3],
+    float sceneMin[3],
+    float sceneMax[3])
+{
+  float splitMin[3], splitMax[3];
+  lightBounds(space, corners, 8, splitMin, splitMax);
+  lightBounds(space, sceneCorners, 8, sceneMin, sceneMax);
+  for (int axis = 0; axis < 2; ++axis)
+  {
+    min[axis] = splitMin[axis] > sceneMin[axis] ? splitMin[axis] : sceneMin[axis];
+    max[axis] = splitMax[axis] < sceneMax[axis] ? splitMax[axis] : sceneMax[axis];
+    if (min[axis] >= max[axis])
+    {
+      min[axis] = splitMin[axis];
+      max[axis] = splitMax[axis];
+    }
+  }
+  min[2] = splitMin[2];
+  max[2] = splitMax[2];
+}
+
+// Whether the box a cascade was last fitted to still covers the receivers of its split, which moved with the camera
+// since. The view projection maps light space linearly, each clip axis is a scale of a light axis plus an offset.
+static int isCovered(
+    const GlrShadowCascades *cascades,
+    int index,
+    const LightSpace *space,
+    const float corners[8][3],
+    const float sceneCorners[8][3])
+{
+  float min[3], max[3], sceneMin[3], sceneMax[3];
+  receiverBounds(space, corners, sceneCorners, min, max, sceneMin, sceneMax);
+  const float *m = cascades->viewProjections[index];
+  float limit = 1.0f - 2.0f * STALE_MARGIN_TEXELS / cascades->resolution;
+  for (int axis = 0; axis < 2; ++axis)
+  {
+    float scale = sqrtf(m[axis] * m[axis] + m[4 + axis] * m[4 + axis] + m[8 + axis] * m[8 + axis]);
+    if (scale * min[axis] + m[12 + axis] < -limit || scale * max[axis] + m[12 + axis] > limit)
+    {
+      return 0;
+    }
+  }
+  // Receivers beyond the scene are not in the box either, nothing casts on them.
+  float depth = max[2] < sceneMax[2] ? max[2] : sceneMax[2];
+  float scaleZ = sqrtf(m[2] * m[2] + m[6] * m[6] + m[10] * m[10]);
+  return scaleZ * depth + m[14] <= 1.0f;
+}
+
+static void fitCascade(
+    GlrShadowCascades *cascades,
+    int index,
+    const LightSpace *space,
+    const float corners[8][3],
+    const float sceneCorners[8][3])
+{
+  float min[3], max[3], sceneMin[3], sceneMax[3];
+  receiverBounds(space, corners, sceneCorners, min, max, sceneMin, sceneMax);
+  float splitMax = max[2];
+  // A square box sized in steps of the split's diameter, which does not change when the camera turns
+  float diameter = 0.0f;
+  for (int i = 0; i < 8; ++i)
+  {
+    for (int j = i + 1; j < 8; ++j)
+    {
+      float d[3] = {corners[j][0] - corners[i][0], corners[j][1] - corners[i][1], corners[j][2] - corners[i][2]};
+      float len = sqrtf(dot3(d, d));
+      diameter = len > diameter ? len : diameter;
+    }
+  }
+  float step = diameter / SIZE_STEPS;
+
+  // Along the light, casters between the light and the split are anywhere in the scene. The far end moves in steps
+  // too, so the depth of cached casters stays valid while the camera moves.
+  min[2] = sceneMin[2];
+  max[2] = step > 0.0f ? ceilf(splitMax / step) * step : splitMax;
+  max[2] = max[2] < sceneMax[2] ? max[2] : sceneMax[2];
+  if (min[2] >= max[2])
+  {
+    max[2] = min[2] + 1.0f;
+  }
+
+  float size = fmaxf(max[0] - min[0], max[1] - min[1]);
+  size *= 1.0f + 2.0f * MARGIN_TEXELS / cascades->resolution;
+  size = step > 0.0f ? ceilf(size / step) * step : size;
+
+  // Snap the center to whole texels so static geometry rasterizes the same way every frame.
+  float texel = size / cascades->resolution;
+  float center[2];
+  for (int axis = 0; axis < 2; ++axis)
+  {
+    center[axis] = floorf((min[axis] + max[axis]) * 0.5f / texel) * texel;
+  }
+
+  // Orthographic projection of the box times the light view, column-major
+  float scaleX = 2.0f / size, scaleY = 2.0f / size, scaleZ = 2.0f / (max[2] - min[2]);
+  float *m = cascades->viewProjections[index];
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    m[axis * 4] = scaleX * space->right[axis];
+    m[axis * 4 + 1] = scaleY * space->up[axis];
+    m[axis * 4 + 2] = scaleZ * space->forward[axis];
+    m[axis * 4 + 3] = 0.0f;
+  }
+  m[12] = -scaleX * center[0];
+  m[13] = -scaleY * center[1];
+  m[14] = -(max[2] + min[2]) / (max[2] - min[2]);
+  m[15] = 1.0f;
+}
+
+GlrShadowCascades *glrCreateShadowCascades(int cascadesLen, int resolution)
+{
+  GlrShadowCascades *cascades = (GlrShadowCascades *)calloc(1, sizeof(GlrShadowCascades));
+  cascades->cascadesLen = cascadesLen < 1 ? 1 : cascadesLen > GLR_MAX_CASCADES ? GLR_MAX_CASCADES : cascadesLen;
+  cascades->resolution = resolution;
+  cascades->splitLambda = DEFAULT_SPLIT_LAMBDA;
+  for (int i = 0; i < GLR_MAX_CASCADES; ++i)
+  {
+    cascades->updateIntervals[i] = i < 2 ? 1 : 1 << (i - 1);
+  }
+
+  // The cache is only copied by blits, it needs no sampling state.
+  glGenTextures(1, &cascades->staticTexture);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, cascades->staticTexture);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, resolution, resolution, cascades->cascadesLen, 0,
+               GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+  glGenTextures(1, &cascades->texture);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, cascades->texture);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, resolution, resolution, cascades->cascadesLen, 0,
+               GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+  // Linear filtering of a comparing sampler is hardware 2x2 PCF.
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+  // Outside the map is lit
+  const GLfloat border[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+  glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  glrTrackTexture(GL_TEXTURE_2D_ARRAY, cascades->staticTexture, GLR_MEMORY_RENDER_TARGETS, "glrCreateShadowCascades");
+  glrTrackTexture(GL_TEXTURE_2D_ARRAY, cascades->texture, GLR_MEMORY_RENDER_TARGETS, "glrCreateShadowCascades");
+
+  glGenFramebuffers(1, &cascades->framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, cascades->framebuffer);
+  glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cascades->texture, 0, 0);
+  glDrawBuffer(GL_NONE);
+  glReadBuffer(GL_NONE);
+  glGenFramebuffers(1, &cascades->readFramebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, cascades->readFramebuffer);
+  glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cascades->staticTexture, 0, 0);
+  glDrawBuffer(GL_NONE);
+  glReadBuffer(GL_NONE);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  return cascades;
+}
+
+void glrUpdateShadowCascades(
+    GlrShadowCascades *cascades,
+    const float view[16],
+    const float projection[16],
+    const float lightDirection[3],
+    const float sceneMin[3],
+    const float sceneMax[3])
+{
+  // The near and far planes of a perspective projection
+  float near = projection[14] / (projection[10] - 1.0f);
+  float far = projection[14] / (projection[10] + 1.0f);
+
+  LightSpace space;
+  lightSpace(lightDirection, &space);
+  if (memcmp(lightDirection, cascades->lightDirection, sizeof(cascades->lightDirection)) != 0)
+  {
+    memcpy(cascades->lightDirection, lightDirection, sizeof(cascades->lightDirection));
+    glrInvalidateShadowCascades(cascades);
+  }
+  float sceneCorners[8][3];
+  for (int corner = 0; corner < 8; ++corner)
+  {
+    sceneCorners[corner][0] = corner & 1 ? sceneMax[0] : sceneMin[0];
+    sceneCorners[corner][1] = corner & 2 ? sceneMax[1] : sceneMin[1];
+    sceneCorners[corner][2] = corner & 4 ? sceneMax[2] : sceneMin[2];
+  }
+
+  float splitNear = near;
+  for (int i = 0; i < cascades->cascadesLen; ++i)
+  {
+    // Practical split scheme: logarithmic splits match the perspective, uniform ones keep far cascades useful.
+    float t = (float)(i + 1) / cascades->cascadesLen;
+    float logSplit = near * powf(far / near, t);
+    float uniformSplit = near + (far - near) * t;
+    float splitFar = cascades->splitLambda * logSplit + (1.0f - cascades->splitLambda) * uniformSplit;
+
+    // Staggered by the index, so the distant cascades do not all update in the same frame. A cascade is due early
+    // once the camera moved its split out of the box it was fitted to, fragments outside would lose their shadow.
+    float corners[8][3];
+    splitCorners(view, projection, splitNear, splitFar, corners);
+    int interval = cascades->updateIntervals[i] < 1 ? 1 : cascades->updateIntervals[i];
+    cascades->isDue[i] = (cascades->frame + i) % interval == 0 || !cascades->isCached[i] ||
+                         !isCovered(cascades, i, &space, corners, sceneCorners);
+    if (cascades->isDue[i])
+    {
+      fitCascade(cascades, i, &space, corners, sceneCorners);
+    }
+    cascades->splits[i] = splitFar;
+    splitNear = splitFar;
+  }
+  ++cascades->frame;
+}
+
+void glrBeginShadowCascade(GlrShadowCascades *cascades, int index)
+{
+  glBindFramebuffer(GL_FRAMEBUFFER, cascades->framebuffer);
+  ++glrStats()->framebufferBinds;
+  glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cascades->texture, 0, index);
+  glViewport(0, 0, cascades->resolution, cascades->resolution);
+  glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void glrEndShadowCascades(GlrShadowCascades *cascades)
+{
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  ++glrStats()->framebufferBinds;
+}
+
+// Attach the layer of the cache and of the shadow map as the read and the draw framebuffer.
+static void bindLayers(GlrShadowCascades *cascades, int index, GLuint readTexture, GLuint drawTexture)
+{
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, cascades->readFramebuffer);
+  glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, readTexture, 0, index);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, cascades->framebuffer);
+  ++glrStats()->framebufferBinds;
+  glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, drawTexture, 0, index);
+}
+
+// Copy the depth of a layer moved by whole texels, the uncovered part of the destination is left alone.
+static void copyLayer(GlrShadowCascades *cascades, int index, GLuint from, GLuint to, int shiftX, int shiftY)
+{
+  int resolution = cascades->resolution;
+  int x0 = shiftX < 0 ? -shiftX : 0, x1 = shiftX > 0 ? resolution - shiftX : resolution;
+  int y0 = shiftY < 0 ? -shiftY : 0, y1 = shiftY > 0 ? resolution - shiftY : resolution;
+  bindLayers(cascades, index, from, to);
+  glBlitFramebuffer(x0, y0, x1, y1, x0 + shiftX, y0 + shiftY, x1 + shiftX, y1 + shiftY, GL_DEPTH_BUFFER_BIT,
+                    GL_NEAREST);
+}
+
+// How many whole texels the cached static depth moves to line up with the current view projection. Fails when
+// anything else than the translation across the light changed.
+static int scrollTexels(const GlrShadowCascades *cascades, int index, int *shiftX, int *shiftY)
+{
+  const float *cached = cascades->cachedViewProjections[index];
+  const float *current = cascades->viewProjections[index];
+  for (int i = 0; i < 16; ++i)
+  {
+    if (i != 12 && i != 13 && cached[i] != current[i])
+    {
+      return 0;
+    }
+  }
+  // Clip space spans 2 over the resolution
+  float x = (current[12] - cached[12]) * cascades->resolution * 0.5f;
+  float y = (current[13] - cached[13]) * cascades->resolution * 0.5f;
+  *shiftX = (int)roundf(x);
+  *shiftY = (int)roundf(y);
+  return fabsf(x - *shiftX) < SCROLL_TOLERANCE && fabsf(y - *shiftY) < SCROLL_TOLERANCE &&
+         abs(*shiftX) < cascades->resolution && abs(*shiftY) < cascades->resolution;
+}
+
+// Bring the static depth of a cascade up to date with its view projection, rendering as little as possible. Returns
+// whether the shadow map holds the static depth already.
+static int updateStaticLayer(GlrShadowCascades *cascades, int index, GlrShadowCastersCallback renderStatic, void *ctx)
+{
+  int resolution = cascades->resolution;
+  const float *viewProjection = cascades->viewProjections[index];
+  int shiftX = 0, shiftY = 0, isCopied = 0;
+  if (cascades->isCached[index] && !scrollTexels(cascades, index, &shiftX, &shiftY))
+  {
+    cascades->isCached[index] = 0;
+  }
+
+  if (!cascades->isCached[index])
+  {
+    bindLayers(cascades, index, cascades->texture, cascades->staticTexture);
+    glViewport(0, 0, resolution, resolution);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    renderStatic(viewProjection, ctx);
+  }
+  else if (shiftX != 0 || shiftY != 0)
+  {
+    // A layer cannot be blitted onto itself, so the moved depth goes through the shadow map, where the uncovered
+    // strips are rendered, and back into the cache.
+    copyLayer(cascades, index, cascades->staticTexture, cascades->texture, shiftX, shiftY);
+    glViewport(0, 0, resolution, resolution);
+    glEnable(GL_SCISSOR_TEST);
+    if (shiftX != 0)
+    {
+      glScissor(shiftX > 0 ? 0 : resolution + shiftX, 0, abs(shiftX), resolution);
+      glClear(GL_DEPTH_BUFFER_BIT);
+      renderStatic(viewProjection, ctx);
+    }
+    if (shiftY != 0)
+    {
+      glScissor(0, shiftY > 0 ? 0 : resolution + shiftY, resolution, abs(shiftY));
+      glClear(GL_DEPTH_BUFFER_BIT);
+      renderStatic(viewProjection, ctx);
+    }
+    glDisable(GL_SCISSOR_TEST);
+    copyLayer(cascades, index, cascades->texture, cascades->staticTexture, 0, 0);
+    isCopied = 1;
+  }
+
+  memcpy(cascades->cachedViewProjections[index], viewProjection, sizeof(cascades->cachedViewProjections[index]));
+  cascades->isCached[index] = 1;
+  return isCopied;
+}
+
+void glrRenderShadowCascades(
+    GlrShadowCascades *cascades,
+    GlrShadowCastersCallback renderStatic,
+    GlrShadowCastersCallback renderDynamic,
+    void *ctx)
+{
+  for (int i = 0; i < cascades->cascadesLen; ++i)
+  {
+    if (!cascades->isDue[i])
+    {
+      continue;
+    }
+    if (!updateStaticLayer(cascades, i, renderStatic, ctx))
+    {
+      copyLayer(cascades, i, cascades->staticTexture, cascades->texture, 0, 0);
+    }
+    else
+    {
+      // A scroll ends by copying into the cache, which is still attached for drawing.
+      glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cascades->texture, 0, i);
+    }
+    if (renderDynamic != NULL)
+    {
+      glViewport(0, 0, cascades->resolution, cascades->resolution);
+      renderDynamic(cascades->viewProjections[i], ctx);
+    }
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  ++glrStats()->framebufferBinds;
+}
+
+void glrInvalidateShadowCascades(GlrShadowCascades *cascades)
+{
+  for (int i = 0; i < GLR_MAX_CASCADES; ++i)
+  {
+    cascades->isCached[i] = 0;
+  }
+}
+
+void glrShadowCascadesUniforms(GlrShadowCascades *cascades, GLint viewProjectionsLocation, GLint splitsLocation)
+{
+  GlrStats *stats = glrStats();
+  glUniformMatrix4fv(viewProjectionsLocation, cascades->cascadesLen, GL_FALSE, cascades->viewProjections[0]);
+  glUniform1fv(splitsLocation, cascades->cascadesLen, cascades->splits);
+  stats->uniformCalls += 2;
+  stats->uniformBytes += sizeof(GLfloat) * 17 * cascades->cascadesLen;
+}
+
+void glrFreeShadowCascades(GlrShadowCascades *cascades)
+{
+  glDeleteFramebuffers(1, &cascades->framebuffer);
+  glDeleteFramebuffers(1, &cascades->readFramebuffer);
+  glrUntrackTexture(cascades->texture);
+  glrUntrackTexture(cascades->staticTexture);
+  glDeleteTextures(1, &cascades->texture);
+  glDeleteTextures(1, &cascades->staticTexture);
+  free(cascades);
+}
@@ -0,0 +1,36 @@
+#ifndef __GLR_SIMD_H__
+#define __GLR_SIMD_H__
+
+// Floats per SIMD vector shared by the batched tests of glr: 8 with AVX, 4 with SSE, 1 otherwise. Only included by
+// glr sources.
+#if defined(__AVX__)
+#include <immintrin.h>
+#define LANES 8
+typedef __m256 Vec;
+#define vecSet1 _mm256_set1_ps
+#define vecLoad _mm256_loadu_ps
+#define vecZero _mm256_setzero_ps
+#define vecAdd _mm256_add_ps
+#define vecSub _mm256_sub_ps
+#define vecMul _mm256_mul_ps
+#define vecMax _mm256_max_ps
+#define vecIsPositive(v) _mm256_movemask_ps(_mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_GT_OQ))
+#define vecIsLessEqual(a, b) _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LE_OQ))
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define LANES 4
+typedef __m128 Vec;
+#define vecSet1 _mm_set1_ps
+#define vecLoad _mm_loadu_ps
+#define vecZero _mm_setzero_ps
+#define vecAdd _mm_add_ps
+#define vecSub _mm_sub_ps
+#define vecMul _mm_mul_ps
+#define vecMax _mm_max_ps
+#define vecIsPositive(v) _mm_movemask_ps(_mm_cmpgt_ps(v, _mm_setzero_ps()))
+#define vecIsLessEqual(a, b) _mm_movemask_ps(_mm_cmple_ps(a, b))
+#else
+#define LANES 1
+#endif
+
+#endif
@@ -0,0 +1,236 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// The wrappers call the real entry points
+#undef GLR_STATS_WRAP
+#include "glr.h"
+
+static GlrStats currentFrame = {0};
+static GlrStats lastFrame = {0};
+static GlrStats total = {0};
+static GLuint64 frames = 0;
+static GLuint lastProgram = 0;
+
+static GLuint64 countTriangles(GLenum mode, GLsizei count)
+{
+  switch (mode)
+  {
+  case GL_TRIANGLES:
+    return count / 3;
+  case GL_TRIANGLE_STRIP:
+  case GL_TRIANGLE_FAN:
+    return count > 2 ? count - 2 : 0;
+  default:
+    return 0;
+  }
+}
+
+static GLuint64 countPixelBytes(GLenum format, GLenum type)
+{
+  GLuint64 channels = 4;
+  switch (format)
+  {
+  case GL_RED:
+  case GL_DEPTH_COMPONENT:
+    channels = 1;
+    break;
+  case GL_RG:
+    channels = 2;
+    break;
+  case GL_RGB:
+    channels = 3;
+    break;
+  }
+  return type == GL_FLOAT ? channels * sizeof(GLfloat) : channels;
+}
+
+static void countUniform(GLuint64 bytes)
+{
+  ++currentFrame.uniformCalls;
+  currentFrame.uniformBytes += bytes;
+}
+
+GlrStats *glrStats()
+{
+  return &currentFrame;
+}
+
+const GlrStats *glrStatsLastFrame()
+{
+  return &lastFrame;
+}
+
+const GlrStats *glrStatsTotal()
+{
+  return &total;
+}
+
+GLuint64 glrStatsFrames()
+{
+  return frames;
+}
+
+void glrStatsCountDraw(GLenum mode, GLsizei count)
+{
+  ++currentFrame.drawCalls;
+  currentFrame.triangles += countTriangles(mode, count);
+}
+
+void glrStatsEndFrame()
+{
+  total.drawCalls += currentFrame.drawCalls;
+  total.triangles += currentFrame.triangles;
+  total.programSwitches += currentFrame.programSwitches;
+  total.vaoBinds += currentFrame.vaoBinds;
+  total.textureBinds += currentFrame.textureBinds;
+  total.framebufferBinds += currentFrame.framebufferBinds;
+  total.uniformCalls += currentFrame.uniformCalls;
+  total.uniformBytes += currentFrame.uniformBytes;
+  total.uploadBytes += currentFrame.uploadBytes;
+  ++frames;
+
+  lastFrame = currentFrame;
+  memset(&currentFrame, 0, sizeof(GlrStats));
+}
+
+void glrStatsDump()
+{
+  const char *env = getenv("GLR_STATS");
+  if (env == NULL || env[0] == '\0' || strcmp(env, "0") == 0)
+  {
+    return;
+  }
+
+  // Loading before the first swap counts towards the first frame. The total includes the unfinished frame.
+  double perFrame = frames > 0 ? 1.0 / frames : 0.0;
+  fprintf(stderr, "%-16s %12s %16s %16s\n", "glr stats", "last frame", "per frame", "total");
+#define GLR_STATS_DUMP_ROW(field)                                                                                      \
+  fprintf(stderr, "%-16s %12llu %16.1f %16llu\n", #field, (unsigned long long)lastFrame.field, total.field * perFrame, \
+          (unsigned long long)(total.field + currentFrame.field))
+  GLR_STATS_DUMP_ROW(drawCalls);
+  GLR_STATS_DUMP_ROW(triangles);
+  GLR_STATS_DUMP_ROW(programSwitches);
+  GLR_STATS_DUMP_ROW(vaoBinds);
+  GLR_STATS_DUMP_ROW(textureBinds);
+  GLR_STATS_DUMP_ROW(framebufferBinds);
+  GLR_STATS_DUMP_ROW(uniformCalls);
+  GLR_STATS_DUMP_ROW(uniformBytes);
+  GLR_STATS_DUMP_ROW(uploadBytes);
+#undef GLR_STATS_DUMP_ROW
+  fprintf(stderr, "%-16s %12llu\n", "frames", (unsigned long long)frames);
+
+  const GlrFrameTiming *timing = glrFrameTiming();
+  fprintf(stderr, "%-16s %12.2f\n", "frameTimeMs", timing->frameTime * 1000.0);
+  fprintf(stderr, "%-16s %12.2f %16.2f\n", "latencyMs", timing->latency * 1000.0, timing->latencyMean * 1000.0);
+  fprintf(stderr, "%-16s %12.2f\n", "latencyMaxMs", timing->latencyMax * 1000.0);
+}
+
+void GLAPIENTRY glrStatsDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+  glrStatsCountDraw(mode, count);
+  glDrawArrays(mode, first, count);
+}
+
+void GLAPIENTRY glrStatsDrawElements(GLenum mode, GLsizei count, GLenum type, const void *indices)
+{
+  glrStatsCountDraw(mode, count);
+  glDrawElements(mode, count, type, indices);
+}
+
+void GLAPIENTRY glrStatsUseProgram(GLuint program)
+{
+  if (program != lastProgram)
+  {
+    ++currentFrame.programSwitches;
+    lastProgram = program;
+  }
+  glUseProgram(program);
+}
+
+void GLAPIENTRY glrStatsBindVertexArray(GLuint array)
+{
+  ++currentFrame.vaoBinds;
+  glBindVertexArray(array);
+}
+
+void GLAPIENTRY glrStatsBindTexture(GLenum target, GLuint texture)
+{
+  ++currentFrame.textureBinds;
+  glBindTexture(target, texture);
+}
+
+void GLAPIENTRY glrStatsBindFramebuffer(GLenum target, GLuint framebuffer)
+{
+  if (target != GL_READ_FRAMEBUFFER)
+  {
+    ++currentFrame.framebufferBinds;
+  }
+  glBindFramebuffer(target, framebuffer);
+}
+
+void GLAPIENTRY glrStatsUniform1i(GLint location, GLint v0)
+{
+  countUniform(sizeof(GLint));
+  glUniform1i(location, v0);
+}
+
+void GLAPIENTRY glrStatsUniform1f(GLint location, GLfloat v0)
+{
+  countUniform(sizeof(GLfloat));
+  glUniform1f(location, v0);
+}
+
+void GLAPIENTRY glrStatsUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2)
+{
+  countUniform(sizeof(GLfloat) * 3);
+  glUniform3f(location, v0, v1, v2);
+}
+
+void GLAPIENTRY glrStatsUniform3fv(GLint location, GLsizei count, const GLfloat *value)
+{
+  countUniform(sizeof(GLfloat) * 3 * count);
+  glUniform3fv(location, count, value);
+}
+
+void GLAPIENTRY glrStatsUniform4fv(GLint location, GLsizei count, const GLfloat *value)
+{
+  countUniform(sizeof(GLfloat) * 4 * count);
+  glUniform4fv(location, count, value);
+}
+
+void GLAPIENTRY glrStatsUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
+{
+  countUniform(sizeof(GLfloat) * 9 * count);
+  glUniformMatrix3fv(location, count, transpose, value);
+}
+
+void GLAPIENTRY glrStatsUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
+{
+  countUniform(sizeof(GLfloat) * 16 * count);
+  glUniformMatrix4fv(location, count, transpose, value);
+}
+
+void GLAPIENTRY glrStatsBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage)
+{
+  if (data != NULL)
+  {
+    currentFrame.uploadBytes += size;
+  }
+  glBufferData(target, size, data, usage);
+}
+
+void GLAPIENTRY glrStatsBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data)
+{
+  currentFrame.uploadBytes += size;
+  glBufferSubData(target, offset, size, data);
+}
+
+void GLAPIENTRY glrStatsTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels)
+{
+  if (pixels != NULL)
+  {
+    currentFrame.uploadBytes += countPixelBytes(format, type) * width * height;
+  }
+  glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+}
@@ -2,5 +2,14 @@
 
 void glrTeardown(GLFWwindow *window)
 {
+  glrUnwatchAll();
+  glrProfilerShutdown();
+  glrStatsDump();
+  glrMemoryDump();
+  glrMemoryShutdown();
+  glrModelShutdown();
+  glrInputShutdown();
+  glrFrameShutdown();
+  glrThreadsShutdown();
   glfwTerminate();
 }
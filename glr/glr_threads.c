@@ -0,0 +1,204 @@
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "glr.h"
+
+#define MAX_THREADS 64
+
+typedef struct GlrThreadPool
+{
+  int isInitialized;
+  int threadsLen;
+  pthread_t threads[MAX_THREADS];
+
+  // Serializes glrParallelFor calls from different threads
+  pthread_mutex_t callMutex;
+  pthread_mutex_t mutex;
+  pthread_cond_t workCond;
+  pthread_cond_t doneCond;
+
+  GlrParallelForCallback callback;
+  void *ctx;
+  GLuint count;
+  GLuint grain;
+  atomic_uint next;
+  // Incremented for every job, so each worker joins a job once
+  GLuint64 generation;
+  int workersActive;
+  int isQuitting;
+} GlrThreadPool;
+
+static GlrThreadPool pool = {0};
+static pthread_mutex_t initMutex = PTHREAD_MUTEX_INITIALIZER;
+// Whether this thread is running chunks of a job, a nested job would wait on callMutex forever.
+static _Thread_local int isInJob = 0;
+
+static void runChunks()
+{
+  for (;;)
+  {
+    GLuint begin = atomic_fetch_add(&pool.next, pool.grain);
+    if (begin >= pool.count)
+    {
+      return;
+    }
+    GLuint end = pool.count - begin < pool.grain ? pool.count : begin + pool.grain;
+    isInJob = 1;
+    pool.callback(begin, end, pool.ctx);
+    isInJob = 0;
+  }
+}
+
+static void *worker(void *arg)
+{
+  GLuint64 generation = 0;
+
+  pthread_mutex_lock(&pool.mutex);
+  for (;;)
+  {
+    while (pool.generation == generation && !pool.isQuitting)
+    {
+      pthread_cond_wait(&pool.workCond, &pool.mutex);
+    }
+    if (pool.isQuitting)
+    {
+      break;
+    }
+    generation = pool.generation;
+    pthread_mutex_unlock(&pool.mutex);
+
+    runChunks();
+
+    pthread_mutex_lock(&pool.mutex);
+    if (--pool.workersActive == 0)
+    {
+      pthread_cond_signal(&pool.doneCond);
+    }
+  }
+  pthread_mutex_unlock(&pool.mutex);
+  return NULL;
+}
+
+static int countThreads()
+{
+  const char *env = getenv("GLR_THREADS");
+  if (env != NULL && atoi(env) > 0)
+  {
+    return atoi(env);
+  }
+#ifdef _SC_NPROCESSORS_ONLN
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  return cpus > 0 ? (int)cpus : 1;
+#else
+  return 1;
+#endif
+}
+
+static void initPool()
+{
+  pthread_mutex_init(&pool.callMutex, NULL);
+  pthread_mutex_init(&pool.mutex, NULL);
+  pthread_cond_init(&pool.workCond, NULL);
+  pthread_cond_init(&pool.doneCond, NULL);
+
+  // The calling thread works too
+  int threadsLen = countThreads() - 1;
+  if (threadsLen > MAX_THREADS)
+  {
+    threadsLen = MAX_THREADS;
+  }
+  for (int i = 0; i < threadsLen; ++i)
+  {
+    if (pthread_create(&pool.threads[pool.threadsLen], NULL, worker, NULL) == 0)
+    {
+      ++pool.threadsLen;
+    }
+  }
+}
+
+static void ensurePool()
+{
+  pthread_mutex_lock(&initMutex);
+  if (!pool.isInitialized)
+  {
+    initPool();
+    pool.isInitialized = 1;
+  }
+  pthread_mutex_unlock(&initMutex);
+}
+
+int glrThreadCount()
+{
+  ensurePool();
+  return pool.threadsLen + 1;
+}
+
+void glrParallelFor(GLuint count, GLuint grain, GlrParallelForCallback callback, void *ctx)
+{
+  if (grain == 0)
+  {
+    grain = 1;
+  }
+  ensurePool();
+  // A call from inside a chunk runs inline, the pool is busy with the outer job.
+  if (count <= grain || pool.threadsLen == 0 || isInJob)
+  {
+    for (GLuint begin = 0; begin < count; begin += grain)
+    {
+      callback(begin, count - begin < grain ? count : begin + grain, ctx);
+    }
+    return;
+  }
+
+  pthread_mutex_lock(&pool.callMutex);
+
+  pthread_mutex_lock(&pool.mutex);
+  pool.callback = callback;
+  pool.ctx = ctx;
+  pool.count = count;
+  pool.grain = grain;
+  atomic_store(&pool.next, 0);
+  pool.workersActive = pool.threadsLen;
+  ++pool.generation;
+  pthread_cond_broadcast(&pool.workCond);
+  pthread_mutex_unlock(&pool.mutex);
+
+  runChunks();
+
+  pthread_mutex_lock(&pool.mutex);
+  while (pool.workersActive > 0)
+  {
+    pthread_cond_wait(&pool.doneCond, &pool.mutex);
+  }
+  pthread_mutex_unlock(&pool.mutex);
+
+  pthread_mutex_unlock(&pool.callMutex);
+}
+
+void glrThreadsShutdown()
+{
+  pthread_mutex_lock(&initMutex);
+  if (!pool.isInitialized)
+  {
+    pthread_mutex_unlock(&initMutex);
+    return;
+  }
+
+  pthread_mutex_lock(&pool.mutex);
+  pool.isQuitting = 1;
+  pthread_cond_broadcast(&pool.workCond);
+  pthread_mutex_unlock(&pool.mutex);
+  for (int i = 0; i < pool.threadsLen; ++i)
+  {
+    pthread_join(pool.threads[i], NULL);
+  }
+
+  pthread_cond_destroy(&pool.doneCond);
+  pthread_cond_destroy(&pool.workCond);
+  pthread_mutex_destroy(&pool.mutex);
+  pthread_mutex_destroy(&pool.callMutex);
+  pool = (GlrThreadPool){0};
+  pthread_mutex_unlock(&initMutex);
+}
@@ -0,0 +1,246 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define GLR_TRANSFORM_SSE
+#endif
+
+#include "glr.h"
+
+// Objects per SIMD batch, the arrays are padded to a multiple of it.
+#define LANES 4
+
+static const float IDENTITY_POSITION[3] = {0.0f, 0.0f, 0.0f};
+static const float IDENTITY_ROTATION[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+static const float IDENTITY_SCALE[3] = {1.0f, 1.0f, 1.0f};
+
+static void *growArray(void *array, size_t elementSize, GLuint oldCap, GLuint newCap)
+{
+  array = realloc(array, elementSize * newCap);
+  memset((char *)array + elementSize * oldCap, 0, elementSize * (newCap - oldCap));
+  return array;
+}
+
+static void reserve(GlrTransforms *transforms, GLuint len)
+{
+  if (len <= transforms->cap)
+  {
+    return;
+  }
+
+  GLuint cap = transforms->cap == 0 ? 64 : transforms->cap * 2;
+  if (cap < len)
+  {
+    cap = (len + LANES - 1) / LANES * LANES;
+  }
+  for (int i = 0; i < 3; ++i)
+  {
+    transforms->position[i] = (float *)growArray(transforms->position[i], sizeof(float), transforms->cap, cap);
+    transforms->scale[i] = (float *)growArray(transforms->scale[i], sizeof(float), transforms->cap, cap);
+  }
+  for (int i = 0; i < 4; ++i)
+  {
+    transforms->rotation[i] = (float *)growArray(transforms->rotation[i], sizeof(float), transforms->cap, cap);
+  }
+  transforms->isDirty = (unsigned char *)growArray(transforms->isDirty, 1, transforms->cap, cap);
+  transforms->world = (float *)growArray(transforms->world, sizeof(float) * 16, transforms->cap, cap);
+  transforms->normal = (float *)growArray(transforms->normal, sizeof(float) * 9, transforms->cap, cap);
+  transforms->cap = cap;
+}
+
+// World matrix T * R * S and normal matrix R * S^-1 of one object. With a unit quaternion R is orthonormal, so
+// R * S^-1 is the inverse transpose of the upper 3x3 of the world matrix.
+static void updateOne(GlrTransforms *transforms, GLuint i)
+{
+  float x = transforms->rotation[0][i], y = transforms->rotation[1][i];
+  float z = transforms->rotation[2][i], w = transforms->rotation[3][i];
+  float r[9] = {
+      1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w),
+      2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w),
+      2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y)};
+
+  float *world = &transforms->world[i * 16];
+  float *normal = &transforms->normal[i * 9];
+  for (int col = 0; col < 3; ++col)
+  {
+    float s = transforms->scale[col][i];
+    float invS = s != 0.0f ? 1.0f / s : 0.0f;
+    for (int row = 0; row < 3; ++row)
+    {
+      world[col * 4 + row] = r[col * 3 + row] * s;
+      normal[col * 3 + row] = r[col * 3 + row] * invS;
+    }
+    world[col * 4 + 3] = 0.0f;
+    world[12 + col] = transforms->position[col][i];
+  }
+  world[15] = 1.0f;
+}
+
+#ifdef GLR_TRANSFORM_SSE
+// The same as updateOne for LANES consecutive objects, one object per lane.
+static void updateBatch(GlrTransforms *transforms, GLuint first)
+{
+  const __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f), zero = _mm_setzero_ps();
+  __m128 x = _mm_loadu_ps(&transforms->rotation[0][first]);
+  __m128 y = _mm_loadu_ps(&transforms->rotation[1][first]);
+  __m128 z = _mm_loadu_ps(&transforms->rotation[2][first]);
+  __m128 w = _mm_loadu_ps(&transforms->rotation[3][first]);
+
+  __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+  __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+  __m128 xw = _mm_mul_ps(x, w), yw = _mm_mul_ps(y, w), zw = _mm_mul_ps(z, w);
+  __m128 r[9] = {
+      _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))),
+      _mm_mul_ps(two, _mm_add_ps(xy, zw)),
+      _mm_mul_ps(two, _mm_sub_ps(xz, yw)),
+      _mm_mul_ps(two, _mm_sub_ps(xy, zw)),
+      _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))),
+      _mm_mul_ps(two, _mm_add_ps(yz, xw)),
+      _mm_mul_ps(two, _mm_add_ps(xz, yw)),
+      _mm_mul_ps(two, _mm_sub_ps(yz, xw)),
+      _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)))};
+
+  // Entry e of the matrices of all lanes
+  __m128 world[16];
+  __m128 normal[9];
+  for (int col = 0; col < 3; ++col)
+  {
+    __m128 s = _mm_loadu_ps(&transforms->scale[col][first]);
+    __m128 invS = _mm_and_ps(_mm_div_ps(one, s), _mm_cmpneq_ps(s, zero));
+    for (int row = 0; row < 3; ++row)
+    {
+      world[col * 4 + row] = _mm_mul_ps(r[col * 3 + row], s);
+      normal[col * 3 + row] = _mm_mul_ps(r[col * 3 + row], invS);
+    }
+    world[col * 4 + 3] = zero;
+    world[12 + col] = _mm_loadu_ps(&transforms->position[col][first]);
+  }
+  world[15] = one;
+
+  // Transposing each column of 4 entries x 4 lanes yields that column of each lane's matrix.
+  for (int col = 0; col < 4; ++col)
+  {
+    _MM_TRANSPOSE4_PS(world[col * 4], world[col * 4 + 1], world[col * 4 + 2], world[col * 4 + 3]);
+    for (int lane = 0; lane < LANES; ++lane)
+    {
+      _mm_storeu_ps(&transforms->world[(first + lane) * 16 + col * 4], world[col * 4 + lane]);
+    }
+  }
+
+  float entries[9][LANES];
+  for (int e = 0; e < 9; ++e)
+  {
+    _mm_storeu_ps(entries[e], normal[e]);
+  }
+  for (int lane = 0; lane < LANES; ++lane)
+  {
+    float *dst = &transforms->normal[(first + lane) * 9];
+    for (int e = 0; e < 9; ++e)
+    {
+      dst[e] = entries[e][lane];
+    }
+  }
+}
+#endif
+
+GlrTransforms *glrCreateTransforms()
+{
+  return (GlrTransforms *)calloc(1, sizeof(GlrTransforms));
+}
+
+GLuint glrAddTransform(GlrTransforms *transforms, const float position[3], const float rotation[4], const float scale[3])
+{
+  reserve(transforms, transforms->len + 1);
+  GLuint index = transforms->len++;
+  glrSetTransform(
+      transforms,
+      index,
+      position != NULL ? position : IDENTITY_POSITION,
+      rotation != NULL ? rotation : IDENTITY_ROTATION,
+      scale != NULL ? scale : IDENTITY_SCALE);
+  return index;
+}
+
+void glrSetTransform(GlrTransforms *transforms, GLuint index, const float position[3], const float rotation[4], const float scale[3])
+{
+  for (int i = 0; i < 3; ++i)
+  {
+    if (position != NULL)
+    {
+      transforms->position[i][index] = position[i];
+    }
+    if (scale != NULL)
+    {
+      transforms->scale[i][index] = scale[i];
+    }
+  }
+  if (rotation != NULL)
+  {
+    for (int i = 0; i < 4; ++i)
+    {
+      transforms->rotation[i][index] = rotation[i];
+    }
+  }
+  transforms->isDirty[index] = 1;
+}
+
+GLuint glrUpdateTransforms(GlrTransforms *transforms)
+{
+  GLuint updated = 0;
+  GLuint i = 0;
+
+#ifdef GLR_TRANSFORM_SSE
+  // Batches with any dirty object are updated as a whole, the arrays are padded so the last batch is complete.
+  for (; i + LANES <= transforms->cap && i < transforms->len; i += LANES)
+  {
+    uint32_t isDirty;
+    memcpy(&isDirty, &transforms->isDirty[i], sizeof(uint32_t));
+    if (isDirty != 0)
+    {
+      updateBatch(transforms, i);
+      memset(&transforms->isDirty[i], 0, LANES);
+      updated += transforms->len - i < LANES ? transforms->len - i : LANES;
+    }
+  }
+#endif
+
+  for (; i < transforms->len; ++i)
+  {
+    if (transforms->isDirty[i])
+    {
+      updateOne(transforms, i);
+      transforms->isDirty[i] = 0;
+      ++updated;
+    }
+  }
+
+  return updated;
+}
+
+const float *glrTransformWorld(const GlrTransforms *transforms, GLuint index)
+{
+  return &transforms->world[index * 16];
+}
+
+const float *glrTransformNormal(const GlrTransforms *transforms, GLuint index)
+{
+  return &transforms->normal[index * 9];
+}
+
+void glrFreeTransforms(GlrTransforms *transforms)
+{
+  for (int i = 0; i < 3; ++i)
+  {
+    free(transforms->position[i]);
+    free(transforms->scale[i]);
+  }
+  for (int i = 0; i < 4; ++i)
+  {
+    free(transforms->rotation[i]);
+  }
+  free(transforms->isDirty);
+  free(transforms->world);
+  free(transforms->normal);
+  free(transforms);
+}
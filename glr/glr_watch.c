@@ -0,0 +1,324 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "glr.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+typedef struct GlrWatchedShader
+{
+  GLenum type;
+  char *filename;
+  // Index of the watched directory in watchedDirs
+  int dirIndex;
+  // Pointer to the basename inside filename
+  const char *basename;
+} GlrWatchedShader;
+
+typedef struct GlrWatchedProgram
+{
+  GLuint program;
+  GlrWatchedShader *shaders;
+  GLsizei shadersLen;
+  GlrProgramReloadCallback onReload;
+  void *ctx;
+  // Set when any shader file changed since the last poll
+  int isDirty;
+} GlrWatchedProgram;
+
+typedef struct GlrWatchedDir
+{
+  int wd;
+  char *path;
+} GlrWatchedDir;
+
+static int inotifyFd = -1;
+static GlrWatchedDir *watchedDirs = NULL;
+static GLsizei watchedDirsLen = 0;
+static GlrWatchedProgram *watchedPrograms = NULL;
+static GLsizei watchedProgramsLen = 0;
+
+static char *strDup(const char *str, size_t len)
+{
+  char *copy = (char *)malloc(len + 1);
+  memcpy(copy, str, len);
+  copy[len] = '\0';
+  return copy;
+}
+
+static char *resolveWatchedFile(const char *filename)
+{
+#if defined(__linux__) && defined(GLR_SOURCE_ASSETS_DIR)
+  // Assets are copied next to the binary, prefer the source copy so editing assets/shaders takes effect directly.
+  if (filename[0] != '/')
+  {
+    size_t dirLen = strlen(GLR_SOURCE_ASSETS_DIR);
+    size_t filenameLen = strlen(filename);
+    char *sourceFile = (char *)malloc(dirLen + filenameLen + 1);
+    memcpy(sourceFile, GLR_SOURCE_ASSETS_DIR, dirLen);
+    memcpy(sourceFile + dirLen, filename, filenameLen + 1);
+    if (access(sourceFile, R_OK) == 0)
+    {
+      return sourceFile;
+    }
+    free(sourceFile);
+  }
+#endif
+  return strDup(filename, strlen(filename));
+}
+
+static const char *findBasename(const char *filename)
+{
+  const char *slash = strrchr(filename, '/');
+  return slash == NULL ? filename : slash + 1;
+}
+
+#ifdef __linux__
+static int watchDir(const char *filename, const char *basename)
+{
+  // Watch the directory instead of the file, because editors often save by renaming a new file over the old one.
+  size_t dirLen = basename - filename;
+  char *path = dirLen == 0 ? strDup(".", 1) : strDup(filename, dirLen);
+
+  for (GLsizei i = 0; i < watchedDirsLen; ++i)
+  {
+    if (strcmp(watchedDirs[i].path, path) == 0)
+    {
+      free(path);
+      return i;
+    }
+  }
+
+  int wd = inotify_add_watch(inotifyFd, path, IN_CLOSE_WRITE | IN_MOVED_TO);
+  if (wd < 0)
+  {
+    free(path);
+    return -1;
+  }
+
+  watchedDirs = (GlrWatchedDir *)realloc(watchedDirs, sizeof(GlrWatchedDir) * (watchedDirsLen + 1));
+  watchedDirs[watchedDirsLen].wd = wd;
+  watchedDirs[watchedDirsLen].path = path;
+  return watchedDirsLen++;
+}
+
+static void markDirty(int wd, const char *name)
+{
+  for (GLsizei i = 0; i < watchedProgramsLen; ++i)
+  {
+    GlrWatchedProgram *watched = &watchedPrograms[i];
+    for (GLsizei j = 0; j < watched->shadersLen; ++j)
+    {
+      GlrWatchedShader *shader = &watched->shaders[j];
+      if (watchedDirs[shader->dirIndex].wd == wd && strcmp(shader->basename, name) == 0)
+      {
+        watched->isDirty = 1;
+      }
+    }
+  }
+}
+
+static void drainEvents()
+{
+  char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+  for (;;)
+  {
+    ssize_t len = read(inotifyFd, buffer, sizeof(buffer));
+    if (len <= 0)
+    {
+      // EAGAIN: no more events
+      return;
+    }
+
+    for (char *ptr = buffer; ptr < buffer + len;)
+    {
+      const struct inotify_event *event = (const struct inotify_event *)ptr;
+      if (event->len > 0)
+      {
+        markDirty(event->wd, event->name);
+      }
+      ptr += sizeof(struct inotify_event) + event->len;
+    }
+  }
+}
+#endif
+
+static const GLchar *rebuildProgram(GlrWatchedProgram *watched)
+{
+  GLuint *shaders = (GLuint *)malloc(sizeof(GLuint) * watched->shadersLen);
+  const GLchar *error = NULL;
+  GLsizei compiledLen = 0;
+
+  for (; compiledLen < watched->shadersLen; ++compiledLen)
+  {
+    GlrWatchedShader *file = &watched->shaders[compiledLen];
+    shaders[compiledLen] = glCreateShader(file->type);
+    error = glrShaderSourceFromFile(shaders[compiledLen], file->filename);
+    if (error != NULL)
+    {
+      // glrShaderSourceFromFile only deletes the shader on compiling errors
+      if (glIsShader(shaders[compiledLen]))
+      {
+        glDeleteShader(shaders[compiledLen]);
+      }
+      break;
+    }
+  }
+
+  if (error == NULL)
+  {
+    // Link a scratch program first, so a link error keeps the old program usable.
+    GLuint scratch = glCreateProgram();
+    for (GLsizei i = 0; i < watched->shadersLen; ++i)
+    {
+      glAttachShader(scratch, shaders[i]);
+    }
+    error = glrLinkProgram(scratch);
+    if (error == NULL)
+    {
+      glDeleteProgram(scratch);
+
+      GLuint attached[16];
+      GLsizei attachedLen = 0;
+      glGetAttachedShaders(watched->program, sizeof(attached) / sizeof(GLuint), &attachedLen, attached);
+      for (GLsizei i = 0; i < attachedLen; ++i)
+      {
+        glDetachShader(watched->program, attached[i]);
+      }
+      for (GLsizei i = 0; i < watched->shadersLen; ++i)
+      {
+        glAttachShader(watched->program, shaders[i]);
+      }
+      glLinkProgram(watched->program);
+    }
+  }
+
+  for (GLsizei i = 0; i < compiledLen; ++i)
+  {
+    glDeleteShader(shaders[i]);
+  }
+  free(shaders);
+
+  return error;
+}
+
+int glrWatchProgram(GLuint program, const GlrShaderFile *files, GLsizei len, GlrProgramReloadCallback onReload, void *ctx)
+{
+#ifdef __linux__
+  if (inotifyFd < 0)
+  {
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0)
+    {
+      return -1;
+    }
+  }
+
+  GlrWatchedShader *shaders = (GlrWatchedShader *)malloc(sizeof(GlrWatchedShader) * len);
+  for (GLsizei i = 0; i < len; ++i)
+  {
+    shaders[i].type = files[i].type;
+    shaders[i].filename = resolveWatchedFile(files[i].filename);
+    shaders[i].basename = findBasename(shaders[i].filename);
+    shaders[i].dirIndex = watchDir(shaders[i].filename, shaders[i].basename);
+    if (shaders[i].dirIndex < 0)
+    {
+      for (GLsizei j = 0; j <= i; ++j)
+      {
+        free(shaders[j].filename);
+      }
+      free(shaders);
+      return -1;
+    }
+  }
+
+  watchedPrograms = (GlrWatchedProgram *)realloc(watchedPrograms, sizeof(GlrWatchedProgram) * (watchedProgramsLen + 1));
+  GlrWatchedProgram *watched = &watchedPrograms[watchedProgramsLen++];
+  watched->program = program;
+  watched->shaders = shaders;
+  watched->shadersLen = len;
+  watched->onReload = onReload;
+  watched->ctx = ctx;
+  watched->isDirty = 0;
+  return 0;
+#else
+  return -1;
+#endif
+}
+
+GLsizei glrPollShaderChanges()
+{
+  GLsizei reloaded = 0;
+
+#ifdef __linux__
+  if (inotifyFd < 0)
+  {
+    return 0;
+  }
+
+  drainEvents();
+
+  for (GLsizei i = 0; i < watchedProgramsLen; ++i)
+  {
+    GlrWatchedProgram *watched = &watchedPrograms[i];
+    if (!watched->isDirty)
+    {
+      continue;
+    }
+    watched->isDirty = 0;
+
+    const GLchar *error = rebuildProgram(watched);
+    if (error == NULL)
+    {
+      ++reloaded;
+    }
+    if (watched->onReload != NULL)
+    {
+      watched->onReload(watched->program, error, watched->ctx);
+    }
+    else if (error != NULL)
+    {
+      fprintf(stderr, "Reloading program %u: %s\n", watched->program, error);
+    }
+    free((void *)error);
+  }
+#endif
+
+  return reloaded;
+}
+
+void glrUnwatchAll()
+{
+  for (GLsizei i = 0; i < watchedProgramsLen; ++i)
+  {
+    for (GLsizei j = 0; j < watchedPrograms[i].shadersLen; ++j)
+    {
+      free(watchedPrograms[i].shaders[j].filename);
+    }
+    free(watchedPrograms[i].shaders);
+  }
+  free(watchedPrograms);
+  watchedPrograms = NULL;
+  watchedProgramsLen = 0;
+
+  for (GLsizei i = 0; i < watchedDirsLen; ++i)
+  {
+    free(watchedDirs[i].path);
+  }
+  free(watchedDirs);
+  watchedDirs = NULL;
+  watchedDirsLen = 0;
+
+#ifdef __linux__
+  if (inotifyFd >= 0)
+  {
+    close(inotifyFd);
+    inotifyFd = -1;
+  }
+#endif
+}
@@ -84,19 +84,19 @@ void processInput(GLFWwindow *window, float deltaTime, Camera *camera)
   vec3 right;
   glm_vec3_cross(front, (vec3){0.0f, 1.0f, 0.0f}, right);
 
-  if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
   {
     glm_vec3_scale(front, cameraSpeed, translation);
   }
-  if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
   {
     glm_vec3_scale(front, -cameraSpeed, translation);
   }
-  if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
   {
     glm_vec3_scale(right, -cameraSpeed, translation);
   }
-  if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
   {
     glm_vec3_scale(right, cameraSpeed, translation);
   }
@@ -220,8 +220,8 @@ int main(int argc, char *argv[])
 
   glEnable(GL_DEPTH_TEST);
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-  glfwSetCursorPosCallback(window, cursorPosCallback);
-  glfwSetScrollCallback(window, scrollCallback);
+  glrSetCursorPosCallback(window, cursorPosCallback);
+  glrSetScrollCallback(window, scrollCallback);
 
   mat4 model, view, projection;
 
@@ -229,7 +229,7 @@ int main(int argc, char *argv[])
   GLuint viewLocation = glGetUniformLocation(program, "view");
   GLuint projectionLocation = glGetUniformLocation(program, "projection");
 
-  float lastFrame = glfwGetTime();
+  double lastFrame = glrGetTime();
   /* Loop until the user closes the window */
   while (!glfwWindowShouldClose(window))
   {
@@ -237,10 +237,11 @@ int main(int argc, char *argv[])
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    float currentFrame = glfwGetTime();
-    float deltaTime = currentFrame - lastFrame;
+    double currentFrame = glrGetTime();
+    float deltaTime = (float)(currentFrame - lastFrame);
     lastFrame = currentFrame;
     processInput(window, deltaTime, &state.camera);
+    glrBenchmarkCamera(state.camera.position, state.camera.front);
 
     glUseProgram(program);
     glBindVertexArray(VAO);
@@ -263,10 +264,10 @@ int main(int argc, char *argv[])
     }
 
     /* Swap front and back buffers */
-    glfwSwapBuffers(window);
+    glrSwapBuffers(window);
 
     /* Poll for and process events */
-    glfwPollEvents();
+    glrPollEvents(window);
   }
 
   glrTeardown(window);
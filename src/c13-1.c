@@ -16,7 +16,22 @@ typedef struct State
 {
   Camera camera;
   vec3 lightPos;
+  mat4 view;
+  mat4 projection;
 } State;
+typedef struct Renderer
+{
+  GLuint programs[2];
+  GLuint VAOs[2];
+  GLuint modelLocations[2];
+  GLuint viewLocations[2];
+  GLuint projectionLocations[2];
+  GLuint transposedInverseModelLocation;
+  GLuint lightPosLocation;
+  GLuint viewPosLocation;
+} Renderer;
+
+static const int LIGHT_ID = 0, OBJECT_ID = 1;
 
 static void ensureNoErrorMessage(const GLchar *prompt, const GLchar *message)
 {
@@ -41,9 +56,9 @@ void processInput(GLFWwindow *window, float deltaTime, Camera *camera)
   glm_vec3_normalize(up);
   glm_vec3_cross(front, (vec3){0.0f, 1.0f, 0.0f}, right);
 
-  if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
   {
-    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+    if (glrGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
     {
       glm_vec3_scale(up, cameraSpeed, translation);
     }
@@ -52,9 +67,9 @@ void processInput(GLFWwindow *window, float deltaTime, Camera *camera)
       glm_vec3_scale(front, cameraSpeed, translation);
     }
   }
-  if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
   {
-    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+    if (glrGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
     {
       glm_vec3_scale(up, -cameraSpeed, translation);
     }
@@ -63,11 +78,11 @@ void processInput(GLFWwindow *window, float deltaTime, Camera *camera)
       glm_vec3_scale(front, -cameraSpeed, translation);
     }
   }
-  if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
   {
     glm_vec3_scale(right, -cameraSpeed, translation);
   }
-  if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
   {
     glm_vec3_scale(right, cameraSpeed, translation);
   }
@@ -113,6 +128,64 @@ void scrollCallback(GLFWwindow *window, double xoffset, double yoffset)
   state->camera.fov = glm_clamp(state->camera.fov + (float)yoffset, 1.0f, 45.0f);
 }
 
+// Runs on the main thread
+void simulate(GLFWwindow *window, void *statePtr, float deltaTime)
+{
+  State *state = (State *)statePtr;
+  processInput(window, deltaTime, &state->camera);
+  glrBenchmarkCamera(state->camera.position, state->camera.front);
+
+  // Rotate the light
+  glm_vec3_rotate(state->lightPos, deltaTime * 0.8f, (vec3){0.0f, 1.0f, 0.0f});
+
+  vec3 cameraTarget;
+  glm_vec3_add(state->camera.position, state->camera.front, cameraTarget);
+  glm_lookat(state->camera.position, cameraTarget, state->camera.up, state->view);
+
+  glm_perspective(glm_rad(state->camera.fov), 800.0f / 600.0f, 0.1f, 100.0f, state->projection);
+}
+
+// Runs on the render thread
+void render(GLFWwindow *window, const void *snapshot, void *rendererPtr)
+{
+  const State *state = (const State *)snapshot;
+  Renderer *renderer = (Renderer *)rendererPtr;
+
+  glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+  glUseProgram(renderer->programs[OBJECT_ID]);
+  glBindVertexArray(renderer->VAOs[OBJECT_ID]);
+  mat4 cubeModel;
+  glm_mat4_identity(cubeModel);
+  glUniformMatrix4fv(renderer->modelLocations[OBJECT_ID], 1, GL_FALSE, (GLfloat *)cubeModel);
+  glUniformMatrix4fv(renderer->viewLocations[OBJECT_ID], 1, GL_FALSE, (GLfloat *)state->view);
+  glUniformMatrix4fv(renderer->projectionLocations[OBJECT_ID], 1, GL_FALSE, (GLfloat *)state->projection);
+
+  glUniform3fv(renderer->lightPosLocation, 1, (GLfloat *)(state->lightPos));
+  glUniform3fv(renderer->viewPosLocation, 1, (GLfloat *)(state->camera.position));
+
+  mat4 transposedInverseModel;
+  glm_mat4_inv(cubeModel, transposedInverseModel);
+  glm_mat4_transpose(transposedInverseModel);
+  mat3 transposedInverseModelMat3;
+  glm_mat4_pick3(transposedInverseModel, transposedInverseModelMat3);
+  glUniformMatrix3fv(renderer->transposedInverseModelLocation, 1, GL_FALSE, (GLfloat *)transposedInverseModelMat3);
+
+  glDrawArrays(GL_TRIANGLES, 0, 36);
+
+  glUseProgram(renderer->programs[LIGHT_ID]);
+  glBindVertexArray(renderer->VAOs[LIGHT_ID]);
+  mat4 lightModel;
+  glm_translate_make(lightModel, (float *)state->lightPos);
+  glm_scale_uni(lightModel, 0.2f);
+
+  glUniformMatrix4fv(renderer->modelLocations[LIGHT_ID], 1, GL_FALSE, (GLfloat *)lightModel);
+  glUniformMatrix4fv(renderer->viewLocations[LIGHT_ID], 1, GL_FALSE, (GLfloat *)state->view);
+  glUniformMatrix4fv(renderer->projectionLocations[LIGHT_ID], 1, GL_FALSE, (GLfloat *)state->projection);
+  glDrawArrays(GL_TRIANGLES, 0, 36);
+}
+
 int main(int argc, char *argv[])
 {
   GlrSetupArgs setup = {.windowWidth = 800, .windowHeight = 600, .windowTitle = argv[0]};
@@ -124,8 +197,6 @@ int main(int argc, char *argv[])
     return -1;
   }
 
-  const int LIGHT_ID = 0, OBJECT_ID = 1;
-
   GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
   ensureNoErrorMessage("Compiling Vertex Shader", glrShaderSourceFromFile(vertexShader, "shaders/c13-1.vert"));
 
@@ -235,84 +306,35 @@ int main(int argc, char *argv[])
 
   glEnable(GL_DEPTH_TEST);
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-  glfwSetCursorPosCallback(window, cursorPosCallback);
-  glfwSetScrollCallback(window, scrollCallback);
-
-  mat4 view, projection;
-
-  GLuint modelLocations[2] = {
-      glGetUniformLocation(lightProgram, "model"),
-      glGetUniformLocation(objectProgram, "model")};
-  GLuint viewLocations[2] = {
-      glGetUniformLocation(lightProgram, "view"),
-      glGetUniformLocation(objectProgram, "view")};
-  GLuint projectionLocations[2] = {
-      glGetUniformLocation(lightProgram, "projection"),
-      glGetUniformLocation(objectProgram, "projection")};
-
-  GLuint transposedInverseModelLocation = glGetUniformLocation(objectProgram, "transposedInverseModel");
-  GLuint lightPosLocation = glGetUniformLocation(objectProgram, "lightPos");
-  GLuint viewPosLocation = glGetUniformLocation(objectProgram, "viewPos");
-
-  float lastFrame = glfwGetTime();
-  /* Loop until the user closes the window */
-  while (!glfwWindowShouldClose(window))
-  {
-    /* Render here */
-    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    float currentFrame = glfwGetTime();
-    float deltaTime = currentFrame - lastFrame;
-    lastFrame = currentFrame;
-    processInput(window, deltaTime, &state.camera);
-
-    // Rotate the light
-    glm_vec3_rotate(state.lightPos, deltaTime * 0.8f, (vec3){0.0f, 1.0f, 0.0f});
-
-    vec3 cameraTarget;
-    glm_vec3_add(state.camera.position, state.camera.front, cameraTarget);
-    glm_lookat(state.camera.position, cameraTarget, state.camera.up, view);
-
-    glm_perspective(glm_rad(state.camera.fov), 800.0f / 600.0f, 0.1f, 100.0f, projection);
-
-    glUseProgram(objectProgram);
-    glBindVertexArray(VAOs[OBJECT_ID]);
-    mat4 cubeModel;
-    glm_mat4_identity(cubeModel);
-    glUniformMatrix4fv(modelLocations[OBJECT_ID], 1, GL_FALSE, (GLfloat *)cubeModel);
-    glUniformMatrix4fv(viewLocations[OBJECT_ID], 1, GL_FALSE, (GLfloat *)view);
-    glUniformMatrix4fv(projectionLocations[OBJECT_ID], 1, GL_FALSE, (GLfloat *)projection);
-
-    glUniform3fv(lightPosLocation, 1, (GLfloat *)(state.lightPos));
-    glUniform3fv(viewPosLocation, 1, (GLfloat *)(state.camera.position));
-
-    mat4 transposedInverseModel;
-    glm_mat4_inv(cubeModel, transposedInverseModel);
-    glm_mat4_transpose(transposedInverseModel);
-    mat3 transposedInverseModelMat3;
-    glm_mat4_pick3(transposedInverseModel, transposedInverseModelMat3);
-    glUniformMatrix3fv(transposedInverseModelLocation, 1, GL_FALSE, (GLfloat *)transposedInverseModelMat3);
-
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-
-    glUseProgram(lightProgram);
-    glBindVertexArray(VAOs[LIGHT_ID]);
-    mat4 lightModel;
-    glm_translate_make(lightModel, state.lightPos);
-    glm_scale_uni(lightModel, 0.2f);
-
-    glUniformMatrix4fv(modelLocations[LIGHT_ID], 1, GL_FALSE, (GLfloat *)lightModel);
-    glUniformMatrix4fv(viewLocations[LIGHT_ID], 1, GL_FALSE, (GLfloat *)view);
-    glUniformMatrix4fv(projectionLocations[LIGHT_ID], 1, GL_FALSE, (GLfloat *)projection);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-
-    /* Swap front and back buffers */
-    glfwSwapBuffers(window);
-
-    /* Poll for and process events */
-    glfwPollEvents();
-  }
+  glrSetCursorPosCallback(window, cursorPosCallback);
+  glrSetScrollCallback(window, scrollCallback);
+
+  Renderer renderer = {
+      .programs = {lightProgram, objectProgram},
+      .VAOs = {VAOs[LIGHT_ID], VAOs[OBJECT_ID]},
+      .modelLocations = {
+          glGetUniformLocation(lightProgram, "model"),
+          glGetUniformLocation(objectProgram, "model")},
+      .viewLocations = {
+          glGetUniformLocation(lightProgram, "view"),
+          glGetUniformLocation(objectProgram, "view")},
+      .projectionLocations = {
+          glGetUniformLocation(lightProgram, "projection"),
+          glGetUniformLocation(objectProgram, "projection")},
+      .transposedInverseModelLocation = glGetUniformLocation(objectProgram, "transposedInverseModel"),
+      .lightPosLocation = glGetUniformLocation(objectProgram, "lightPos"),
+      .viewPosLocation = glGetUniformLocation(objectProgram, "viewPos"),
+  };
+
+  // Simulate on the main thread and render the snapshots on a render thread
+  GlrApp app = {
+      .state = &state,
+      .stateSize = sizeof(State),
+      .simulate = simulate,
+      .renderContext = &renderer,
+      .render = render,
+  };
+  ensureNoErrorMessage("Running App", glrRunApp(window, &app));
 
   glrTeardown(window);
   return 0;
@@ -41,9 +41,9 @@ void processInput(GLFWwindow *window, float deltaTime, Camera *camera)
   glm_vec3_normalize(up);
   glm_vec3_cross(front, (vec3){0.0f, 1.0f, 0.0f}, right);
 
-  if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
   {
-    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+    if (glrGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
     {
       glm_vec3_scale(up, cameraSpeed, translation);
     }
@@ -52,9 +52,9 @@ void processInput(GLFWwindow *window, float deltaTime, Camera *camera)
       glm_vec3_scale(front, cameraSpeed, translation);
     }
   }
-  if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
   {
-    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+    if (glrGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
     {
       glm_vec3_scale(up, -cameraSpeed, translation);
     }
@@ -63,11 +63,11 @@ void processInput(GLFWwindow *window, float deltaTime, Camera *camera)
       glm_vec3_scale(front, -cameraSpeed, translation);
     }
   }
-  if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
   {
     glm_vec3_scale(right, -cameraSpeed, translation);
   }
-  if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
   {
     glm_vec3_scale(right, cameraSpeed, translation);
   }
@@ -237,8 +237,8 @@ int main(int argc, char *argv[])
 
   glEnable(GL_DEPTH_TEST);
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-  glfwSetCursorPosCallback(window, cursorPosCallback);
-  glfwSetScrollCallback(window, scrollCallback);
+  glrSetCursorPosCallback(window, cursorPosCallback);
+  glrSetScrollCallback(window, scrollCallback);
 
   mat4 view, projection;
 
@@ -256,7 +256,7 @@ int main(int argc, char *argv[])
   GLuint lightPosLocation = glGetUniformLocation(objectProgram, "light.position");
   GLuint viewPosLocation = glGetUniformLocation(objectProgram, "viewPos");
 
-  float lastFrame = glfwGetTime();
+  double lastFrame = glrGetTime();
   /* Loop until the user closes the window */
   while (!glfwWindowShouldClose(window))
   {
@@ -264,10 +264,11 @@ int main(int argc, char *argv[])
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    float currentFrame = glfwGetTime();
-    float deltaTime = currentFrame - lastFrame;
+    double currentFrame = glrGetTime();
+    float deltaTime = (float)(currentFrame - lastFrame);
     lastFrame = currentFrame;
     processInput(window, deltaTime, &state.camera);
+    glrBenchmarkCamera(state.camera.position, state.camera.front);
 
     vec3 lightColor = {sin(lastFrame * 2.0f), sin(lastFrame * 0.7f), sin(lastFrame * 1.3f)};
     vec3 lightSpecular = {1.0f, 1.0f, 1.0f};
@@ -322,10 +323,10 @@ int main(int argc, char *argv[])
     glDrawArrays(GL_TRIANGLES, 0, 36);
 
     /* Swap front and back buffers */
-    glfwSwapBuffers(window);
+    glrSwapBuffers(window);
 
     /* Poll for and process events */
-    glfwPollEvents();
+    glrPollEvents(window);
   }
 
   glrTeardown(window);
@@ -54,11 +54,11 @@ void processInput(GLFWwindow *window, float deltaTime, State *state)
   Camera *camera = &(state->camera);
   const float cameraSpeed = 2.5f * deltaTime;
 
-  if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_1) == GLFW_PRESS)
   {
     state->flags ^= CHANGE_LIGHT_COLOR;
   }
-  if (glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_2) == GLFW_PRESS)
   {
     state->flags ^= INVERSE_SPECULAR_MAP;
   }
@@ -72,9 +72,9 @@ void processInput(GLFWwindow *window, float deltaTime, State *state)
   glm_vec3_normalize(up);
   glm_vec3_cross(front, (vec3){0.0f, 1.0f, 0.0f}, right);
 
-  if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
   {
-    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+    if (glrGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
     {
       glm_vec3_scale(up, cameraSpeed, translation);
     }
@@ -83,9 +83,9 @@ void processInput(GLFWwindow *window, float deltaTime, State *state)
       glm_vec3_scale(front, cameraSpeed, translation);
     }
   }
-  if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
   {
-    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+    if (glrGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
     {
       glm_vec3_scale(up, -cameraSpeed, translation);
     }
@@ -94,11 +94,11 @@ void processInput(GLFWwindow *window, float deltaTime, State *state)
       glm_vec3_scale(front, -cameraSpeed, translation);
     }
   }
-  if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
   {
     glm_vec3_scale(right, -cameraSpeed, translation);
   }
-  if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
   {
     glm_vec3_scale(right, cameraSpeed, translation);
   }
@@ -304,8 +304,8 @@ int main(int argc, char *argv[])
 
   glEnable(GL_DEPTH_TEST);
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-  glfwSetCursorPosCallback(window, cursorPosCallback);
-  glfwSetScrollCallback(window, scrollCallback);
+  glrSetCursorPosCallback(window, cursorPosCallback);
+  glrSetScrollCallback(window, scrollCallback);
 
   mat4 view, projection;
 
@@ -324,7 +324,13 @@ int main(int argc, char *argv[])
   GLuint viewPosLocation = glGetUniformLocation(objectProgram, "viewPos");
   GLuint flagsLocation = glGetUniformLocation(objectProgram, "flags");
 
-  float lastFrame = glfwGetTime();
+  // The cube is static, only the rotating lamp is recomputed every frame.
+  GlrTransforms *transforms = glrCreateTransforms();
+  // Indexed by LIGHT_ID and OBJECT_ID
+  glrAddTransform(transforms, state.lightPos, NULL, (vec3){0.2f, 0.2f, 0.2f});
+  glrAddTransform(transforms, NULL, NULL, NULL);
+
+  double lastFrame = glrGetTime();
   glfwSetInputMode(window, GLFW_STICKY_KEYS, GLFW_TRUE);
   /* Loop until the user closes the window */
   while (!glfwWindowShouldClose(window))
@@ -333,10 +339,11 @@ int main(int argc, char *argv[])
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    float currentFrame = glfwGetTime();
-    float deltaTime = currentFrame - lastFrame;
+    double currentFrame = glrGetTime();
+    float deltaTime = (float)(currentFrame - lastFrame);
     lastFrame = currentFrame;
     processInput(window, deltaTime, &state);
+    glrBenchmarkCamera(state.camera.position, state.camera.front);
 
     vec3 lightColor = {1.0f, 1.0f, 1.0f};
     if ((state.flags & CHANGE_LIGHT_COLOR) != 0)
@@ -361,9 +368,9 @@ int main(int argc, char *argv[])
 
     glUseProgram(objectProgram);
     glBindVertexArray(VAOs[OBJECT_ID]);
-    mat4 cubeModel;
-    glm_mat4_identity(cubeModel);
-    glUniformMatrix4fv(modelLocations[OBJECT_ID], 1, GL_FALSE, (GLfloat *)cubeModel);
+    glrSetTransform(transforms, LIGHT_ID, state.lightPos, NULL, NULL);
+    glrUpdateTransforms(transforms);
+    glUniformMatrix4fv(modelLocations[OBJECT_ID], 1, GL_FALSE, glrTransformWorld(transforms, OBJECT_ID));
     glUniformMatrix4fv(viewLocations[OBJECT_ID], 1, GL_FALSE, (GLfloat *)view);
     glUniformMatrix4fv(projectionLocations[OBJECT_ID], 1, GL_FALSE, (GLfloat *)projection);
 
@@ -374,22 +381,13 @@ int main(int argc, char *argv[])
     glUniform3fv(viewPosLocation, 1, (GLfloat *)(state.camera.position));
     glUniform1i(flagsLocation, state.flags);
 
-    mat4 transposedInverseModel;
-    glm_mat4_inv(cubeModel, transposedInverseModel);
-    glm_mat4_transpose(transposedInverseModel);
-    mat3 transposedInverseModelMat3;
-    glm_mat4_pick3(transposedInverseModel, transposedInverseModelMat3);
-    glUniformMatrix3fv(transposedInverseModelLocation, 1, GL_FALSE, (GLfloat *)transposedInverseModelMat3);
+    glUniformMatrix3fv(transposedInverseModelLocation, 1, GL_FALSE, glrTransformNormal(transforms, OBJECT_ID));
 
     glDrawArrays(GL_TRIANGLES, 0, 36);
 
     glUseProgram(lightProgram);
     glBindVertexArray(VAOs[LIGHT_ID]);
-    mat4 lightModel;
-    glm_translate_make(lightModel, state.lightPos);
-    glm_scale_uni(lightModel, 0.2f);
-
-    glUniformMatrix4fv(modelLocations[LIGHT_ID], 1, GL_FALSE, (GLfloat *)lightModel);
+    glUniformMatrix4fv(modelLocations[LIGHT_ID], 1, GL_FALSE, glrTransformWorld(transforms, LIGHT_ID));
     glUniformMatrix4fv(viewLocations[LIGHT_ID], 1, GL_FALSE, (GLfloat *)view);
     glUniformMatrix4fv(projectionLocations[LIGHT_ID], 1, GL_FALSE, (GLfloat *)projection);
 
@@ -398,12 +396,13 @@ int main(int argc, char *argv[])
     glDrawArrays(GL_TRIANGLES, 0, 36);
 
     /* Swap front and back buffers */
-    glfwSwapBuffers(window);
+    glrSwapBuffers(window);
 
     /* Poll for and process events */
-    glfwPollEvents();
+    glrPollEvents(window);
   }
 
+  glrFreeTransforms(transforms);
   glrTeardown(window);
   return 0;
 }
@@ -1,14 +1,20 @@
 #include <stdio.h>
+#include <string.h>
 #include <glr.h>
 #include <cglm/mat4.h>
 #include <cglm/affine.h>
 #include <cglm/cam.h>
 #include <cglm/util.h>
+#include <cglm/quat.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
 #define POINT_LIGHTS_COUNT 4
+#define SPOT_LIGHT POINT_LIGHTS_COUNT
+#define LIGHTS_COUNT (POINT_LIGHTS_COUNT + 1)
+// Keep in sync with MAX_LIGHTS in c17-1.object.frag
+#define MAX_LIGHTS_PER_OBJECT 4
 
 typedef struct Camera
 {
@@ -17,74 +23,27 @@ typedef struct Camera
   vec3 up;
   float fov;
 } Camera;
-typedef struct DirLight
-{
-  vec3 direction;
-  vec3 ambient;
-  vec3 diffuse;
-  vec3 specular;
-} DirLight;
-typedef struct PointLight
-{
-  vec3 position;
-  vec3 ambient;
-  vec3 diffuse;
-  vec3 specular;
-  float constant;
-  float linear;
-  float quadratic;
-} PointLight;
-typedef struct SpotLight
-{
-  vec3 position;
-  vec3 direction;
-  vec3 ambient;
-  vec3 diffuse;
-  vec3 specular;
-  float constant;
-  float linear;
-  float quadratic;
-  float cutOff;
-  float outerCutOff;
-} SpotLight;
 typedef struct State
 {
   Camera camera;
-  DirLight dirLight;
-  PointLight pointLights[POINT_LIGHTS_COUNT];
-  SpotLight spotLight;
+  GlrDirectionalLight dirLight;
+  // The point lights, then the spot light
+  GlrLight lights[LIGHTS_COUNT];
 } State;
 
-typedef struct DirLightLocation
+typedef struct LampColor
 {
-  GLint direction;
-  GLint ambient;
-  GLint diffuse;
-  GLint specular;
-} DirLightLocation;
-typedef struct PointLightLocation
-{
-  GLint position;
-  GLint ambient;
-  GLint diffuse;
-  GLint specular;
-  GLint constant;
-  GLint linear;
-  GLint quadratic;
-} PointLightLocation;
-typedef struct SpotLightLocation
+  GLint location;
+  const float *color;
+} LampColor;
+
+typedef struct CubeLights
 {
-  GLint position;
-  GLint direction;
-  GLint ambient;
-  GLint diffuse;
-  GLint specular;
-  GLint constant;
-  GLint linear;
-  GLint quadratic;
-  GLint cutOff;
-  GLint outerCutOff;
-} SpotLightLocation;
+  GlrObjectLights *objectLights;
+  GLuint object;
+  GLint countLocation;
+  GLint lightsLocation;
+} CubeLights;
 
 static void ensureNoErrorMessage(const GLchar *prompt, const GLchar *message)
 {
@@ -121,9 +80,9 @@ void processInput(GLFWwindow *window, float deltaTime, State *state)
   glm_vec3_normalize(up);
   glm_vec3_cross(front, (vec3){0.0f, 1.0f, 0.0f}, right);
 
-  if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
   {
-    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+    if (glrGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
     {
       glm_vec3_scale(up, cameraSpeed, translation);
     }
@@ -132,9 +91,9 @@ void processInput(GLFWwindow *window, float deltaTime, State *state)
       glm_vec3_scale(front, cameraSpeed, translation);
     }
   }
-  if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
   {
-    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+    if (glrGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
     {
       glm_vec3_scale(up, -cameraSpeed, translation);
     }
@@ -143,11 +102,11 @@ void processInput(GLFWwindow *window, float deltaTime, State *state)
       glm_vec3_scale(front, -cameraSpeed, translation);
     }
   }
-  if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
   {
     glm_vec3_scale(right, -cameraSpeed, translation);
   }
-  if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
   {
     glm_vec3_scale(right, cameraSpeed, translation);
   }
@@ -219,6 +178,19 @@ void loadTexture(GLuint id, GLenum index, const char *path)
   stbi_image_free(data);
 }
 
+static void setLampColor(const GlrDrawItem *item)
+{
+  const LampColor *lampColor = (const LampColor *)item->userData;
+  glUniform3fv(lampColor->location, 1, lampColor->color);
+}
+
+static void setCubeLights(const GlrDrawItem *item)
+{
+  const CubeLights *cubeLights = (const CubeLights *)item->userData;
+  glrObjectLightsUniforms(cubeLights->objectLights, cubeLights->object, cubeLights->countLocation,
+                          cubeLights->lightsLocation);
+}
+
 int main(int argc, char *argv[])
 {
   GlrSetupArgs setup = {.windowWidth = 800, .windowHeight = 600, .windowTitle = argv[0]};
@@ -232,30 +204,25 @@ int main(int argc, char *argv[])
 
   const int LIGHT_ID = 0, OBJECT_ID = 1;
 
+  // Submit all shaders and programs first, then load textures while the driver compiles them.
+  glrMaxShaderCompilerThreads(0xFFFFFFFF);
+
   GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-  ensureNoErrorMessage("Compiling Vertex Shader", glrShaderSourceFromFile(vertexShader, "shaders/c17-1.vert"));
+  ensureNoErrorMessage("Reading Vertex Shader", glrShaderSourceFromFileAsync(vertexShader, "shaders/c17-1.vert"));
 
+  GLuint lightFragShader = glCreateShader(GL_FRAGMENT_SHADER);
+  ensureNoErrorMessage("Reading Frag Shader", glrShaderSourceFromFileAsync(lightFragShader, "shaders/c17-1.light.frag"));
   GLuint lightProgram = glCreateProgram();
-  {
-    GLuint fragShader = glCreateShader(GL_FRAGMENT_SHADER);
-    ensureNoErrorMessage("Compiling Frag Shader", glrShaderSourceFromFile(fragShader, "shaders/c17-1.light.frag"));
-    glAttachShader(lightProgram, vertexShader);
-    glAttachShader(lightProgram, fragShader);
-    ensureNoErrorMessage("Linking Program", glrLinkProgram(lightProgram));
-    glDeleteShader(fragShader);
-  }
+  glAttachShader(lightProgram, vertexShader);
+  glAttachShader(lightProgram, lightFragShader);
+  glrLinkProgramAsync(lightProgram);
 
+  GLuint objectFragShader = glCreateShader(GL_FRAGMENT_SHADER);
+  ensureNoErrorMessage("Reading Frag Shader", glrShaderSourceFromFileAsync(objectFragShader, "shaders/c17-1.object.frag"));
   GLuint objectProgram = glCreateProgram();
-  {
-    GLuint fragShader = glCreateShader(GL_FRAGMENT_SHADER);
-    ensureNoErrorMessage("Compiling Frag Shader", glrShaderSourceFromFile(fragShader, "shaders/c17-1.object.frag"));
-    glAttachShader(objectProgram, vertexShader);
-    glAttachShader(objectProgram, fragShader);
-    ensureNoErrorMessage("Linking Program", glrLinkProgram(objectProgram));
-    glDeleteShader(fragShader);
-  }
-
-  glDeleteShader(vertexShader);
+  glAttachShader(objectProgram, vertexShader);
+  glAttachShader(objectProgram, objectFragShader);
+  glrLinkProgramAsync(objectProgram);
 
   GLuint textures[2];
   const int DIFFUSE_TEX = 0, SPECULAR_TEX = 1;
@@ -264,6 +231,15 @@ int main(int argc, char *argv[])
   loadTexture(textures[DIFFUSE_TEX], GL_TEXTURE0, "textures/container2.png");
   loadTexture(textures[SPECULAR_TEX], GL_TEXTURE1, "textures/container2_specular.png");
 
+  ensureNoErrorMessage("Compiling Vertex Shader", glrShaderResult(vertexShader));
+  ensureNoErrorMessage("Compiling Frag Shader", glrShaderResult(lightFragShader));
+  ensureNoErrorMessage("Compiling Frag Shader", glrShaderResult(objectFragShader));
+  ensureNoErrorMessage("Linking Program", glrProgramResult(lightProgram));
+  ensureNoErrorMessage("Linking Program", glrProgramResult(objectProgram));
+  glDeleteShader(vertexShader);
+  glDeleteShader(lightFragShader);
+  glDeleteShader(objectFragShader);
+
   glUseProgram(objectProgram);
   glUniform1i(glGetUniformLocation(objectProgram, "material.diffuse"), 0);
   glUniform1i(glGetUniformLocation(objectProgram, "material.specular"), 1);
@@ -361,25 +337,32 @@ int main(int argc, char *argv[])
           .fov = 45.0f,
       },
       .dirLight = {.direction = {-0.2f, -1.0f, -0.3f}, .ambient = {0.05f, 0.05f, 0.05f}, .diffuse = {0.4f, 0.4f, 0.4f}, .specular = {0.5f, 0.5f, 0.5f}},
-      .pointLights = {// point light 1
-                      {.position = {0.7f, 0.2f, 2.0f}, .ambient = {0.05f, 0.05f, 0.05f}, .diffuse = {0.8f, 0.8f, 0.8f}, .specular = {1.0f, 1.0f, 1.0f}, .constant = 1.0f, .linear = 0.09f, .quadratic = 0.032f},
-                      // point light 2
-                      {.position = {2.3f, -3.3f, -4.0f}, .ambient = {0.05f, 0.05f, 0.05f}, .diffuse = {0.8f, 0.8f, 0.8f}, .specular = {1.0f, 1.0f, 1.0f}, .constant = 1.0f, .linear = 0.09f, .quadratic = 0.032f},
-                      // point light 3
-                      {.position = {-4.0f, 2.0f, -12.0f}, .ambient = {0.05f, 0.05f, 0.05f}, .diffuse = {0.8f, 0.8f, 0.8f}, .specular = {1.0f, 1.0f, 1.0f}, .constant = 1.0f, .linear = 0.09f, .quadratic = 0.032f},
-                      // point light 4
-                      {.position = {0.0f, 0.0f, -3.0f}, .ambient = {0.05f, 0.05f, 0.05f}, .diffuse = {0.8f, 0.8f, 0.8f}, .specular = {1.0f, 1.0f, 1.0f}, .constant = 1.0f, .linear = 0.09f, .quadratic = 0.032f}},
-      .spotLight = {.position = {-0.1f, 0.0f, 5.0f}, .direction = {0.0f, 0.0f, -1.0f}, .ambient = {0.0f, 0.0f, 0.0f}, .diffuse = {1.0f, 1.0f, 1.0f}, .specular = {1.0f, 1.0f, 1.0f}, .constant = 1.0f, .linear = 0.09f, .quadratic = 0.032f, .cutOff = cos(glm_rad(12.5f)), .outerCutOff = cos(glm_rad(17.5f))}};
+      .lights = {// point light 1
+                 {.position = {0.7f, 0.2f, 2.0f}, .ambient = {0.05f, 0.05f, 0.05f}, .diffuse = {0.8f, 0.8f, 0.8f}, .specular = {1.0f, 1.0f, 1.0f}, .constant = 1.0f, .linear = 0.09f, .quadratic = 0.032f},
+                 // point light 2
+                 {.position = {2.3f, -3.3f, -4.0f}, .ambient = {0.05f, 0.05f, 0.05f}, .diffuse = {0.8f, 0.8f, 0.8f}, .specular = {1.0f, 1.0f, 1.0f}, .constant = 1.0f, .linear = 0.09f, .quadratic = 0.032f},
+                 // point light 3
+                 {.position = {-4.0f, 2.0f, -12.0f}, .ambient = {0.05f, 0.05f, 0.05f}, .diffuse = {0.8f, 0.8f, 0.8f}, .specular = {1.0f, 1.0f, 1.0f}, .constant = 1.0f, .linear = 0.09f, .quadratic = 0.032f},
+                 // point light 4
+                 {.position = {0.0f, 0.0f, -3.0f}, .ambient = {0.05f, 0.05f, 0.05f}, .diffuse = {0.8f, 0.8f, 0.8f}, .specular = {1.0f, 1.0f, 1.0f}, .constant = 1.0f, .linear = 0.09f, .quadratic = 0.032f},
+                 // spot light
+                 {.position = {-0.1f, 0.0f, 5.0f}, .direction = {0.0f, 0.0f, -1.0f}, .ambient = {0.0f, 0.0f, 0.0f}, .diffuse = {1.0f, 1.0f, 1.0f}, .specular = {1.0f, 1.0f, 1.0f}, .constant = 1.0f, .linear = 0.09f, .quadratic = 0.032f, .cutOff = cos(glm_rad(12.5f)), .outerCutOff = cos(glm_rad(17.5f))}}};
 
   glfwSetWindowUserPointer(window, &state);
 
+  // The directional light reaches every cube, only the point and spot lights are picked per cube.
+  glUseProgram(objectProgram);
+  glUniform3fv(glGetUniformLocation(objectProgram, "dirLight.direction"), 1, state.dirLight.direction);
+  glUniform3fv(glGetUniformLocation(objectProgram, "dirLight.ambient"), 1, state.dirLight.ambient);
+  glUniform3fv(glGetUniformLocation(objectProgram, "dirLight.diffuse"), 1, state.dirLight.diffuse);
+  glUniform3fv(glGetUniformLocation(objectProgram, "dirLight.specular"), 1, state.dirLight.specular);
+
   glEnable(GL_DEPTH_TEST);
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-  glfwSetCursorPosCallback(window, cursorPosCallback);
-  glfwSetScrollCallback(window, scrollCallback);
+  glrSetCursorPosCallback(window, cursorPosCallback);
+  glrSetScrollCallback(window, scrollCallback);
 
   mat4 view, projection;
-  char uniformNameBuffer[128];
 
   GLuint modelLocations[2] = {
       glGetUniformLocation(lightProgram, "model"),
@@ -395,42 +378,61 @@ int main(int argc, char *argv[])
 
   GLuint transposedInverseModelLocation = glGetUniformLocation(objectProgram, "transposedInverseModel");
   GLuint viewPosLocation = glGetUniformLocation(objectProgram, "viewPos");
-  DirLightLocation dirLightLocation = {
-      .direction = glGetUniformLocation(objectProgram, "dirLight.direction"),
-      .ambient = glGetUniformLocation(objectProgram, "dirLight.ambient"),
-      .diffuse = glGetUniformLocation(objectProgram, "dirLight.diffuse"),
-      .specular = glGetUniformLocation(objectProgram, "dirLight.specular")};
-  PointLightLocation pointLightsLocations[POINT_LIGHTS_COUNT];
+
+  // Each cube is shaded forward by the few lights whose range reaches its bounding sphere.
+  GlrObjectLights *objectLights = glrCreateObjectLights(MAX_LIGHTS_PER_OBJECT);
+  CubeLights cubeLights[sizeof(cubePositions) / sizeof(vec3)];
+  for (unsigned int i = 0; i < sizeof(cubePositions) / sizeof(vec3); ++i)
+  {
+    cubeLights[i] = (CubeLights){
+        .objectLights = objectLights,
+        .object = i,
+        .countLocation = glGetUniformLocation(objectProgram, "lightsLen"),
+        .lightsLocation = glGetUniformLocation(objectProgram, "lights"),
+    };
+  }
+
+  // The textures stay bound to units 0 and 1, the samplers are set above.
+  GlrModelMaterial cubeMaterial = {
+      .diffuse = textures[DIFFUSE_TEX],
+      .specular = textures[SPECULAR_TEX],
+      .shininess = 64.0f};
+  LampColor lampColors[POINT_LIGHTS_COUNT];
   for (unsigned int i = 0; i < POINT_LIGHTS_COUNT; ++i)
   {
-    snprintf(uniformNameBuffer, sizeof(uniformNameBuffer), "pointLights[%d].position", i);
-    pointLightsLocations[i].position = glGetUniformLocation(objectProgram, uniformNameBuffer);
-    snprintf(uniformNameBuffer, sizeof(uniformNameBuffer), "pointLights[%d].ambient", i);
-    pointLightsLocations[i].ambient = glGetUniformLocation(objectProgram, uniformNameBuffer);
-    snprintf(uniformNameBuffer, sizeof(uniformNameBuffer), "pointLights[%d].diffuse", i);
-    pointLightsLocations[i].diffuse = glGetUniformLocation(objectProgram, uniformNameBuffer);
-    snprintf(uniformNameBuffer, sizeof(uniformNameBuffer), "pointLights[%d].specular", i);
-    pointLightsLocations[i].specular = glGetUniformLocation(objectProgram, uniformNameBuffer);
-    snprintf(uniformNameBuffer, sizeof(uniformNameBuffer), "pointLights[%d].constant", i);
-    pointLightsLocations[i].constant = glGetUniformLocation(objectProgram, uniformNameBuffer);
-    snprintf(uniformNameBuffer, sizeof(uniformNameBuffer), "pointLights[%d].linear", i);
-    pointLightsLocations[i].linear = glGetUniformLocation(objectProgram, uniformNameBuffer);
-    snprintf(uniformNameBuffer, sizeof(uniformNameBuffer), "pointLights[%d].quadratic", i);
-    pointLightsLocations[i].quadratic = glGetUniformLocation(objectProgram, uniformNameBuffer);
+    lampColors[i].location = lightColorLocation;
+  }
+  GlrRenderQueue *queue = glrCreateRenderQueue();
+
+  // Neither the cubes nor the lamps move, their matrices are computed once by the first update.
+  GlrTransforms *cubeTransforms = glrCreateTransforms();
+  for (unsigned int i = 0; i < sizeof(cubePositions) / sizeof(vec3); ++i)
+  {
+    versor rotation;
+    glm_quatv(rotation, glm_rad(20.0f * i), (vec3){1.0f, 0.3f, 0.5f});
+    glrAddTransform(cubeTransforms, cubePositions[i], rotation, NULL);
   }
-  SpotLightLocation spotLightLocation = {
-      .position = glGetUniformLocation(objectProgram, "spotLight.position"),
-      .direction = glGetUniformLocation(objectProgram, "spotLight.direction"),
-      .ambient = glGetUniformLocation(objectProgram, "spotLight.ambient"),
-      .diffuse = glGetUniformLocation(objectProgram, "spotLight.diffuse"),
-      .specular = glGetUniformLocation(objectProgram, "spotLight.specular"),
-      .constant = glGetUniformLocation(objectProgram, "spotLight.constant"),
-      .linear = glGetUniformLocation(objectProgram, "spotLight.linear"),
-      .quadratic = glGetUniformLocation(objectProgram, "spotLight.quadratic"),
-      .cutOff = glGetUniformLocation(objectProgram, "spotLight.cutOff"),
-      .outerCutOff = glGetUniformLocation(objectProgram, "spotLight.outerCutOff")};
-
-  float lastFrame = glfwGetTime();
+  // Bounding spheres of the rotated unit cubes, centered on their positions
+  float cubeRadii[sizeof(cubePositions) / sizeof(vec3)];
+  for (unsigned int i = 0; i < sizeof(cubePositions) / sizeof(vec3); ++i)
+  {
+    cubeRadii[i] = 0.87f;
+  }
+  GlrBounds cubeBounds = {
+      .x = cubeTransforms->position[0],
+      .y = cubeTransforms->position[1],
+      .z = cubeTransforms->position[2],
+      .radius = cubeRadii,
+      .len = cubeTransforms->len,
+  };
+  GLuint visibleCubes[sizeof(cubePositions) / sizeof(vec3)];
+  GlrTransforms *lampTransforms = glrCreateTransforms();
+  for (unsigned int i = 0; i < POINT_LIGHTS_COUNT; ++i)
+  {
+    glrAddTransform(lampTransforms, state.lights[i].position, NULL, (vec3){0.2f, 0.2f, 0.2f});
+  }
+
+  double lastFrame = glrGetTime();
   glfwSetInputMode(window, GLFW_STICKY_KEYS, GLFW_TRUE);
   /* Loop until the user closes the window */
   while (!glfwWindowShouldClose(window))
@@ -439,14 +441,15 @@ int main(int argc, char *argv[])
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    float currentFrame = glfwGetTime();
-    float deltaTime = currentFrame - lastFrame;
+    double currentFrame = glrGetTime();
+    float deltaTime = (float)(currentFrame - lastFrame);
     lastFrame = currentFrame;
     processInput(window, deltaTime, &state);
+    glrBenchmarkCamera(state.camera.position, state.camera.front);
 
     // SpotLight follows camera
-    glm_vec3_copy(state.camera.position, state.spotLight.position);
-    glm_vec3_copy(state.camera.front, state.spotLight.direction);
+    glm_vec3_copy(state.camera.position, state.lights[SPOT_LIGHT].position);
+    glm_vec3_copy(state.camera.front, state.lights[SPOT_LIGHT].direction);
 
     vec3 cameraTarget;
     glm_vec3_add(state.camera.position, state.camera.front, cameraTarget);
@@ -458,79 +461,74 @@ int main(int argc, char *argv[])
 
     glUniformMatrix4fv(viewLocations[OBJECT_ID], 1, GL_FALSE, (GLfloat *)view);
     glUniformMatrix4fv(projectionLocations[OBJECT_ID], 1, GL_FALSE, (GLfloat *)projection);
-
-    glUniform3fv(dirLightLocation.direction, 1, state.dirLight.direction);
-    glUniform3fv(dirLightLocation.ambient, 1, state.dirLight.ambient);
-    glUniform3fv(dirLightLocation.diffuse, 1, state.dirLight.diffuse);
-    glUniform3fv(dirLightLocation.specular, 1, state.dirLight.specular);
-    for (unsigned int i = 0; i < POINT_LIGHTS_COUNT; ++i)
-    {
-      glUniform3fv(pointLightsLocations[i].position, 1, state.pointLights[i].position);
-      glUniform3fv(pointLightsLocations[i].ambient, 1, state.pointLights[i].ambient);
-      glUniform3fv(pointLightsLocations[i].diffuse, 1, state.pointLights[i].diffuse);
-      glUniform3fv(pointLightsLocations[i].specular, 1, state.pointLights[i].specular);
-      glUniform1f(pointLightsLocations[i].constant, state.pointLights[i].constant);
-      glUniform1f(pointLightsLocations[i].linear, state.pointLights[i].linear);
-      glUniform1f(pointLightsLocations[i].quadratic, state.pointLights[i].quadratic);
-    }
-    glUniform3fv(spotLightLocation.position, 1, state.spotLight.position);
-    glUniform3fv(spotLightLocation.direction, 1, state.spotLight.direction);
-    glUniform3fv(spotLightLocation.ambient, 1, state.spotLight.ambient);
-    glUniform3fv(spotLightLocation.diffuse, 1, state.spotLight.diffuse);
-    glUniform3fv(spotLightLocation.specular, 1, state.spotLight.specular);
-    glUniform1f(spotLightLocation.cutOff, state.spotLight.cutOff);
-    glUniform1f(spotLightLocation.outerCutOff, state.spotLight.outerCutOff);
-    glUniform1f(spotLightLocation.constant, state.spotLight.constant);
-    glUniform1f(spotLightLocation.linear, state.spotLight.linear);
-    glUniform1f(spotLightLocation.quadratic, state.spotLight.quadratic);
-
-    glUniform3fv(viewPosLocation, 1, (GLfloat *)(state.camera.position));
-
-    glBindVertexArray(VAOs[OBJECT_ID]);
-    for (unsigned int i = 0; i < sizeof(cubePositions) / sizeof(vec3); ++i)
-    {
-      mat4 cubeModel;
-      glm_mat4_identity(cubeModel);
-      glm_translate(cubeModel, cubePositions[i]);
-      float angle = 20.0f * i;
-      glm_rotate(cubeModel, glm_rad(angle), (vec3){1.0f, 0.3f, 0.5f});
-
-      glUniformMatrix4fv(modelLocations[OBJECT_ID], 1, GL_FALSE, (GLfloat *)cubeModel);
-
-      mat4 transposedInverseModel;
-      glm_mat4_inv(cubeModel, transposedInverseModel);
-      glm_mat4_transpose(transposedInverseModel);
-      mat3 transposedInverseModelMat3;
-      glm_mat4_pick3(transposedInverseModel, transposedInverseModelMat3);
-      glUniformMatrix3fv(transposedInverseModelLocation, 1, GL_FALSE, (GLfloat *)transposedInverseModelMat3);
-
-      glDrawArrays(GL_TRIANGLES, 0, 36);
-    }
+    glUniform3fv(viewPosLocation, 1, state.camera.position);
 
     glUseProgram(lightProgram);
     glUniformMatrix4fv(viewLocations[LIGHT_ID], 1, GL_FALSE, (GLfloat *)view);
     glUniformMatrix4fv(projectionLocations[LIGHT_ID], 1, GL_FALSE, (GLfloat *)projection);
 
-    glBindVertexArray(VAOs[LIGHT_ID]);
-    for (unsigned int i = 0; i < POINT_LIGHTS_COUNT; ++i)
-    {
-      mat4 lightModel;
-      glm_translate_make(lightModel, state.pointLights[i].position);
-      glm_scale_uni(lightModel, 0.2f);
-      glUniformMatrix4fv(modelLocations[LIGHT_ID], 1, GL_FALSE, (GLfloat *)lightModel);
+    glrUpdateTransforms(cubeTransforms);
+    glrUpdateTransforms(lampTransforms);
 
-      glUniform3fv(lightColorLocation, 1, state.pointLights[i].diffuse);
+    mat4 viewProjection;
+    float frustum[6][4];
+    glm_mat4_mul(projection, view, viewProjection);
+    glrFrustumPlanes((GLfloat *)viewProjection, frustum);
+    GLuint visibleCubesLen = glrCullFrustum(frustum, &cubeBounds, visibleCubes);
+    glrAssignObjectLights(objectLights, state.lights, LIGHTS_COUNT, &cubeBounds);
 
-      glDrawArrays(GL_TRIANGLES, 0, 36);
+    // Submit the cubes and the lamps in any order, the queue groups them by state and draws front to back.
+    glrClearRenderQueue(queue);
+    for (GLuint visibleIndex = 0; visibleIndex < visibleCubesLen; ++visibleIndex)
+    {
+      GLuint i = visibleCubes[visibleIndex];
+      GlrDrawItem item = {
+          .program = objectProgram,
+          .vao = VAOs[OBJECT_ID],
+          .material = &cubeMaterial,
+          .mode = GL_TRIANGLES,
+          .count = 36,
+          .modelLocation = modelLocations[OBJECT_ID],
+          .normalMatrixLocation = transposedInverseModelLocation,
+          .normalMatrix = glrTransformNormal(cubeTransforms, i),
+          .depth = glm_vec3_distance(state.camera.position, cubePositions[i]),
+          .setUniforms = setCubeLights,
+          .userData = &cubeLights[i],
+      };
+      memcpy(item.transform, glrTransformWorld(cubeTransforms, i), sizeof(mat4));
+      glrPushDrawItem(queue, &item);
+    }
+    for (unsigned int i = 0; i < POINT_LIGHTS_COUNT; ++i)
+    {
+      lampColors[i].color = state.lights[i].diffuse;
+      GlrDrawItem item = {
+          .program = lightProgram,
+          .vao = VAOs[LIGHT_ID],
+          .mode = GL_TRIANGLES,
+          .count = 36,
+          .modelLocation = modelLocations[LIGHT_ID],
+          .normalMatrixLocation = -1,
+          .depth = glm_vec3_distance(state.camera.position, state.lights[i].position),
+          .setUniforms = setLampColor,
+          .userData = &lampColors[i],
+      };
+      memcpy(item.transform, glrTransformWorld(lampTransforms, i), sizeof(mat4));
+      glrPushDrawItem(queue, &item);
     }
+    glrSortRenderQueue(queue);
+    glrDrawRenderQueue(queue);
 
     /* Swap front and back buffers */
-    glfwSwapBuffers(window);
+    glrSwapBuffers(window);
 
     /* Poll for and process events */
-    glfwPollEvents();
+    glrPollEvents(window);
   }
 
+  glrFreeTransforms(cubeTransforms);
+  glrFreeTransforms(lampTransforms);
+  glrFreeRenderQueue(queue);
+  glrFreeObjectLights(objectLights);
   glrTeardown(window);
   return 0;
 }
@@ -8,6 +8,11 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#define POINT_LIGHTS_COUNT 256
+#define MAX_LIGHTS_PER_CLUSTER 64
+// The lights and clusters texture buffers follow the material textures.
+#define CLUSTERS_UNIT 2
+
 typedef struct Camera
 {
   vec3 position;
@@ -40,6 +45,7 @@ typedef struct State
   Camera camera;
   DirLight dirLight;
   SpotLight spotLight;
+  GlrLight pointLights[POINT_LIGHTS_COUNT];
 } State;
 
 typedef struct DirLightUniforms
@@ -72,6 +78,7 @@ typedef struct Uniforms
   GlrModelMaterialUniforms material;
   DirLightUniforms dirLight;
   SpotLightUniforms spotLight;
+  GLint clusterParams;
 } Uniforms;
 
 static void ensureNoErrorMessage(const GLchar *prompt, const GLchar *message)
@@ -109,9 +116,9 @@ void processInput(GLFWwindow *window, float deltaTime, State *state)
   glm_vec3_normalize(up);
   glm_vec3_cross(front, (vec3){0.0f, 1.0f, 0.0f}, right);
 
-  if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
   {
-    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+    if (glrGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
     {
       glm_vec3_scale(up, cameraSpeed, translation);
     }
@@ -120,9 +127,9 @@ void processInput(GLFWwindow *window, float deltaTime, State *state)
       glm_vec3_scale(front, cameraSpeed, translation);
     }
   }
-  if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
   {
-    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+    if (glrGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
     {
       glm_vec3_scale(up, -cameraSpeed, translation);
     }
@@ -131,11 +138,11 @@ void processInput(GLFWwindow *window, float deltaTime, State *state)
       glm_vec3_scale(front, -cameraSpeed, translation);
     }
   }
-  if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
   {
     glm_vec3_scale(right, -cameraSpeed, translation);
   }
-  if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
   {
     glm_vec3_scale(right, cameraSpeed, translation);
   }
@@ -227,13 +234,26 @@ int main(int argc, char *argv[])
       .dirLight = {.direction = {-0.2f, -1.0f, -0.3f}, .ambient = {0.5f, 0.5f, 0.5f}, .diffuse = {0.9f, 0.9f, 0.9f}, .specular = {0.5f, 0.5f, 0.5f}},
       .spotLight = {.position = {-0.1f, 0.0f, 5.0f}, .direction = {0.0f, 0.0f, -1.0f}, .ambient = {0.0f, 0.0f, 0.0f}, .diffuse = {0.3f, 0.3f, 0.3f}, .specular = {0.5f, 0.5f, 0.5f}, .constant = 1.0f, .linear = 0.09f, .quadratic = 0.032f, .cutOff = cos(glm_rad(15.0f)), .outerCutOff = cos(glm_rad(22.5f))}};
 
+  // Small colored lights on a spiral around the backpack, each reaches about 1 unit, so only a few clusters.
+  for (int i = 0; i < POINT_LIGHTS_COUNT; ++i)
+  {
+    float angle = 2.4f * i, height = -2.0f + 4.0f * i / POINT_LIGHTS_COUNT;
+    GlrLight *light = &state.pointLights[i];
+    glm_vec3_copy((vec3){2.0f * cosf(angle), height, 2.0f * sinf(angle)}, light->position);
+    glm_vec3_copy((vec3){0.5f + 0.5f * cosf(angle), 0.5f + 0.5f * sinf(angle), 0.5f - 0.5f * cosf(angle)}, light->diffuse);
+    glm_vec3_scale(light->diffuse, 0.5f, light->specular);
+    light->constant = 1.0f;
+    light->linear = 0.7f;
+    light->quadratic = 50.0f;
+  }
+
   glfwSetWindowUserPointer(window, &state);
 
   glEnable(GL_DEPTH_TEST);
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
   glfwSetInputMode(window, GLFW_STICKY_KEYS, GLFW_TRUE);
-  glfwSetCursorPosCallback(window, cursorPosCallback);
-  glfwSetScrollCallback(window, scrollCallback);
+  glrSetCursorPosCallback(window, cursorPosCallback);
+  glrSetScrollCallback(window, scrollCallback);
 
   GLuint program = glCreateProgram();
   {
@@ -260,7 +280,15 @@ int main(int argc, char *argv[])
           .specular = glGetUniformLocation(program, "material.specular"),
           .shininess = glGetUniformLocation(program, "material.shininess")},
       .dirLight = {.direction = glGetUniformLocation(program, "dirLight.direction"), .ambient = glGetUniformLocation(program, "dirLight.ambient"), .diffuse = glGetUniformLocation(program, "dirLight.diffuse"), .specular = glGetUniformLocation(program, "dirLight.specular")},
-      .spotLight = {.position = glGetUniformLocation(program, "spotLight.position"), .direction = glGetUniformLocation(program, "spotLight.direction"), .ambient = glGetUniformLocation(program, "spotLight.ambient"), .diffuse = glGetUniformLocation(program, "spotLight.diffuse"), .specular = glGetUniformLocation(program, "spotLight.specular"), .constant = glGetUniformLocation(program, "spotLight.constant"), .linear = glGetUniformLocation(program, "spotLight.linear"), .quadratic = glGetUniformLocation(program, "spotLight.quadratic"), .cutOff = glGetUniformLocation(program, "spotLight.cutOff"), .outerCutOff = glGetUniformLocation(program, "spotLight.outerCutOff")}};
+      .spotLight = {.position = glGetUniformLocation(program, "spotLight.position"), .direction = glGetUniformLocation(program, "spotLight.direction"), .ambient = glGetUniformLocation(program, "spotLight.ambient"), .diffuse = glGetUniformLocation(program, "spotLight.diffuse"), .specular = glGetUniformLocation(program, "spotLight.specular"), .constant = glGetUniformLocation(program, "spotLight.constant"), .linear = glGetUniformLocation(program, "spotLight.linear"), .quadratic = glGetUniformLocation(program, "spotLight.quadratic"), .cutOff = glGetUniformLocation(program, "spotLight.cutOff"), .outerCutOff = glGetUniformLocation(program, "spotLight.outerCutOff")},
+      .clusterParams = glGetUniformLocation(program, "clusterParams")};
+
+  // Each fragment only shades the point lights assigned to its cluster.
+  GlrLightClusters *clusters = glrCreateLightClusters(setup.windowWidth, setup.windowHeight, MAX_LIGHTS_PER_CLUSTER);
+  glUseProgram(program);
+  glUniform1i(glGetUniformLocation(program, "clusterLights"), CLUSTERS_UNIT);
+  glUniform1i(glGetUniformLocation(program, "clusterGrid"), CLUSTERS_UNIT + 1);
+  glUniform1i(glGetUniformLocation(program, "clusterIndices"), CLUSTERS_UNIT + 2);
 
   GlrModel *backpack = glrLoadModel("objects/backpack/backpack.obj", loadTexture);
   if (backpack == NULL)
@@ -270,8 +298,26 @@ int main(int argc, char *argv[])
   }
   glrBindModel(backpack);
 
-  mat4 view, projection;
-  float lastFrame = glfwGetTime();
+  GlrTransforms *transforms = glrCreateTransforms();
+  GLuint backpackTransform = glrAddTransform(transforms, NULL, NULL, (vec3){0.7f, 0.7f, 0.7f});
+
+  // The GPU skips the backpack while the query of its bounding box from the last frame found it hidden.
+  const GLchar *queriesError = NULL;
+  GlrOcclusionQueries *queries = glrCreateOcclusionQueries(1, &queriesError);
+  ensureNoErrorMessage("Creating Occlusion Queries", queriesError);
+  vec3 backpackCenter, backpackExtent;
+  GlrBounds backpackBounds = {
+      .x = &backpackCenter[0],
+      .y = &backpackCenter[1],
+      .z = &backpackCenter[2],
+      .extentX = &backpackExtent[0],
+      .extentY = &backpackExtent[1],
+      .extentZ = &backpackExtent[2],
+      .len = 1,
+  };
+
+  mat4 view, projection, viewProjection;
+  double lastFrame = glrGetTime();
   /* Loop until the user closes the window */
   while (!glfwWindowShouldClose(window))
   {
@@ -279,10 +325,11 @@ int main(int argc, char *argv[])
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    float currentFrame = glfwGetTime();
-    float deltaTime = currentFrame - lastFrame;
+    double currentFrame = glrGetTime();
+    float deltaTime = (float)(currentFrame - lastFrame);
     lastFrame = currentFrame;
     processInput(window, deltaTime, &state);
+    glrBenchmarkCamera(state.camera.position, state.camera.front);
 
     // SpotLight follows camera
     glm_vec3_copy(state.camera.position, state.spotLight.position);
@@ -316,24 +363,33 @@ int main(int argc, char *argv[])
 
     glUniform3fv(uniforms.viewPos, 1, (GLfloat *)(state.camera.position));
 
-    mat4 model, transposedInverseModel;
-    mat3 transposedInverseModelMat3;
-    glm_scale_make(model, (vec3){0.7f, 0.7f, 0.7f});
-    glUniformMatrix4fv(uniforms.model, 1, GL_FALSE, (GLfloat *)model);
-    glm_mat4_inv(model, transposedInverseModel);
-    glm_mat4_transpose(transposedInverseModel);
-    glm_mat4_pick3(transposedInverseModel, transposedInverseModelMat3);
-    glUniformMatrix3fv(uniforms.transposedInverseModel, 1, GL_FALSE, (GLfloat *)transposedInverseModelMat3);
+    glrUpdateLightClusters(clusters, (GLfloat *)view, (GLfloat *)projection, state.pointLights, POINT_LIGHTS_COUNT);
+    glrBindLightClusters(clusters, CLUSTERS_UNIT);
+    glrLightClustersUniforms(clusters, uniforms.clusterParams);
+
+    // The backpack is static, only the first update computes its matrices.
+    glrUpdateTransforms(transforms);
+    glUniformMatrix4fv(uniforms.model, 1, GL_FALSE, glrTransformWorld(transforms, backpackTransform));
+    glUniformMatrix3fv(uniforms.transposedInverseModel, 1, GL_FALSE, glrTransformNormal(transforms, backpackTransform));
+
+    glrModelBounds(backpack, glrTransformWorld(transforms, backpackTransform), backpackCenter, backpackExtent);
+
+    glrDrawModelConditional(queries, 0, backpack, &uniforms.material);
 
-    glrDrawModel(backpack, &uniforms.material);
+    glm_mat4_mul(projection, view, viewProjection);
+    glrIssueOcclusionQueries(queries, (GLfloat *)viewProjection, &backpackBounds);
 
     /* Swap front and back buffers */
-    glfwSwapBuffers(window);
+    glrSwapBuffers(window);
 
     /* Poll for and process events */
-    glfwPollEvents();
+    glrPollEvents(window);
   }
 
+  glrFreeOcclusionQueries(queries);
+  glrFreeLightClusters(clusters);
+  glrFreeTransforms(transforms);
+  glrFreeModel(backpack);
   glrTeardown(window);
   return 0;
 }
@@ -56,9 +56,9 @@ void processInput(GLFWwindow *window, float deltaTime, State *state)
   glm_vec3_normalize(up);
   glm_vec3_cross(front, (vec3){0.0f, 1.0f, 0.0f}, right);
 
-  if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
   {
-    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+    if (glrGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
     {
       glm_vec3_scale(up, cameraSpeed, translation);
     }
@@ -67,9 +67,9 @@ void processInput(GLFWwindow *window, float deltaTime, State *state)
       glm_vec3_scale(front, cameraSpeed, translation);
     }
   }
-  if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
   {
-    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+    if (glrGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
     {
       glm_vec3_scale(up, -cameraSpeed, translation);
     }
@@ -78,11 +78,11 @@ void processInput(GLFWwindow *window, float deltaTime, State *state)
       glm_vec3_scale(front, -cameraSpeed, translation);
     }
   }
-  if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
   {
     glm_vec3_scale(right, -cameraSpeed, translation);
   }
-  if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
   {
     glm_vec3_scale(right, cameraSpeed, translation);
   }
@@ -289,8 +289,8 @@ int main(int argc, char *argv[])
   glEnable(GL_DEPTH_TEST);
   glEnable(GL_STENCIL_TEST);
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-  glfwSetCursorPosCallback(window, cursorPosCallback);
-  glfwSetScrollCallback(window, scrollCallback);
+  glrSetCursorPosCallback(window, cursorPosCallback);
+  glrSetScrollCallback(window, scrollCallback);
 
   mat4 view, projection;
 
@@ -308,7 +308,7 @@ int main(int argc, char *argv[])
   GLuint lightPosLocation = glGetUniformLocation(objectProgram, "light.position");
   GLuint viewPosLocation = glGetUniformLocation(objectProgram, "viewPos");
 
-  float lastFrame = glfwGetTime();
+  double lastFrame = glrGetTime();
   glfwSetInputMode(window, GLFW_STICKY_KEYS, GLFW_TRUE);
   /* Loop until the user closes the window */
   while (!glfwWindowShouldClose(window))
@@ -317,10 +317,11 @@ int main(int argc, char *argv[])
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
-    float currentFrame = glfwGetTime();
-    float deltaTime = currentFrame - lastFrame;
+    double currentFrame = glrGetTime();
+    float deltaTime = (float)(currentFrame - lastFrame);
     lastFrame = currentFrame;
     processInput(window, deltaTime, &state);
+    glrBenchmarkCamera(state.camera.position, state.camera.front);
 
     vec3 lightColor = {1.0f, 1.0f, 1.0f};
     vec3 lightSpecular = {1.0f, 1.0f, 1.0f};
@@ -383,10 +384,10 @@ int main(int argc, char *argv[])
     glEnable(GL_DEPTH_TEST);
 
     /* Swap front and back buffers */
-    glfwSwapBuffers(window);
+    glrSwapBuffers(window);
 
     /* Poll for and process events */
-    glfwPollEvents();
+    glrPollEvents(window);
   }
 
   glrTeardown(window);
@@ -6,6 +6,9 @@
 #include <cglm/cam.h>
 #include <cglm/util.h>
 
+static const int CASCADES_LEN = 4;
+static const int CASCADE_RESOLUTION = 2048;
+
 typedef struct Camera
 {
   vec3 position;
@@ -25,6 +28,15 @@ typedef struct Uniforms
   GLuint projection;
 } Uniforms;
 
+typedef struct Passes
+{
+  GlrShadowCascades *cascades;
+  Uniforms *uniforms;
+  GLuint depthProgram;
+  GLuint quadProgram;
+  GLuint depthSampler;
+} Passes;
+
 static void ensureNoErrorMessage(const GLchar *prompt, const GLchar *message)
 {
   if (message)
@@ -35,6 +47,32 @@ static void ensureNoErrorMessage(const GLchar *prompt, const GLchar *message)
   }
 }
 
+static void onDepthProgramReload(GLuint program, const GLchar *error, void *ctx)
+{
+  if (error)
+  {
+    fprintf(stderr, "Reloading Depth Program: %s\n", error);
+    return;
+  }
+
+  Uniforms *uniforms = (Uniforms *)ctx;
+  uniforms->model = glGetUniformLocation(program, "model");
+  uniforms->view = glGetUniformLocation(program, "view");
+  uniforms->projection = glGetUniformLocation(program, "projection");
+}
+
+static void onQuadProgramReload(GLuint program, const GLchar *error, void *ctx)
+{
+  if (error)
+  {
+    fprintf(stderr, "Reloading Quad Program: %s\n", error);
+    return;
+  }
+
+  glUseProgram(program);
+  glUniform1i(glGetUniformLocation(program, "depthMap"), 0);
+}
+
 void processInput(GLFWwindow *window, float deltaTime, State *state)
 {
   Camera *camera = &(state->camera);
@@ -49,9 +87,9 @@ void processInput(GLFWwindow *window, float deltaTime, State *state)
   glm_vec3_normalize(up);
   glm_vec3_cross(front, (vec3){0.0f, 1.0f, 0.0f}, right);
 
-  if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
   {
-    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+    if (glrGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
     {
       glm_vec3_scale(up, cameraSpeed, translation);
     }
@@ -60,9 +98,9 @@ void processInput(GLFWwindow *window, float deltaTime, State *state)
       glm_vec3_scale(front, cameraSpeed, translation);
     }
   }
-  if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
   {
-    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+    if (glrGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
     {
       glm_vec3_scale(up, -cameraSpeed, translation);
     }
@@ -71,11 +109,11 @@ void processInput(GLFWwindow *window, float deltaTime, State *state)
       glm_vec3_scale(front, -cameraSpeed, translation);
     }
   }
-  if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
   {
     glm_vec3_scale(right, -cameraSpeed, translation);
   }
-  if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+  if (glrGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
   {
     glm_vec3_scale(right, cameraSpeed, translation);
   }
@@ -222,10 +260,18 @@ void renderCube()
   glBindVertexArray(0);
 }
 
-void renderScene(Uniforms *uniforms, GLfloat *view, GLfloat *projection)
+void renderCasterMatrices(Uniforms *uniforms, const float viewProjection[16])
 {
-  glUniformMatrix4fv(uniforms->projection, 1, GL_FALSE, projection);
-  glUniformMatrix4fv(uniforms->view, 1, GL_FALSE, view);
+  mat4 identity = GLM_MAT4_IDENTITY_INIT;
+  glUniformMatrix4fv(uniforms->projection, 1, GL_FALSE, viewProjection);
+  glUniformMatrix4fv(uniforms->view, 1, GL_FALSE, (GLfloat *)identity);
+}
+
+// The plane and the cubes standing on it only render into the shadow cache when it is out of date.
+void renderStaticCasters(const float viewProjection[16], void *ctx)
+{
+  Uniforms *uniforms = (Uniforms *)ctx;
+  renderCasterMatrices(uniforms, viewProjection);
 
   mat4 model = GLM_MAT4_IDENTITY_INIT;
 
@@ -242,17 +288,26 @@ void renderScene(Uniforms *uniforms, GLfloat *view, GLfloat *projection)
   glm_scale_uni(model, 0.5f);
   glUniformMatrix4fv(uniforms->model, 1, GL_FALSE, (GLfloat *)model);
   renderCube();
+}
 
+// The spinning cube renders on top of the cached depth every frame.
+void renderDynamicCasters(const float viewProjection[16], void *ctx)
+{
+  Uniforms *uniforms = (Uniforms *)ctx;
+  renderCasterMatrices(uniforms, viewProjection);
+
+  mat4 model;
   glm_translate_make(model, (vec3){-1.0f, 0.0f, 2.0});
   vec3 rotationAxis = {1.0f, 0.0f, 1.0f};
   glm_normalize(rotationAxis);
-  glm_rotate(model, glm_rad(60.0f), rotationAxis);
+  glm_rotate(model, glm_rad(60.0f) + (float)glrGetTime(), rotationAxis);
   glm_scale_uni(model, 0.25);
   glUniformMatrix4fv(uniforms->model, 1, GL_FALSE, (GLfloat *)model);
   renderCube();
 }
 
-void renderQuad()
+// Draw a quad in each quarter of the screen, the instance picks the cascade.
+void renderQuads(int count)
 {
   static float vertices[] = {
       // positions       // texture Coords
@@ -280,10 +335,28 @@ void renderQuad()
   }
 
   glBindVertexArray(vao);
-  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
   glBindVertexArray(0);
 }
 
+static void renderDepthPass(void *ctx)
+{
+  Passes *passes = (Passes *)ctx;
+  glUseProgram(passes->depthProgram);
+  glrRenderShadowCascades(passes->cascades, renderStaticCasters, renderDynamicCasters, passes->uniforms);
+}
+
+static void renderQuadPass(void *ctx)
+{
+  Passes *passes = (Passes *)ctx;
+  glUseProgram(passes->quadProgram);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, passes->cascades->texture);
+  glBindSampler(0, passes->depthSampler);
+  renderQuads(passes->cascades->cascadesLen);
+  glBindSampler(0, 0);
+}
+
 int main(int argc, char *argv[])
 {
   GlrSetupArgs setup = {.windowWidth = 1600, .windowHeight = 1200, .windowTitle = argv[0]};
@@ -307,8 +380,8 @@ int main(int argc, char *argv[])
 
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
   glfwSetInputMode(window, GLFW_STICKY_KEYS, GLFW_TRUE);
-  glfwSetCursorPosCallback(window, cursorPosCallback);
-  glfwSetScrollCallback(window, scrollCallback);
+  glrSetCursorPosCallback(window, cursorPosCallback);
+  glrSetScrollCallback(window, scrollCallback);
 
   glEnable(GL_DEPTH_TEST);
   // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -336,11 +409,12 @@ int main(int argc, char *argv[])
   GLuint quadProgram = glCreateProgram();
   {
     GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    ensureNoErrorMessage("Compiling Vertex Shader", glrShaderSourceFromFile(vertexShader, "shaders/c35-1.quad.vert"));
+    // The quad program only binds a sampler, so it can use SPIR-V which has no uniform names.
+    ensureNoErrorMessage("Compiling Vertex Shader", glrShaderFromFile(vertexShader, "shaders/c35-1.quad.vert"));
     glAttachShader(quadProgram, vertexShader);
 
     GLuint fragShader = glCreateShader(GL_FRAGMENT_SHADER);
-    ensureNoErrorMessage("Compiling Frag Shader", glrShaderSourceFromFile(fragShader, "shaders/c35-1.depth-quad.frag"));
+    ensureNoErrorMessage("Compiling Frag Shader", glrShaderFromFile(fragShader, "shaders/c35-1.depth-quad.frag"));
     glAttachShader(quadProgram, fragShader);
 
     ensureNoErrorMessage("Linking Program", glrLinkProgram(quadProgram));
@@ -350,61 +424,80 @@ int main(int argc, char *argv[])
   // use GL_TEXTURE0 for depthMap
   glUniform1i(glGetUniformLocation(quadProgram, "depthMap"), 0);
 
-  const int MAP_LENGTH = max(setup.windowHeight, setup.windowHeight);
-  GLuint depthMapFBO, depthMap;
-  glGenFramebuffers(1, &depthMapFBO);
-  glGenTextures(1, &depthMap);
-  glBindTexture(GL_TEXTURE_2D, depthMap);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, MAP_LENGTH, MAP_LENGTH, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
-  glDrawBuffer(GL_NONE);
-  glReadBuffer(GL_NONE);
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  GlrShaderFile depthShaderFiles[] = {
+      {GL_VERTEX_SHADER, "shaders/c35-1.depth.vert"},
+      {GL_FRAGMENT_SHADER, "shaders/c35-1.depth.frag"}};
+  glrWatchProgram(depthProgram, depthShaderFiles, 2, onDepthProgramReload, &uniforms);
+  GlrShaderFile quadShaderFiles[] = {
+      {GL_VERTEX_SHADER, "shaders/c35-1.quad.vert"},
+      {GL_FRAGMENT_SHADER, "shaders/c35-1.depth-quad.frag"}};
+  glrWatchProgram(quadProgram, quadShaderFiles, 2, onQuadProgramReload, NULL);
+
+  GlrShadowCascades *cascades = glrCreateShadowCascades(CASCADES_LEN, CASCADE_RESOLUTION);
+  // The quad pass shows the raw depth, the cascades texture compares depths for shadow samplers.
+  GLuint depthSampler;
+  glGenSamplers(1, &depthSampler);
+  glSamplerParameteri(depthSampler, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+  glSamplerParameteri(depthSampler, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glSamplerParameteri(depthSampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+  // Encloses the plane and the cubes
+  vec3 sceneMin = {-25.0f, -0.5f, -25.0f}, sceneMax = {25.0f, 2.5f, 25.0f};
+  vec3 lightPos = {-2.0f, 4.0f, -1.0f};
+  vec3 lightDirection;
+  glm_vec3_negate_to(lightPos, lightDirection);
+
+  // The depth pass renders the cascades, which the quad pass shows on the screen.
+  Passes passes = {
+      .cascades = cascades,
+      .uniforms = &uniforms,
+      .depthProgram = depthProgram,
+      .quadProgram = quadProgram,
+      .depthSampler = depthSampler,
+  };
+  GlrRenderGraph *graph = glrCreateRenderGraph(setup.windowWidth, setup.windowHeight);
+  GLuint shadowMap = glrGraphImportTexture(graph, "Cascades", GL_TEXTURE_2D_ARRAY, cascades->texture,
+                                           CASCADE_RESOLUTION, CASCADE_RESOLUTION, GL_DEPTH_COMPONENT24);
+  GLuint depthPass = glrGraphAddPass(graph, "Depth pass", 0, renderDepthPass, &passes);
+  glrGraphWrite(graph, depthPass, shadowMap);
+  GLuint quadPass = glrGraphAddPass(graph, "Quad pass", GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, renderQuadPass,
+                                    &passes);
+  glrGraphRead(graph, quadPass, shadowMap);
+  glrGraphWrite(graph, quadPass, GLR_GRAPH_BACKBUFFER);
+  ensureNoErrorMessage("Compiling Render Graph", glrCompileRenderGraph(graph));
 
   mat4 view, projection;
-  float lastFrame = glfwGetTime();
+  double lastFrame = glrGetTime();
   /* Loop until the user closes the window */
   while (!glfwWindowShouldClose(window))
   {
     /* Render here */
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    float currentFrame = glfwGetTime();
-    float deltaTime = currentFrame - lastFrame;
+    double currentFrame = glrGetTime();
+    float deltaTime = (float)(currentFrame - lastFrame);
     lastFrame = currentFrame;
     processInput(window, deltaTime, &state);
+    glrBenchmarkCamera(state.camera.position, state.camera.front);
+    glrPollShaderChanges();
+
+    vec3 cameraTarget;
+    glm_vec3_add(state.camera.position, state.camera.front, cameraTarget);
+    glm_lookat(state.camera.position, cameraTarget, state.camera.up, view);
+    glm_perspective(glm_rad(state.camera.fov), (float)setup.windowWidth / setup.windowHeight, 0.1f, 100.0f, projection);
+    glrUpdateShadowCascades(cascades, (GLfloat *)view, (GLfloat *)projection, lightDirection, sceneMin, sceneMax);
 
-    vec3 lightPos = {-2.0f, 4.0f, -1.0f};
-    float nearPlane = 1.0f, farPlane = 7.5f;
-    glm_lookat(lightPos, GLM_VEC3_ZERO, (vec3){-0.0f, 1.0f, 0.0f}, view);
-    glm_ortho(-10.0f, 10.0f, -10.0f, 10.0f, nearPlane, farPlane, projection);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-    glViewport(0, 0, MAP_LENGTH, MAP_LENGTH);
-    glClear(GL_DEPTH_BUFFER_BIT);
-    glUseProgram(depthProgram);
-    renderScene(&uniforms, (GLfloat *)view, (GLfloat *)projection);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(0, 0, setup.windowWidth, setup.windowHeight);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glUseProgram(quadProgram);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, depthMap);
-    renderQuad();
+    glrExecuteRenderGraph(graph);
 
     /* Swap front and back buffers */
-    glfwSwapBuffers(window);
+    glrSwapBuffers(window);
     /* Poll for and process events */
-    glfwPollEvents();
+    glrPollEvents(window);
   }
 
+  glrFreeRenderGraph(graph);
+  glDeleteSamplers(1, &depthSampler);
+  glrFreeShadowCascades(cascades);
   glrTeardown(window);
   return 0;
 }
@@ -0,0 +1,559 @@
+#include <stdio.h>
+#include <string.h>
+#include <glr.h>
+#include <cglm/mat4.h>
+#include <cglm/affine.h>
+#include <cglm/cam.h>
+#include <cglm/util.h>
+#include <cglm/quat.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#define POINT_LIGHTS_COUNT 4
+#define SPOT_LIGHT POINT_LIGHTS_COUNT
+#define LIGHTS_COUNT (POINT_LIGHTS_COUNT + 1)
+#define POST_PROGRAMS_COUNT 3
+
+typedef struct Camera
+{
+  vec3 position;
+  vec3 front;
+  vec3 up;
+  float fov;
+} Camera;
+typedef struct State
+{
+  Camera camera;
+  GlrDirectionalLight dirLight;
+  // The point lights, then the spot light
+  GlrLight lights[LIGHTS_COUNT];
+} State;
+
+typedef struct LampColor
+{
+  GLint location;
+  const float *color;
+} LampColor;
+
+static void ensureNoErrorMessage(const GLchar *prompt, const GLchar *message)
+{
+  if (message)
+  {
+    fprintf(stderr, "%s: %s\n", prompt, message);
+    free((void *)message);
+    exit(-1);
+  }
+}
+
+static unsigned char *ensureStbiSuccess(unsigned char *data)
+{
+  if (data)
+  {
+    return data;
+  }
+
+  fprintf(stderr, "Failed to load image: %s\n", stbi_failure_reason());
+  exit(-1);
+}
+
+void processInput(GLFWwindow *window, float deltaTime, State *state)
+{
+  Camera *camera = &(state->camera);
+  const float cameraSpeed = 2.5f * deltaTime;
+
+  vec3 translation = {0.0f, 0.0f, 0.0f};
+
+  vec3 front, up, right;
+  glm_vec3_copy(camera->front, front);
+  glm_vec3_normalize(front);
+  glm_vec3_copy(camera->up, up);
+  glm_vec3_normalize(up);
+  glm_vec3_cross(front, (vec3){0.0f, 1.0f, 0.0f}, right);
+
+  if (glrGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+  {
+    if (glrGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+    {
+      glm_vec3_scale(up, cameraSpeed, translation);
+    }
+    else
+    {
+      glm_vec3_scale(front, cameraSpeed, translation);
+    }
+  }
+  if (glrGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+  {
+    if (glrGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+    {
+      glm_vec3_scale(up, -cameraSpeed, translation);
+    }
+    else
+    {
+      glm_vec3_scale(front, -cameraSpeed, translation);
+    }
+  }
+  if (glrGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+  {
+    glm_vec3_scale(right, -cameraSpeed, translation);
+  }
+  if (glrGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+  {
+    glm_vec3_scale(right, cameraSpeed, translation);
+  }
+  glm_vec3_add(camera->position, translation, camera->position);
+}
+
+void cursorPosCallback(GLFWwindow *window, double xpos, double ypos)
+{
+  State *state = (State *)glfwGetWindowUserPointer(window);
+
+  const float sensitivity = 0.1f;
+  // hard coded yaw and pitch
+  static float lastX = 400.0f, lastY = 300.0f, yaw = -90.0f, pitch = 0.0f;
+  static int isFirst = 1;
+  if (isFirst)
+  {
+    isFirst = 0;
+    lastX = xpos;
+    lastY = ypos;
+    // compute the initial yaw and pitch
+  }
+
+  float xoffset = xpos - lastX;
+  float yoffset = lastY - ypos; // reversed: y ranges bottom to top
+  lastX = xpos;
+  lastY = ypos;
+  xoffset *= sensitivity;
+  yoffset *= sensitivity;
+
+  yaw += xoffset;
+  pitch = glm_clamp(pitch + yoffset, -89.0f, 89.0f);
+
+  vec3 direction;
+  direction[0] = cos(glm_rad(yaw)) * cos(glm_rad(pitch));
+  direction[1] = sin(glm_rad(pitch));
+  direction[2] = sin(glm_rad(yaw)) * cos(glm_rad(pitch));
+  glm_normalize_to(direction, state->camera.front);
+}
+
+void scrollCallback(GLFWwindow *window, double xoffset, double yoffset)
+{
+  State *state = (State *)glfwGetWindowUserPointer(window);
+  state->camera.fov = glm_clamp(state->camera.fov + (float)yoffset, 1.0f, 45.0f);
+}
+
+GLenum chooseTextureFormat(int nrChannels)
+{
+  if (nrChannels == 1)
+  {
+    return GL_RED;
+  }
+  if (nrChannels == 4)
+  {
+    return GL_RGBA;
+  }
+  return GL_RGB;
+}
+
+void loadTexture(GLuint id, GLenum index, const char *path)
+{
+  int width, height, nrChannels;
+  unsigned char *data = ensureStbiSuccess(stbi_load(path, &width, &height, &nrChannels, 0));
+
+  GLenum format = chooseTextureFormat(nrChannels);
+  glActiveTexture(index);
+  glBindTexture(GL_TEXTURE_2D, id);
+  glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+  glGenerateMipmap(GL_TEXTURE_2D);
+  stbi_image_free(data);
+}
+
+static void setLampColor(const GlrDrawItem *item)
+{
+  const LampColor *lampColor = (const LampColor *)item->userData;
+  glUniform3fv(lampColor->location, 1, lampColor->color);
+}
+
+int main(int argc, char *argv[])
+{
+  GlrSetupArgs setup = {.windowWidth = 800, .windowHeight = 600, .windowTitle = argv[0]};
+  GLFWwindow *window = glrSetup(&setup);
+
+  if (!window)
+  {
+    fprintf(stderr, "Error: %s\n", glrSetupError());
+    return -1;
+  }
+
+  const int LIGHT_ID = 0, OBJECT_ID = 1;
+
+  // Submit all shaders and programs first, then load textures while the driver compiles them.
+  glrMaxShaderCompilerThreads(0xFFFFFFFF);
+
+  // The light buffer goes through a half resolution bloom and is tone mapped to the screen.
+  const GLchar *error = NULL;
+  GlrPostProcess *post = glrCreatePostProcess(setup.windowWidth, setup.windowHeight, &error);
+  ensureNoErrorMessage("Creating post-processing", error);
+  const int BRIGHT_ID = 0, BLUR_ID = 1, TONEMAP_ID = 2;
+  const char *postPaths[POST_PROGRAMS_COUNT] = {
+      "shaders/c41-1.bright.frag",
+      "shaders/c41-1.blur.frag",
+      "shaders/c41-1.tonemap.frag"};
+  GLuint postFragShaders[POST_PROGRAMS_COUNT], postPrograms[POST_PROGRAMS_COUNT];
+  for (int i = 0; i < POST_PROGRAMS_COUNT; ++i)
+  {
+    postFragShaders[i] = glCreateShader(GL_FRAGMENT_SHADER);
+    ensureNoErrorMessage("Reading Frag Shader", glrShaderSourceFromFileAsync(postFragShaders[i], postPaths[i]));
+    postPrograms[i] = glCreateProgram();
+    glAttachShader(postPrograms[i], post->vertexShader);
+    glAttachShader(postPrograms[i], postFragShaders[i]);
+    glrLinkProgramAsync(postPrograms[i]);
+  }
+
+  GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+  ensureNoErrorMessage("Reading Vertex Shader", glrShaderSourceFromFileAsync(vertexShader, "shaders/c17-1.vert"));
+
+  GLuint lightFragShader = glCreateShader(GL_FRAGMENT_SHADER);
+  ensureNoErrorMessage("Reading Frag Shader", glrShaderSourceFromFileAsync(lightFragShader, "shaders/c17-1.light.frag"));
+  GLuint lightProgram = glCreateProgram();
+  glAttachShader(lightProgram, vertexShader);
+  glAttachShader(lightProgram, lightFragShader);
+  glrLinkProgramAsync(lightProgram);
+
+  GLuint objectFragShader = glCreateShader(GL_FRAGMENT_SHADER);
+  ensureNoErrorMessage("Reading Frag Shader", glrShaderSourceFromFileAsync(objectFragShader, "shaders/c41-1.gbuffer.frag"));
+  GLuint objectProgram = glCreateProgram();
+  glAttachShader(objectProgram, vertexShader);
+  glAttachShader(objectProgram, objectFragShader);
+  glrLinkProgramAsync(objectProgram);
+
+  GLuint textures[2];
+  const int DIFFUSE_TEX = 0, SPECULAR_TEX = 1;
+  glGenTextures(sizeof(textures) / sizeof(GLuint), textures);
+  stbi_set_flip_vertically_on_load(1);
+  loadTexture(textures[DIFFUSE_TEX], GL_TEXTURE0, "textures/container2.png");
+  loadTexture(textures[SPECULAR_TEX], GL_TEXTURE1, "textures/container2_specular.png");
+
+  ensureNoErrorMessage("Compiling Vertex Shader", glrShaderResult(vertexShader));
+  ensureNoErrorMessage("Compiling Frag Shader", glrShaderResult(lightFragShader));
+  ensureNoErrorMessage("Compiling Frag Shader", glrShaderResult(objectFragShader));
+  ensureNoErrorMessage("Linking Program", glrProgramResult(lightProgram));
+  ensureNoErrorMessage("Linking Program", glrProgramResult(objectProgram));
+  glDeleteShader(vertexShader);
+  glDeleteShader(lightFragShader);
+  glDeleteShader(objectFragShader);
+  for (int i = 0; i < POST_PROGRAMS_COUNT; ++i)
+  {
+    ensureNoErrorMessage("Compiling Frag Shader", glrShaderResult(postFragShaders[i]));
+    ensureNoErrorMessage("Linking Program", glrProgramResult(postPrograms[i]));
+    glDeleteShader(postFragShaders[i]);
+    glUseProgram(postPrograms[i]);
+    glUniform1i(glGetUniformLocation(postPrograms[i], "source"), 0);
+  }
+  GLint blurDirectionLocation = glGetUniformLocation(postPrograms[BLUR_ID], "direction");
+  glUseProgram(postPrograms[TONEMAP_ID]);
+  glUniform1i(glGetUniformLocation(postPrograms[TONEMAP_ID], "bloom"), 1);
+  glUniform1f(glGetUniformLocation(postPrograms[TONEMAP_ID], "exposure"), 1.0f);
+
+  glUseProgram(objectProgram);
+  glUniform1i(glGetUniformLocation(objectProgram, "material.diffuse"), 0);
+  glUniform1i(glGetUniformLocation(objectProgram, "material.specular"), 1);
+  glUniform1f(glGetUniformLocation(objectProgram, "material.shininess"), 64.0f);
+
+  float vertices[] = {
+      // positions(3f)     // normals(3f)     // texture coords(2f)
+      -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f,
+      0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f,
+      0.5f, 0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 1.0f, 1.0f,
+      0.5f, 0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 1.0f, 1.0f,
+      -0.5f, 0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f,
+      -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f,
+
+      -0.5f, -0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+      0.5f, -0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f,
+      0.5f, 0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f,
+      0.5f, 0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f,
+      -0.5f, 0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+      -0.5f, -0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+
+      -0.5f, 0.5f, 0.5f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+      -0.5f, 0.5f, -0.5f, -1.0f, 0.0f, 0.0f, 1.0f, 1.0f,
+      -0.5f, -0.5f, -0.5f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+      -0.5f, -0.5f, -0.5f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+      -0.5f, -0.5f, 0.5f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+      -0.5f, 0.5f, 0.5f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+
+      0.5f, 0.5f, 0.5f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+      0.5f, 0.5f, -0.5f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f,
+      0.5f, -0.5f, -0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+      0.5f, -0.5f, -0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+      0.5f, -0.5f, 0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+      0.5f, 0.5f, 0.5f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+
+      -0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f,
+      0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f, 1.0f, 1.0f,
+      0.5f, -0.5f, 0.5f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+      0.5f, -0.5f, 0.5f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+      -0.5f, -0.5f, 0.5f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f,
+      -0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f,
+
+      -0.5f, 0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+      0.5f, 0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f,
+      0.5f, 0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+      0.5f, 0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+      -0.5f, 0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f,
+      -0.5f, 0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f};
+
+  // positions all containers
+  vec3 cubePositions[] = {
+      {0.0f, 0.0f, 0.0f},
+      {2.0f, 5.0f, -15.0f},
+      {-1.5f, -2.2f, -2.5f},
+      {-3.8f, -2.0f, -12.3f},
+      {2.4f, -0.4f, -3.5f},
+      {-1.7f, 3.0f, -7.5f},
+      {1.3f, -2.0f, -2.5f},
+      {1.5f, 2.0f, -2.5f},
+      {1.5f, 0.2f, -1.5f},
+      {-1.3f, 1.0f, -1.5f}};
+
+  GLuint VBO, VAOs[2];
+  glGenBuffers(1, &VBO);
+  glGenVertexArrays(2, VAOs);
+
+  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+  glBindVertexArray(VAOs[LIGHT_ID]);
+  // position
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
+  glEnableVertexAttribArray(0);
+
+  glBindVertexArray(VAOs[OBJECT_ID]);
+  // positions
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
+  glEnableVertexAttribArray(0);
+  // normals
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(sizeof(float) * 3));
+  glEnableVertexAttribArray(1);
+  // texCoords
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(sizeof(float) * 6));
+  glEnableVertexAttribArray(2);
+
+  // unbind
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+
+  State state = {
+      .camera = {
+          .position = {-0.1f, 0.0f, 5.0f},
+          .front = {0.0f, 0.0f, -1.0f},
+          .up = {0.0f, 1.0f, 0.0f},
+          .fov = 45.0f,
+      },
+      .dirLight = {.direction = {-0.2f, -1.0f, -0.3f}, .ambient = {0.05f, 0.05f, 0.05f}, .diffuse = {0.4f, 0.4f, 0.4f}, .specular = {0.5f, 0.5f, 0.5f}},
+      .lights = {// point light 1
+                 {.position = {0.7f, 0.2f, 2.0f}, .ambient = {0.05f, 0.05f, 0.05f}, .diffuse = {0.8f, 0.8f, 0.8f}, .specular = {1.0f, 1.0f, 1.0f}, .constant = 1.0f, .linear = 0.09f, .quadratic = 0.032f},
+                 // point light 2
+                 {.position = {2.3f, -3.3f, -4.0f}, .ambient = {0.05f, 0.05f, 0.05f}, .diffuse = {0.8f, 0.8f, 0.8f}, .specular = {1.0f, 1.0f, 1.0f}, .constant = 1.0f, .linear = 0.09f, .quadratic = 0.032f},
+                 // point light 3
+                 {.position = {-4.0f, 2.0f, -12.0f}, .ambient = {0.05f, 0.05f, 0.05f}, .diffuse = {0.8f, 0.8f, 0.8f}, .specular = {1.0f, 1.0f, 1.0f}, .constant = 1.0f, .linear = 0.09f, .quadratic = 0.032f},
+                 // point light 4
+                 {.position = {0.0f, 0.0f, -3.0f}, .ambient = {0.05f, 0.05f, 0.05f}, .diffuse = {0.8f, 0.8f, 0.8f}, .specular = {1.0f, 1.0f, 1.0f}, .constant = 1.0f, .linear = 0.09f, .quadratic = 0.032f},
+                 // spot light
+                 {.position = {-0.1f, 0.0f, 5.0f}, .direction = {0.0f, 0.0f, -1.0f}, .ambient = {0.0f, 0.0f, 0.0f}, .diffuse = {1.0f, 1.0f, 1.0f}, .specular = {1.0f, 1.0f, 1.0f}, .constant = 1.0f, .linear = 0.09f, .quadratic = 0.032f, .cutOff = cos(glm_rad(12.5f)), .outerCutOff = cos(glm_rad(17.5f))}}};
+
+  glfwSetWindowUserPointer(window, &state);
+
+  glEnable(GL_DEPTH_TEST);
+  glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+  glrSetCursorPosCallback(window, cursorPosCallback);
+  glrSetScrollCallback(window, scrollCallback);
+
+  mat4 view, projection;
+
+  GLuint modelLocations[2] = {
+      glGetUniformLocation(lightProgram, "model"),
+      glGetUniformLocation(objectProgram, "model")};
+  GLuint viewLocations[2] = {
+      glGetUniformLocation(lightProgram, "view"),
+      glGetUniformLocation(objectProgram, "view")};
+  GLuint projectionLocations[2] = {
+      glGetUniformLocation(lightProgram, "projection"),
+      glGetUniformLocation(objectProgram, "projection")};
+
+  GLuint lightColorLocation = glGetUniformLocation(lightProgram, "lightColor");
+
+  GLuint transposedInverseModelLocation = glGetUniformLocation(objectProgram, "transposedInverseModel");
+
+  // The cubes are written into the G-buffer, then every light only shades the pixels inside its volume.
+  GlrDeferred *deferred = glrCreateDeferred(setup.windowWidth, setup.windowHeight, &error);
+  ensureNoErrorMessage("Creating G-buffer", error);
+
+  // The post passes bind their sources to units 0 and 1, so the queue binds this material again every frame.
+  GlrModelMaterial cubeMaterial = {
+      .diffuse = textures[DIFFUSE_TEX],
+      .specular = textures[SPECULAR_TEX],
+      .shininess = 64.0f};
+  LampColor lampColors[POINT_LIGHTS_COUNT];
+  for (unsigned int i = 0; i < POINT_LIGHTS_COUNT; ++i)
+  {
+    lampColors[i].location = lightColorLocation;
+  }
+  GlrRenderQueue *queue = glrCreateRenderQueue();
+
+  // Neither the cubes nor the lamps move, their matrices are computed once by the first update.
+  GlrTransforms *cubeTransforms = glrCreateTransforms();
+  for (unsigned int i = 0; i < sizeof(cubePositions) / sizeof(vec3); ++i)
+  {
+    versor rotation;
+    glm_quatv(rotation, glm_rad(20.0f * i), (vec3){1.0f, 0.3f, 0.5f});
+    glrAddTransform(cubeTransforms, cubePositions[i], rotation, NULL);
+  }
+  // Bounding spheres of the rotated unit cubes, centered on their positions
+  float cubeRadii[sizeof(cubePositions) / sizeof(vec3)];
+  for (unsigned int i = 0; i < sizeof(cubePositions) / sizeof(vec3); ++i)
+  {
+    cubeRadii[i] = 0.87f;
+  }
+  GlrBounds cubeBounds = {
+      .x = cubeTransforms->position[0],
+      .y = cubeTransforms->position[1],
+      .z = cubeTransforms->position[2],
+      .radius = cubeRadii,
+      .len = cubeTransforms->len,
+  };
+  GLuint visibleCubes[sizeof(cubePositions) / sizeof(vec3)];
+  GlrTransforms *lampTransforms = glrCreateTransforms();
+  for (unsigned int i = 0; i < POINT_LIGHTS_COUNT; ++i)
+  {
+    glrAddTransform(lampTransforms, state.lights[i].position, NULL, (vec3){0.2f, 0.2f, 0.2f});
+  }
+
+  double lastFrame = glrGetTime();
+  glfwSetInputMode(window, GLFW_STICKY_KEYS, GLFW_TRUE);
+  /* Loop until the user closes the window */
+  while (!glfwWindowShouldClose(window))
+  {
+    /* Render here */
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    double currentFrame = glrGetTime();
+    float deltaTime = (float)(currentFrame - lastFrame);
+    lastFrame = currentFrame;
+    processInput(window, deltaTime, &state);
+    glrBenchmarkCamera(state.camera.position, state.camera.front);
+
+    // SpotLight follows camera
+    glm_vec3_copy(state.camera.position, state.lights[SPOT_LIGHT].position);
+    glm_vec3_copy(state.camera.front, state.lights[SPOT_LIGHT].direction);
+
+    vec3 cameraTarget;
+    glm_vec3_add(state.camera.position, state.camera.front, cameraTarget);
+    glm_lookat(state.camera.position, cameraTarget, state.camera.up, view);
+
+    glm_perspective(glm_rad(state.camera.fov), 800.0f / 600.0f, 0.1f, 100.0f, projection);
+
+    glUseProgram(objectProgram);
+
+    glUniformMatrix4fv(viewLocations[OBJECT_ID], 1, GL_FALSE, (GLfloat *)view);
+    glUniformMatrix4fv(projectionLocations[OBJECT_ID], 1, GL_FALSE, (GLfloat *)projection);
+
+    glUseProgram(lightProgram);
+    glUniformMatrix4fv(viewLocations[LIGHT_ID], 1, GL_FALSE, (GLfloat *)view);
+    glUniformMatrix4fv(projectionLocations[LIGHT_ID], 1, GL_FALSE, (GLfloat *)projection);
+
+    glrUpdateTransforms(cubeTransforms);
+    glrUpdateTransforms(lampTransforms);
+
+    mat4 viewProjection;
+    float frustum[6][4];
+    glm_mat4_mul(projection, view, viewProjection);
+    glrFrustumPlanes((GLfloat *)viewProjection, frustum);
+    GLuint visibleCubesLen = glrCullFrustum(frustum, &cubeBounds, visibleCubes);
+
+    // Submit the cubes in any order, the queue groups them by state and draws front to back.
+    glrBeginGeometryPass(deferred);
+    glrClearRenderQueue(queue);
+    for (GLuint visibleIndex = 0; visibleIndex < visibleCubesLen; ++visibleIndex)
+    {
+      GLuint i = visibleCubes[visibleIndex];
+      GlrDrawItem item = {
+          .program = objectProgram,
+          .vao = VAOs[OBJECT_ID],
+          .material = &cubeMaterial,
+          .mode = GL_TRIANGLES,
+          .count = 36,
+          .modelLocation = modelLocations[OBJECT_ID],
+          .normalMatrixLocation = transposedInverseModelLocation,
+          .normalMatrix = glrTransformNormal(cubeTransforms, i),
+          .depth = glm_vec3_distance(state.camera.position, cubePositions[i]),
+      };
+      memcpy(item.transform, glrTransformWorld(cubeTransforms, i), sizeof(mat4));
+      glrPushDrawItem(queue, &item);
+    }
+    glrSortRenderQueue(queue);
+    glrDrawRenderQueue(queue);
+
+    glrDrawDeferredLights(deferred, (GLfloat *)viewProjection, state.camera.position, &state.dirLight, state.lights,
+                          LIGHTS_COUNT);
+
+    // The lamps are not lit, they are drawn forward into the light buffer, depth tested against the cubes.
+    glrClearRenderQueue(queue);
+    for (unsigned int i = 0; i < POINT_LIGHTS_COUNT; ++i)
+    {
+      lampColors[i].color = state.lights[i].diffuse;
+      GlrDrawItem item = {
+          .program = lightProgram,
+          .vao = VAOs[LIGHT_ID],
+          .mode = GL_TRIANGLES,
+          .count = 36,
+          .modelLocation = modelLocations[LIGHT_ID],
+          .normalMatrixLocation = -1,
+          .depth = glm_vec3_distance(state.camera.position, state.lights[i].position),
+          .setUniforms = setLampColor,
+          .userData = &lampColors[i],
+      };
+      memcpy(item.transform, glrTransformWorld(lampTransforms, i), sizeof(mat4));
+      glrPushDrawItem(queue, &item);
+    }
+    glrSortRenderQueue(queue);
+    glrDrawRenderQueue(queue);
+
+    // Blur the bright parts at half resolution, ping-ponging between two pooled targets.
+    GlrRenderTarget *bright = glrPostPass(post, postPrograms[BRIGHT_ID], deferred->light, 2, GL_RGBA16F);
+    glUseProgram(postPrograms[BLUR_ID]);
+    glUniform2f(blurDirectionLocation, 1.0f, 0.0f);
+    GlrRenderTarget *blurred = glrPostPass(post, postPrograms[BLUR_ID], bright->color, 2, GL_RGBA16F);
+    glrReleaseRenderTarget(bright);
+    glUseProgram(postPrograms[BLUR_ID]);
+    glUniform2f(blurDirectionLocation, 0.0f, 1.0f);
+    GlrRenderTarget *bloom = glrPostPass(post, postPrograms[BLUR_ID], blurred->color, 2, GL_RGBA16F);
+    glrReleaseRenderTarget(blurred);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, bloom->color);
+    glrDrawPostPass(post, postPrograms[TONEMAP_ID], deferred->light, NULL);
+    glrReleaseRenderTarget(bloom);
+
+    /* Swap front and back buffers */
+    glrSwapBuffers(window);
+
+    /* Poll for and process events */
+    glrPollEvents(window);
+  }
+
+  glrFreeTransforms(cubeTransforms);
+  glrFreeTransforms(lampTransforms);
+  glrFreeRenderQueue(queue);
+  glrFreeDeferred(deferred);
+  for (int i = 0; i < POST_PROGRAMS_COUNT; ++i)
+  {
+    glDeleteProgram(postPrograms[i]);
+  }
+  glrFreePostProcess(post);
+  glrTeardown(window);
+  return 0;
+}
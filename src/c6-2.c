@@ -70,10 +70,10 @@ int main(int argc, char* argv[])
     glDrawArrays(GL_TRIANGLES, 0, 3);
 
     /* Swap front and back buffers */
-    glfwSwapBuffers(window);
+    glrSwapBuffers(window);
 
     /* Poll for and process events */
-    glfwPollEvents();
+    glrPollEvents(window);
   }
 
   glrTeardown(window);
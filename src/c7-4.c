@@ -107,16 +107,16 @@ int main(int argc, char *argv[])
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   glBindVertexArray(0);
 
-  double lastTime = glfwGetTime();
+  double lastTime = glrGetTime();
   const float mixValueSpeed = 0.5f;
   /* Loop until the user closes the window */
   while (!glfwWindowShouldClose(window))
   {
-    double currentTime = glfwGetTime();
+    double currentTime = glrGetTime();
     float deltaTime = (float)(currentTime - lastTime);
     lastTime = currentTime;
 
-    if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
+    if (glrGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
     {
       mixValue += deltaTime * mixValueSpeed;
       if (mixValue > 1.0f)
@@ -126,7 +126,7 @@ int main(int argc, char *argv[])
 
       glUniform1f(mixValueLocation, mixValue);
     }
-    if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)
+    if (glrGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)
     {
       mixValue -= deltaTime * mixValueSpeed;
       if (mixValue < 0.0f)
@@ -147,10 +147,10 @@ int main(int argc, char *argv[])
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
     /* Swap front and back buffers */
-    glfwSwapBuffers(window);
+    glrSwapBuffers(window);
 
     /* Poll for and process events */
-    glfwPollEvents();
+    glrPollEvents(window);
   }
 
   glrTeardown(window);
@@ -123,16 +123,16 @@ int main(int argc, char *argv[])
     mat4 transform;
 
     glm_mat4_identity(transform);
-    glm_rotate(transform, (float)glfwGetTime(), (vec3){0.0, 0.0, 1.0});
+    glm_rotate(transform, (float)glrGetTime(), (vec3){0.0, 0.0, 1.0});
     glm_translate(transform, (vec3){0.5f, -0.5f, 0.0f});
     glUniformMatrix4fv(transformLocation, 1, GL_FALSE, (GLfloat *)transform);
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
     /* Swap front and back buffers */
-    glfwSwapBuffers(window);
+    glrSwapBuffers(window);
 
     /* Poll for and process events */
-    glfwPollEvents();
+    glrPollEvents(window);
   }
 
   glrTeardown(window);
@@ -78,7 +78,7 @@ int main(int argc, char *argv[])
   glUniform1i(glGetUniformLocation(program, "texture2"), 1);
 
   mat4 model, view, projection;
-  glm_rotate_make(model, glm_rad(50.0f) * (float)glfwGetTime(), (vec3){0.5f, 1.0f, 0.0f});
+  glm_rotate_make(model, glm_rad(50.0f) * (float)glrGetTime(), (vec3){0.5f, 1.0f, 0.0f});
   glm_translate_make(view, (vec3){0.0f, 0.0f, -3.0f});
   glm_mat4_identity(projection);
   glm_perspective(glm_rad(85.0f), 800.0f / 600.0f, 0.1f, 100.0f, projection);
@@ -122,7 +122,7 @@ int main(int argc, char *argv[])
 
     glUseProgram(program);
 
-    glm_rotate_make(model, glm_rad(50.0f) * (float)glfwGetTime(), (vec3){0.5f, 1.0f, 0.0f});
+    glm_rotate_make(model, glm_rad(50.0f) * (float)glrGetTime(), (vec3){0.5f, 1.0f, 0.0f});
     glUniformMatrix4fv(modelLocation, 1, GL_FALSE, (GLfloat *)model);
 
     glBindVertexArray(VAO);
@@ -132,7 +132,7 @@ int main(int argc, char *argv[])
       glm_translate_make(model, cubePositions[i]);
       float angle = 20.0f * i;
       if (i % 3 == 1) {
-        angle = (float)glfwGetTime() * 25.0f;
+        angle = (float)glrGetTime() * 25.0f;
       }
       glm_rotate(model, glm_rad(angle), (vec3){1.0f, 0.3f, 0.5f});
       glUniformMatrix4fv(modelLocation, 1, GL_FALSE, (GLfloat *)model);
@@ -140,10 +140,10 @@ int main(int argc, char *argv[])
     }
 
     /* Swap front and back buffers */
-    glfwSwapBuffers(window);
+    glrSwapBuffers(window);
 
     /* Poll for and process events */
-    glfwPollEvents();
+    glrPollEvents(window);
   }
 
   glrTeardown(window);